@@ -918,4 +918,11 @@ INSERT INTO transactions (items, user_id, created_at) VALUES ('[{"id":93,"generi
 INSERT INTO transactions (items, user_id, created_at) VALUES ('[{"id":2,"generic_name":"Tabs Paracetamol 500mg","brand_name":"Hedex","quantity":4,"selling_price":1800,"cost_price":1000,"barcode":""},{"id":21,"generic_name":"Tabs Artemether/Lumefantrine 20/120mg","brand_name":"Coartem","quantity":4,"selling_price":10000,"cost_price":6000,"barcode":""},{"id":13,"generic_name":"Tabs Azithromycin 500mg","brand_name":"Zithromax","quantity":5,"selling_price":8500,"cost_price":5000,"barcode":""}]', 1, '2026-04-26 18:11:05');
 INSERT INTO transactions (items, user_id, created_at) VALUES ('[{"id":2,"generic_name":"Tabs Paracetamol 500mg","brand_name":"Hedex","quantity":3,"selling_price":1800,"cost_price":1000,"barcode":""},{"id":81,"generic_name":"Tabs Vitamin C 500mg","brand_name":"Redoxon","quantity":3,"selling_price":2500,"cost_price":1500,"barcode":""}]', 1, '2026-04-27 12:11:53');
 INSERT INTO transactions (items, user_id, created_at) VALUES ('[{"id":27,"generic_name":"Caps Fluconazole 150mg","brand_name":"Diflucan","quantity":5,"selling_price":7000,"cost_price":4000,"barcode":""},{"id":32,"generic_name":"Tabs Albendazole 400mg","brand_name":"Zentel","quantity":4,"selling_price":1800,"cost_price":1000,"barcode":""},{"id":66,"generic_name":"Tabs Cetirizine 10mg","brand_name":"Zyrtec","quantity":1,"selling_price":1800,"cost_price":1000,"barcode":""},{"id":93,"generic_name":"Tabs Aspirin 75mg (Cardiac)","brand_name":"Cardiprin","quantity":5,"selling_price":1500,"cost_price":800,"barcode":""},{"id":22,"generic_name":"Tabs Artemether/Lumefantrine 80/480mg","brand_name":"Coartem","quantity":5,"selling_price":15000,"cost_price":9000,"barcode":""}]', 1, '2026-04-27 10:12:22');
-INSERT INTO transactions (items, user_id, created_at) VALUES ('[{"id":49,"generic_name":"Tabs Metformin 500mg","brand_name":"Glucophage","quantity":3,"selling_price":2500,"cost_price":1500,"barcode":""},{"id":14,"generic_name":"Tabs Ciprofloxacin 500mg","brand_name":"Ciprobay","quantity":1,"selling_price":5000,"cost_price":3000,"barcode":""},{"id":99,"generic_name":"Tabs Combined OCP 30mcg/150mcg","brand_name":"Microgynon","quantity":2,"selling_price":4000,"cost_price":2500,"barcode":""},{"id":91,"generic_name":"Tabs Simvastatin 20mg","brand_name":"Zocor","quantity":4,"selling_price":5000,"cost_price":3000,"barcode":""},{"id":64,"generic_name":"Tabs Salbutamol 4mg","brand_name":"Ventolin","quantity":2,"selling_price":1500,"cost_price":800,"barcode":""}]', 1, '2026-04-27 11:04:46');
\ No newline at end of file
+INSERT INTO transactions (items, user_id, created_at) VALUES ('[{"id":49,"generic_name":"Tabs Metformin 500mg","brand_name":"Glucophage","quantity":3,"selling_price":2500,"cost_price":1500,"barcode":""},{"id":14,"generic_name":"Tabs Ciprofloxacin 500mg","brand_name":"Ciprobay","quantity":1,"selling_price":5000,"cost_price":3000,"barcode":""},{"id":99,"generic_name":"Tabs Combined OCP 30mcg/150mcg","brand_name":"Microgynon","quantity":2,"selling_price":4000,"cost_price":2500,"barcode":""},{"id":91,"generic_name":"Tabs Simvastatin 20mg","brand_name":"Zocor","quantity":4,"selling_price":5000,"cost_price":3000,"barcode":""},{"id":64,"generic_name":"Tabs Salbutamol 4mg","brand_name":"Ventolin","quantity":2,"selling_price":1500,"cost_price":800,"barcode":""}]', 1, '2026-04-27 11:04:46');
+-- File the sales under their local date and hour (Africa/Kampala, UTC+3), as the till does at insert, and
+-- store the UTC created_at text above as epoch milliseconds
+UPDATE transactions
+SET sale_date = date(created_at, '+3 hours'),
+    sale_hour = CAST(strftime('%H', created_at, '+3 hours') AS INTEGER),
+    created_at = CAST(round((julianday(created_at) - 2440587.5) * 86400000.0) AS INTEGER)
+WHERE typeof(created_at) = 'text';
@@ -0,0 +1,129 @@
+#include "alertengine.hpp"
+#include <algorithm>
+#include "database.hpp"
+
+AlertEngine::AlertEngine(QObject* parent) : QObject(parent) {
+    m_horizonDays = Database::instance().setting("expiry_horizon_days", "90").toInt();
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(0);
+    connect(m_flushTimer, &QTimer::timeout, this, &AlertEngine::flush);
+
+    // Expiry classification depends on today's date, so rebuild once the day rolls over
+    m_dayTimer = new QTimer(this);
+    m_dayTimer->setInterval(60 * 60 * 1000);
+    connect(m_dayTimer, &QTimer::timeout, this, [this] {
+        if (m_builtOn != QDate::currentDate()) {
+            rebuild();
+        }
+    });
+    m_dayTimer->start();
+
+    m_listenerId = Database::instance().addChangeListener([this](const Database::DataChange& change) {
+        if (change.unknown) {
+            rebuild();  // products were deleted by another till
+            return;
+        }
+        if (change.products.isEmpty()) {
+            return;
+        }
+        for (int id : change.products) {
+            m_dirty.insert(id);
+        }
+        m_flushTimer->start();
+    });
+
+    rebuild();
+}
+
+AlertEngine::~AlertEngine() { Database::instance().removeChangeListener(m_listenerId); }
+
+int AlertEngine::classify(const StockAlert& a) const {
+    int kinds = 0;
+    if (a.quantity <= 0) {
+        kinds |= StockAlert::OutOfStock;
+    } else if (a.quantity <= a.reorderLevel) {
+        kinds |= StockAlert::LowStock;
+    }
+
+    // Expiry dates of batches that are no longer on the shelf are not worth flagging
+    if (a.quantity > 0 && a.nextExpiry.isValid()) {
+        QDate today = QDate::currentDate();
+        if (a.nextExpiry < today) {
+            kinds |= StockAlert::Expired;
+        } else if (a.nextExpiry <= today.addDays(m_horizonDays)) {
+            kinds |= StockAlert::Expiring;
+        }
+    }
+    return kinds;
+}
+
+void AlertEngine::rebuild() {
+    m_builtOn = QDate::currentDate();
+    m_dirty.clear();
+    m_alerts.clear();
+
+    for (StockAlert a : Database::instance().getStockAlerts(m_builtOn.addDays(m_horizonDays))) {
+        a.kinds = classify(a);
+        if (a.kinds != 0) {
+            m_alerts.insert(a.productId, a);
+        }
+    }
+    emit alertsChanged(count());
+}
+
+void AlertEngine::flush() {
+    if (m_dirty.isEmpty()) {
+        return;
+    }
+    QList<int> ids(m_dirty.begin(), m_dirty.end());
+    m_dirty.clear();
+
+    // Products missing from the result were deleted
+    for (int id : ids) {
+        m_alerts.remove(id);
+    }
+    for (StockAlert a : Database::instance().getStockAlertInputs(ids)) {
+        a.kinds = classify(a);
+        if (a.kinds != 0) {
+            m_alerts.insert(a.productId, a);
+        }
+    }
+    emit alertsChanged(count());
+}
+
+QList<StockAlert> AlertEngine::alerts() const {
+    QList<StockAlert> list = m_alerts.values();
+    // Most urgent first: out of stock / expired, then by nearest expiry, then by name
+    std::sort(list.begin(), list.end(), [](const StockAlert& a, const StockAlert& b) {
+        const int urgent = StockAlert::OutOfStock | StockAlert::Expired;
+        bool ua = (a.kinds & urgent) != 0;
+        bool ub = (b.kinds & urgent) != 0;
+        if (ua != ub) {
+            return ua;
+        }
+        if (a.nextExpiry.isValid() != b.nextExpiry.isValid()) {
+            return a.nextExpiry.isValid();
+        }
+        if (a.nextExpiry != b.nextExpiry) {
+            return a.nextExpiry < b.nextExpiry;
+        }
+        return a.genericName < b.genericName;
+    });
+    return list;
+}
+
+void AlertEngine::setExpiryHorizonDays(int days) {
+    if (days == m_horizonDays) {
+        return;
+    }
+    m_horizonDays = days;
+    Database::instance().setSetting("expiry_horizon_days", QString::number(days));
+    rebuild();
+}
+
+bool AlertEngine::setReorderLevel(int productId, int level) {
+    // The change listener picks up the change and re-evaluates just this product
+    return Database::instance().setReorderLevel(productId, level);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include "models.hpp"
+
+// Keeps the low-stock / near-expiry watchlist in memory.
+// The full list is built once from the database; after that only the products reported by
+// Database's change listener are re-read, batched on the next event-loop turn so a sale never waits on it.
+class AlertEngine : public QObject {
+    Q_OBJECT
+  public:
+    explicit AlertEngine(QObject* parent = nullptr);
+    ~AlertEngine() override;
+
+    void rebuild();
+
+    [[nodiscard]] QList<StockAlert> alerts() const;
+    [[nodiscard]] int count() const { return static_cast<int>(m_alerts.size()); }
+
+    [[nodiscard]] int expiryHorizonDays() const { return m_horizonDays; }
+    void setExpiryHorizonDays(int days);
+    bool setReorderLevel(int productId, int level);
+
+  signals:
+    void alertsChanged(int count);
+
+  private:
+    QHash<int, StockAlert> m_alerts;
+    QSet<int> m_dirty;
+    QTimer* m_flushTimer;
+    QTimer* m_dayTimer;
+    QDate m_builtOn;
+    int m_horizonDays = 90;
+    int m_listenerId = 0;
+
+    void flush();
+    [[nodiscard]] int classify(const StockAlert& a) const;
+};
@@ -0,0 +1,168 @@
+#include "alertswidget.hpp"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QVBoxLayout>
+#include "alertengine.hpp"
+#include "database.hpp"
+
+AlertsWidget::AlertsWidget(AlertEngine* engine, QWidget* parent) : QWidget(parent), m_engine(engine) {
+    setupUi();
+    connect(m_engine, &AlertEngine::alertsChanged, this, [this] {
+        if (isVisible()) {
+            refresh();
+        }
+    });
+}
+
+void AlertsWidget::setupUi() {
+    auto* root = new QVBoxLayout(this);
+    root->setContentsMargins(16, 16, 16, 16);
+    root->setSpacing(12);
+
+    // Header
+    auto* headerRow = new QHBoxLayout;
+    auto* title = new QLabel("⚠️  Stock Alerts");
+    title->setObjectName("pageTitle");
+    headerRow->addWidget(title);
+    headerRow->addStretch();
+    m_countLabel = new QLabel;
+    m_countLabel->setStyleSheet("color: #4a5568; font-size: 13px;");
+    headerRow->addWidget(m_countLabel);
+    root->addLayout(headerRow);
+
+    auto* hint = new QLabel("Products at or below their reorder level, and batches expiring within the horizon. "
+                            "Double-click a row to change its reorder level.");
+    hint->setStyleSheet("color: #718096; font-size: 12px;");
+    root->addWidget(hint);
+
+    // Toolbar
+    auto* toolbar = new QHBoxLayout;
+    auto* filterLabel = new QLabel("Show:");
+    filterLabel->setStyleSheet("font-weight: 600; color: #4a5568;");
+    m_filterCombo = new QComboBox;
+    m_filterCombo->addItem("All alerts", 0);
+    m_filterCombo->addItem("Low stock", static_cast<int>(StockAlert::LowStock));
+    m_filterCombo->addItem("Out of stock", static_cast<int>(StockAlert::OutOfStock));
+    m_filterCombo->addItem("Expiring soon", static_cast<int>(StockAlert::Expiring));
+    m_filterCombo->addItem("Expired", static_cast<int>(StockAlert::Expired));
+    m_filterCombo->setFixedWidth(150);
+
+    auto* horizonLabel = new QLabel("Expiry horizon:");
+    horizonLabel->setStyleSheet("font-weight: 600; color: #4a5568;");
+    m_horizonSpin = new QSpinBox;
+    m_horizonSpin->setRange(1, 730);
+    m_horizonSpin->setSuffix(" days");
+    m_horizonSpin->setValue(m_engine->expiryHorizonDays());
+
+    toolbar->addWidget(filterLabel);
+    toolbar->addWidget(m_filterCombo);
+    toolbar->addSpacing(16);
+    toolbar->addWidget(horizonLabel);
+    toolbar->addWidget(m_horizonSpin);
+    toolbar->addStretch();
+    root->addLayout(toolbar);
+
+    // Table
+    m_table = new QTableWidget;
+    m_table->setColumnCount(6);
+    m_table->setHorizontalHeaderLabels({"Product", "Brand", "Qty", "Reorder Level", "Next Expiry", "Status"});
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setAlternatingRowColors(true);
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_table->setColumnWidth(1, 150);
+    m_table->setColumnWidth(2, 70);
+    m_table->setColumnWidth(3, 110);
+    m_table->setColumnWidth(4, 120);
+    m_table->setColumnWidth(5, 220);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->setShowGrid(false);
+    root->addWidget(m_table);
+
+    connect(m_filterCombo, &QComboBox::currentIndexChanged, this, &AlertsWidget::refresh);
+    connect(m_horizonSpin, &QSpinBox::editingFinished, this,
+            [this] { m_engine->setExpiryHorizonDays(m_horizonSpin->value()); });
+    connect(m_table, &QTableWidget::cellDoubleClicked, this, &AlertsWidget::onEditReorderLevel);
+}
+
+void AlertsWidget::refresh() {
+    int filter = m_filterCombo->currentData().toInt();
+    QList<StockAlert> alerts = m_engine->alerts();
+
+    m_table->setRowCount(0);
+    int row = 0;
+    for (const auto& a : alerts) {
+        if (filter != 0 && (a.kinds & filter) == 0) {
+            continue;
+        }
+        m_table->insertRow(row);
+        setRow(row, a);
+        row++;
+    }
+    m_countLabel->setText(QString("%1 of %2 alerts").arg(row).arg(alerts.size()));
+}
+
+void AlertsWidget::setRow(int row, const StockAlert& a) {
+    auto* nameItem = new QTableWidgetItem(a.genericName);
+    nameItem->setData(Qt::UserRole, a.productId);
+    m_table->setItem(row, 0, nameItem);
+    m_table->setItem(row, 1, new QTableWidgetItem(a.brandName));
+
+    auto* qtyItem = new QTableWidgetItem(QString::number(a.quantity));
+    qtyItem->setTextAlignment(Qt::AlignCenter);
+    if (a.kinds & StockAlert::OutOfStock) {
+        qtyItem->setForeground(QColor("#e53e3e"));
+    } else if (a.kinds & StockAlert::LowStock) {
+        qtyItem->setForeground(QColor("#d97706"));
+    }
+    m_table->setItem(row, 2, qtyItem);
+
+    auto* levelItem = new QTableWidgetItem(QString::number(a.reorderLevel));
+    levelItem->setData(Qt::UserRole, a.reorderLevel);
+    levelItem->setTextAlignment(Qt::AlignCenter);
+    m_table->setItem(row, 3, levelItem);
+
+    auto* expItem = new QTableWidgetItem(a.nextExpiry.isValid() ? a.nextExpiry.toString("dd MMM yyyy") : "—");
+    if (a.kinds & StockAlert::Expired) {
+        expItem->setForeground(QColor("#e53e3e"));
+    } else if (a.kinds & StockAlert::Expiring) {
+        expItem->setForeground(QColor("#d97706"));
+    }
+    m_table->setItem(row, 4, expItem);
+
+    QStringList status;
+    if (a.kinds & StockAlert::OutOfStock) {
+        status << "⚠️ Out of stock";
+    }
+    if (a.kinds & StockAlert::LowStock) {
+        status << "⚡ Low";
+    }
+    if (a.kinds & StockAlert::Expired) {
+        status << "⛔ Expired";
+    }
+    if (a.kinds & StockAlert::Expiring) {
+        status << QString("⏳ %1 days").arg(QDate::currentDate().daysTo(a.nextExpiry));
+    }
+    m_table->setItem(row, 5, new QTableWidgetItem(status.join("  ")));
+}
+
+void AlertsWidget::onEditReorderLevel(int row, int /*col*/) {
+    auto* nameItem = m_table->item(row, 0);
+    auto* levelItem = m_table->item(row, 3);
+    if (!nameItem || !levelItem) {
+        return;
+    }
+
+    bool ok = false;
+    int level = QInputDialog::getInt(this, "Reorder Level",
+                                     QString("Reorder level for '%1':").arg(nameItem->text()),
+                                     levelItem->data(Qt::UserRole).toInt(), 0, 999999, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    if (!m_engine->setReorderLevel(nameItem->data(Qt::UserRole).toInt(), level)) {
+        QMessageBox::critical(this, "Error", Database::instance().lastError());
+    }
+}
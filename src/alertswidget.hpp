@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QComboBox>
+#include <QLabel>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QWidget>
+#include "models.hpp"
+
+class AlertEngine;
+
+class AlertsWidget : public QWidget {
+    Q_OBJECT
+  public:
+    explicit AlertsWidget(AlertEngine* engine, QWidget* parent = nullptr);
+    void refresh();
+
+  private slots:
+    void onEditReorderLevel(int row, int col);
+
+  private:
+    AlertEngine* m_engine;
+    QComboBox* m_filterCombo;
+    QSpinBox* m_horizonSpin;
+    QTableWidget* m_table;
+    QLabel* m_countLabel;
+
+    void setupUi();
+    void setRow(int row, const StockAlert& a);
+};
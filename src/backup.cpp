@@ -0,0 +1,181 @@
+#include "backup.hpp"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include "database.hpp"
+
+double BackupReport::megabytesPerSecond() const {
+    return copyMs > 0 ? (static_cast<double>(bytes) / (1024.0 * 1024.0)) / (copyMs / 1000.0) : 0.0;
+}
+
+QString BackupReport::summary() const {
+    if (!ok) {
+        return QString("Backup failed: %1").arg(error);
+    }
+    return QString("Backup: %1, %2 MB in %3 ms (%4 MB/s), %5 archives copied, %6 old copies removed")
+        .arg(QFileInfo(file).fileName())
+        .arg(static_cast<double>(bytes) / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(copyMs)
+        .arg(megabytesPerSecond(), 0, 'f', 1)
+        .arg(archivesCopied)
+        .arg(removed);
+}
+
+BackupJob::BackupJob(QObject* parent) : QObject(parent) {}
+
+BackupJob::~BackupJob() {
+    // The worker posts its result back to this object, so it must not outlive it
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void BackupJob::start() {
+    if (m_running || !Database::instance().isOpen()) {
+        return;
+    }
+    QString directory = Database::instance().setting("backup_directory");
+    if (directory.isEmpty()) {
+        return;
+    }
+    m_running = true;
+
+    int keep = qMax(1, Database::instance().setting("backup_keep", "48").toInt());
+
+    m_thread = QThread::create([this, directory, keep] {
+        BackupReport report;
+        QSqlDatabase db = Database::instance().db();
+        if (db.isOpen()) {
+            report = run(db, directory, keep);
+        } else {
+            report.error = Database::instance().lastError();
+        }
+        db = QSqlDatabase();
+        Database::instance().releaseThreadConnection();
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, report] {
+                m_running = false;
+                m_thread = nullptr;  // deleted via QThread::finished
+                emit finished(report);
+            },
+            Qt::QueuedConnection);
+    });
+    connect(m_thread, &QThread::finished, m_thread, &QObject::deleteLater);
+    m_thread->start(QThread::LowPriority);
+}
+
+// Writes schema `schema` of `db` to `target` through a temporary file that must pass quick_check first.
+static bool writeCopy(QSqlDatabase db, const QString& schema, const QString& target, QString* error) {
+    const QString part = target + ".part";
+    QFile::remove(part);  // left by an interrupted run; VACUUM INTO needs a new file
+
+    QSqlQuery q(db);
+    q.prepare(QString("VACUUM %1 INTO ?").arg(schema));
+    q.addBindValue(part);
+    if (!q.exec()) {
+        *error = q.lastError().text();
+        QFile::remove(part);
+        return false;
+    }
+
+    QString check;
+    {
+        const QString name =
+            QString("tella-backup-check-%1").arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+        QSqlDatabase copy = QSqlDatabase::addDatabase("QSQLITE", name);
+        copy.setDatabaseName(part);
+        copy.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!copy.open()) {
+            check = copy.lastError().text();
+        } else {
+            QSqlQuery pragma(copy);
+            if (!pragma.exec("PRAGMA quick_check")) {
+                check = pragma.lastError().text();
+            }
+            while (pragma.next()) {
+                if (pragma.value(0).toString() != "ok") {
+                    check += (check.isEmpty() ? "" : "; ") + pragma.value(0).toString();
+                }
+            }
+        }
+        copy.close();
+        copy = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+    if (!check.isEmpty()) {
+        *error = QString("quick_check of %1 failed: %2").arg(QFileInfo(target).fileName(), check);
+        QFile::remove(part);
+        return false;
+    }
+
+    QFile::remove(target);
+    if (!QFile::rename(part, target)) {
+        *error = QString("Could not rename %1").arg(part);
+        QFile::remove(part);
+        return false;
+    }
+    return true;
+}
+
+BackupReport BackupJob::run(QSqlDatabase db, const QString& directory, int keep) {
+    BackupReport r;
+    QElapsedTimer timer;
+    timer.start();
+
+    QDir dir(directory);
+    if (!dir.mkpath(".")) {
+        r.error = QString("Could not create %1").arg(directory);
+        return r;
+    }
+
+    const QString stem = QFileInfo(Database::instance().path()).completeBaseName();
+    r.file = dir.filePath(QString("%1-%2.db").arg(stem, QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+    if (!writeCopy(db, "main", r.file, &r.error)) {
+        r.elapsedMs = timer.elapsed();
+        return r;
+    }
+    r.bytes = QFileInfo(r.file).size();
+    r.copyMs = timer.elapsed();
+
+    // Archives only change when the maintenance job moves a year, so they are copied when newer than their copy
+    for (int year : Database::instance().archivedYears()) {
+        const QFileInfo source(Database::instance().archivePath(year));
+        const QFileInfo copy(dir.filePath(source.fileName()));
+        if (copy.exists() && copy.lastModified() >= source.lastModified()) {
+            continue;
+        }
+        if (!Database::instance().attachArchive(year) ||
+            !writeCopy(db, QString("archive_%1").arg(year), copy.filePath(), &r.error)) {
+            if (r.error.isEmpty()) {
+                r.error = Database::instance().lastError();
+            }
+            r.elapsedMs = timer.elapsed();
+            return r;
+        }
+        r.archivesCopied++;
+    }
+
+    // Timestamped names sort by age; the archives' "<name>-<year>.db" never match the pattern
+    const QString pattern = QString("%1-%2-%3.db").arg(stem, QString(8, '?'), QString(6, '?'));
+    const QStringList copies = dir.entryList({pattern}, QDir::Files, QDir::Name | QDir::Reversed);
+    for (qsizetype i = keep; i < copies.size(); ++i) {
+        if (dir.remove(copies[i])) {
+            r.removed++;
+        } else {
+            qWarning() << "Backup: could not remove" << dir.filePath(copies[i]);
+        }
+    }
+
+    r.ok = true;
+    r.elapsedMs = timer.elapsed();
+    return r;
+}
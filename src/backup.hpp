@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QtSql/QSqlDatabase>
+
+class QThread;
+
+struct BackupReport {
+    bool ok = false;
+    QString error;
+    QString file;           // the new copy
+    qint64 bytes = 0;        // its size
+    qint64 copyMs = 0;       // writing and checking it
+    int archivesCopied = 0;  // yearly archives that changed since their last copy
+    int removed = 0;         // older copies rotated out
+    qint64 elapsedMs = 0;
+
+    [[nodiscard]] double megabytesPerSecond() const;
+    [[nodiscard]] QString summary() const;
+};
+
+// Online backups of the live database, run off the GUI thread on its own connection.
+//
+// The copy is written with VACUUM INTO from a read snapshot. In WAL mode a reader never blocks the writer, so
+// sales keep committing while it runs and the copy is the database as of the moment it started. Each copy is
+// written under a temporary name, checked with PRAGMA quick_check and only then given its timestamped name
+// "<name>-yyyyMMdd-hhmmss.db" in the `backup_directory`; the newest `backup_keep` copies are kept. Yearly
+// archives are copied beside them whenever they changed.
+class BackupJob : public QObject {
+    Q_OBJECT
+  public:
+    explicit BackupJob(QObject* parent = nullptr);
+    ~BackupJob() override;
+
+    // Starts a backup in the background; ignored while one is running or when no directory is configured.
+    void start();
+    [[nodiscard]] bool isRunning() const { return m_running; }
+
+    // Runs synchronously on the calling thread using `db`.
+    static BackupReport run(QSqlDatabase db, const QString& directory, int keep);
+
+  signals:
+    void finished(const BackupReport& report);
+
+  private:
+    QThread* m_thread = nullptr;
+    bool m_running = false;
+};
@@ -0,0 +1,195 @@
+#include "barcodescanner.hpp"
+#include <QApplication>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QPlainTextEdit>
+#include <QTextEdit>
+#include <QWidget>
+#include <cmath>
+#include <utility>
+#include "database.hpp"
+
+static constexpr int kMinScanLength = 4;
+static constexpr double kMinGapThresholdMs = 10.0;
+static constexpr double kMaxGapThresholdMs = 40.0;
+
+static bool isTextInput(QObject* obj) {
+    // Spin boxes, combo boxes and date edits are backed by a QLineEdit with focus
+    return qobject_cast<QLineEdit*>(obj) || qobject_cast<QTextEdit*>(obj) || qobject_cast<QPlainTextEdit*>(obj);
+}
+
+BarcodeScanner::BarcodeScanner(QObject* parent) : QObject(parent) {
+    m_clock.start();
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, &QTimer::timeout, this, [this] {
+        if (looksLikeScan(m_lastKeyMs)) {
+            commit();
+        } else {
+            reset();
+        }
+    });
+    qApp->installEventFilter(this);
+}
+
+BarcodeScanner::~BarcodeScanner() { qApp->removeEventFilter(this); }
+
+void BarcodeScanner::setActive(bool active) {
+    m_active = active;
+    reset();
+}
+
+double BarcodeScanner::gapThreshold() const {
+    return qBound(kMinGapThresholdMs, m_gapMean + 3.0 * std::sqrt(m_gapVar), kMaxGapThresholdMs);
+}
+
+bool BarcodeScanner::looksLikeScan(qint64 nowMs) const {
+    if (m_buffer.size() < kMinScanLength) {
+        return false;
+    }
+    double threshold = gapThreshold();
+    double meanGap = static_cast<double>(m_gapSumMs) / static_cast<double>(m_buffer.size() - 1);
+    return meanGap <= threshold && m_gapMaxMs <= 2.0 * threshold && nowMs - m_lastKeyMs <= 2.0 * threshold;
+}
+
+static bool isTerminator(const QKeyEvent* ke) {
+    return ke->key() == Qt::Key_Return || ke->key() == Qt::Key_Enter || ke->key() == Qt::Key_Tab;
+}
+
+bool BarcodeScanner::eventFilter(QObject* obj, QEvent* event) {
+    if (!m_active || m_replaying ||
+        (event->type() != QEvent::KeyPress && event->type() != QEvent::ShortcutOverride)) {
+        return QObject::eventFilter(obj, event);
+    }
+
+    // Application filters see a key event once per receiver as it propagates; only the first, the focus
+    // widget, counts. Dialogs keep their own keys.
+    QWidget* focus = QApplication::focusWidget();
+    if (obj != focus || QApplication::activeModalWidget()) {
+        return QObject::eventFilter(obj, event);
+    }
+
+    auto* ke = static_cast<QKeyEvent*>(event);
+    qint64 now = ke->timestamp() != 0 ? static_cast<qint64>(ke->timestamp()) : m_clock.elapsed();
+    bool textInput = isTextInput(obj);
+
+    if (event->type() == QEvent::ShortcutOverride) {
+        // Claim the terminator of a scan before an Enter shortcut can act on it; the key press follows
+        if (isTerminator(ke) && looksLikeScan(now)) {
+            ke->accept();
+            return true;
+        }
+        return QObject::eventFilter(obj, event);
+    }
+
+    if (isTerminator(ke)) {
+        if (m_buffer.isEmpty()) {
+            return QObject::eventFilter(obj, event);
+        }
+        if (!looksLikeScan(now)) {
+            reset();
+            return QObject::eventFilter(obj, event);
+        }
+        commit();
+        return true;
+    }
+
+    QString ch = ke->text();
+    bool printable = ch.size() == 1 && ch[0].isPrint() && ch[0] != ' ' &&
+                     !(ke->modifiers() & (Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier));
+    if (!printable) {
+        reset();
+        return QObject::eventFilter(obj, event);
+    }
+
+    if (!m_buffer.isEmpty() && (now - m_lastKeyMs > 2.0 * gapThreshold() || obj != m_target)) {
+        reset();
+    }
+    if (!m_buffer.isEmpty()) {
+        qint64 gap = qMax<qint64>(0, now - m_lastKeyMs);
+        m_gapSumMs += gap;
+        m_gapMaxMs = qMax(m_gapMaxMs, gap);
+    }
+    m_buffer += ch;
+    m_target = obj;
+    m_lastKeyMs = now;
+    m_idleTimer.start(static_cast<int>(std::ceil(3.0 * gapThreshold())));
+
+    // Text fields keep their keys (it may be someone typing); anything else would act on them, so the key is
+    // held until the burst is decided
+    if (textInput) {
+        return false;
+    }
+    m_held.emplace_back(ke->clone());
+    return true;
+}
+
+void BarcodeScanner::commit() {
+    QString code = m_buffer;
+
+    // Learn this scanner's rhythm from the accepted burst
+    double meanGap = static_cast<double>(m_gapSumMs) / static_cast<double>(m_buffer.size() - 1);
+    double delta = meanGap - m_gapMean;
+    m_gapMean += 0.25 * delta;
+    m_gapVar = 0.75 * (m_gapVar + 0.25 * delta * delta);
+
+    // The keys went into a line edit as they came; take the code back out
+    if (auto* edit = qobject_cast<QLineEdit*>(m_target.data())) {
+        QString text = edit->text();
+        if (text.endsWith(code)) {
+            edit->setText(text.chopped(code.size()));
+        }
+    }
+
+    m_held.clear();  // the scan's keys were never meant for the widget
+    reset();
+    emit scanned(code);
+}
+
+void BarcodeScanner::reset() {
+    m_idleTimer.stop();
+    m_buffer.clear();
+    m_lastKeyMs = -1;
+    m_gapSumMs = 0;
+    m_gapMaxMs = 0;
+
+    // Not a scan: the widget gets the keys it was typed, before whatever key ended the burst
+    const auto held = std::exchange(m_held, {});
+    const QPointer<QObject> target = std::exchange(m_target, nullptr);
+    m_replaying = true;
+    for (const auto& ke : held) {
+        if (target) {
+            QCoreApplication::sendEvent(target, ke.get());
+        }
+    }
+    m_replaying = false;
+}
+
+// =================== BarcodeIndex ===================
+
+void BarcodeIndex::rebuild() {
+    m_idByBarcode.clear();
+    m_barcodeById.clear();
+    apply({}, Database::instance().getProductBarcodes({}));
+}
+
+void BarcodeIndex::refresh(const QList<int>& productIds) {
+    if (productIds.isEmpty()) {
+        return;
+    }
+    apply(productIds, Database::instance().getProductBarcodes(productIds));
+}
+
+void BarcodeIndex::apply(const QList<int>& productIds, const QHash<int, QString>& barcodes) {
+    // Drop the old codes of the refreshed products; deleted products simply have no new one
+    for (int id : productIds) {
+        auto it = m_barcodeById.find(id);
+        if (it != m_barcodeById.end()) {
+            m_idByBarcode.remove(it.value());
+            m_barcodeById.erase(it);
+        }
+    }
+    for (auto it = barcodes.cbegin(); it != barcodes.cend(); ++it) {
+        m_idByBarcode.insert(it.value(), it.key());
+        m_barcodeById.insert(it.key(), it.value());
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QKeyEvent>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+// Picks HID barcode scanner input out of the ordinary key stream, application-wide.
+//
+// A scanner "types" a code as a burst of keys a few milliseconds apart followed by Enter or Tab; people
+// type tens of milliseconds apart. Keys are timed from the event timestamps, and a burst is accepted
+// when it is long enough and its gaps fit the scanner's learned gap statistics. Acceptance happens on
+// the terminator itself, with no waiting. Scanners configured without a terminator are committed after
+// a short idle gap instead.
+//
+// When a text field has focus the keys still reach it, and an accepted code is taken back out of a
+// QLineEdit. Other widgets never see the keys of a scan: their keys are held until the burst is decided,
+// and replayed to them in order when it turns out to be someone typing.
+class BarcodeScanner : public QObject {
+    Q_OBJECT
+  public:
+    explicit BarcodeScanner(QObject* parent = nullptr);
+    ~BarcodeScanner() override;
+
+    // Only an active scanner looks at keys; the POS turns it on while it is visible.
+    void setActive(bool active);
+    [[nodiscard]] bool isActive() const { return m_active; }
+
+  signals:
+    void scanned(const QString& code);
+
+  protected:
+    bool eventFilter(QObject* obj, QEvent* event) override;
+
+  private:
+    bool m_active = false;
+    QString m_buffer;
+    QPointer<QObject> m_target;  // widget the burst was typed into
+    std::vector<std::unique_ptr<QKeyEvent>> m_held;  // keys kept from a widget that is not a text field
+    bool m_replaying = false;
+    qint64 m_lastKeyMs = -1;
+    qint64 m_gapSumMs = 0;
+    qint64 m_gapMaxMs = 0;
+    QElapsedTimer m_clock;  // fallback when the platform gives no event timestamps
+    QTimer m_idleTimer;
+
+    // Exponentially weighted mean/variance of the per-scan mean gap, seeded for a typical USB scanner
+    double m_gapMean = 12.0;
+    double m_gapVar = 16.0;
+
+    [[nodiscard]] double gapThreshold() const;
+    [[nodiscard]] bool looksLikeScan(qint64 nowMs) const;
+    void commit();
+    void reset();
+};
+
+// Barcode -> product id, held in memory and refreshed for the products a write touched.
+class BarcodeIndex {
+  public:
+    void rebuild();
+    void refresh(const QList<int>& productIds);
+    [[nodiscard]] int productId(const QString& barcode) const { return m_idByBarcode.value(barcode, 0); }
+
+  private:
+    QHash<QString, int> m_idByBarcode;
+    QHash<int, QString> m_barcodeById;
+
+    void apply(const QList<int>& productIds, const QHash<int, QString>& barcodes);
+};
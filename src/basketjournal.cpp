@@ -0,0 +1,123 @@
+#include "basketjournal.hpp"
+#include <QDebug>
+#include <utility>
+#include "database.hpp"
+
+BasketJournal::BasketJournal(BasketModel* model, int userId, QObject* parent)
+    : QObject(parent), m_model(model), m_userId(userId) {
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kFlushDelayMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &BasketJournal::flush);
+    connect(m_model, &BasketModel::lineChanged, this, &BasketJournal::onLineChanged);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &BasketJournal::onReset);
+}
+
+BasketJournal::~BasketJournal() { flush(); }
+
+void BasketJournal::onLineChanged(int productId) {
+    if (m_loading) {
+        return;
+    }
+
+    BasketJournalEntry entry;
+    entry.productId = productId;
+    int row = m_model->rowOf(productId);
+    if (row >= 0) {
+        const BasketLine& line = m_model->lines()[row];
+        entry.quantity = line.quantity;
+        entry.line = line.toJson();
+    } else {
+        entry.line["product_id"] = productId;  // removed
+    }
+    m_pending.insert(productId, entry);
+
+    // Not restarted by later changes, so a steady stream of scans is still written every kFlushDelayMs
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void BasketJournal::onReset() {
+    if (m_loading) {
+        return;
+    }
+
+    if (m_model->isEmpty()) {
+        // Cleared: the basket is gone, not parked
+        m_pending.clear();
+        m_flushTimer.stop();
+        if (m_basketId != 0 && !Database::instance().deleteHeldBasket(m_basketId)) {
+            qWarning() << "Could not drop held basket" << m_basketId << ":" << Database::instance().lastError();
+        }
+        m_basketId = 0;
+        return;
+    }
+
+    for (const auto& line : m_model->lines()) {
+        onLineChanged(line.productId);
+    }
+}
+
+bool BasketJournal::flush() {
+    m_flushTimer.stop();
+    if (m_pending.isEmpty()) {
+        return true;
+    }
+
+    auto& db = Database::instance();
+    if (m_basketId == 0) {
+        m_basketId = db.createHeldBasket(m_userId, true);
+        if (m_basketId == 0) {
+            qWarning() << "Could not create held basket:" << db.lastError();
+            return false;
+        }
+    }
+
+    QList<BasketJournalEntry> entries;
+    entries.reserve(m_pending.size());
+    for (auto entry : std::as_const(m_pending)) {
+        entry.basketId = m_basketId;
+        entries << entry;
+    }
+    if (!db.appendBasketJournal(entries)) {
+        // Kept pending; the next change or flush retries
+        qWarning() << "Could not journal basket" << m_basketId << ":" << db.lastError();
+        return false;
+    }
+    m_pending.clear();
+    return true;
+}
+
+bool BasketJournal::resume(int basketId, const QList<BasketLine>& lines) {
+    if (!Database::instance().setHeldBasketActive(basketId, true)) {
+        return false;
+    }
+    m_pending.clear();
+    m_flushTimer.stop();
+    m_basketId = basketId;
+    m_loading = true;
+    m_model->setLines(lines);
+    m_loading = false;
+    return true;
+}
+
+int BasketJournal::detach() {
+    flush();
+    int id = m_basketId;
+    m_basketId = 0;
+    return id;
+}
+
+bool BasketJournal::park(const QString& label) {
+    if (!flush()) {
+        return false;
+    }
+    if (m_basketId != 0 && !Database::instance().setHeldBasketActive(m_basketId, false, label)) {
+        return false;
+    }
+    m_basketId = 0;
+    m_loading = true;
+    m_model->clear();
+    m_loading = false;
+    return true;
+}
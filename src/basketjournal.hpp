@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include "basketmodel.hpp"
+#include "models.hpp"
+
+// Mirrors a BasketModel into the held_basket_journal table so the basket survives a crash and can be
+// parked. Each change is snapshotted in memory and the pending snapshots are written in one transaction
+// a moment after the first of them, so scanning never waits on the disk. The basket row itself is only
+// created by the first write.
+class BasketJournal : public QObject {
+    Q_OBJECT
+  public:
+    BasketJournal(BasketModel* model, int userId, QObject* parent = nullptr);
+    ~BasketJournal() override;
+
+    // Writes the pending changes now.
+    bool flush();
+    // Takes over a held basket and loads `lines` into the model without journaling them again.
+    bool resume(int basketId, const QList<BasketLine>& lines);
+    // Stops journaling the current basket without deleting it, e.g. while its sale is being written.
+    // Returns its id, or 0 if nothing was journaled.
+    int detach();
+    // Parks the current basket under `label` and empties the model.
+    bool park(const QString& label);
+
+    [[nodiscard]] int basketId() const { return m_basketId; }
+
+    static constexpr int kFlushDelayMs = 250;
+
+  private:
+    BasketModel* m_model;
+    int m_userId;
+    int m_basketId = 0;
+    bool m_loading = false;                     // model changes we made ourselves
+    QHash<int, BasketJournalEntry> m_pending;  // product id -> newest snapshot
+    QTimer m_flushTimer;
+
+    void onLineChanged(int productId);
+    void onReset();
+};
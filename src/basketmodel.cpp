@@ -0,0 +1,253 @@
+#include "basketmodel.hpp"
+#include <QColor>
+#include <QFont>
+
+static QString fmtMoney(Money amount) { return QString::number(amount.toDouble(), 'f', 2); }
+
+TransactionItem BasketLine::toTransactionItem() const {
+    TransactionItem item;
+    item.productId = productId;
+    item.genericName = genericName;
+    item.brandName = brandName;
+    item.barcode = barcode;
+    item.quantity = quantity;
+    item.sellingPrice = unitPrice;
+    item.costPrice = costPrice;
+    return item;
+}
+
+QJsonObject BasketLine::toJson() const {
+    QJsonObject obj;
+    obj["product_id"] = productId;
+    obj["generic_name"] = genericName;
+    obj["brand_name"] = brandName;
+    obj["barcode"] = barcode;
+    obj["unit_price_cents"] = unitPrice.cents();
+    obj["cost_price"] = costPrice.toDouble();
+    obj["quantity"] = quantity;
+    obj["max_quantity"] = maxQuantity;
+    return obj;
+}
+
+BasketLine BasketLine::fromJson(const QJsonObject& obj) {
+    BasketLine line;
+    line.productId = obj["product_id"].toInt();
+    line.genericName = obj["generic_name"].toString();
+    line.brandName = obj["brand_name"].toString();
+    line.barcode = obj["barcode"].toString();
+    line.unitPrice = Money::fromCents(obj["unit_price_cents"].toInteger());
+    line.costPrice = Money::fromDouble(obj["cost_price"].toDouble());
+    line.quantity = obj["quantity"].toInt();
+    line.maxQuantity = obj["max_quantity"].toInt();
+    return line;
+}
+
+BasketModel::BasketModel(QObject* parent) : QAbstractTableModel(parent) {}
+
+BasketModel::AddResult BasketModel::add(const Product& product) {
+    int row = rowOf(product.id);
+    if (row >= 0) {
+        BasketLine& line = m_lines[row];
+        if (line.quantity >= line.maxQuantity) {
+            return AddResult::AtLimit;
+        }
+        line.quantity++;
+        emit dataChanged(index(row, QuantityColumn), index(row, SubtotalColumn));
+        setTotal(m_total + line.unitPrice);
+        emit lineChanged(product.id);
+        return AddResult::Incremented;
+    }
+    if (product.quantity <= 0) {
+        return AddResult::AtLimit;
+    }
+
+    BasketLine line;
+    line.productId = product.id;
+    line.genericName = product.genericName;
+    line.brandName = product.brandName;
+    line.barcode = product.barcode;
+    line.unitPrice = product.sellingPrice;
+    line.costPrice = product.costPrice;
+    line.quantity = 1;
+    line.maxQuantity = product.quantity;
+
+    row = static_cast<int>(m_lines.size());
+    beginInsertRows(QModelIndex(), row, row);
+    m_lines.append(line);
+    m_rowById.insert(line.productId, row);
+    endInsertRows();
+    setTotal(m_total + line.unitPrice);
+    emit lineChanged(line.productId);
+    return AddResult::Added;
+}
+
+bool BasketModel::setQuantity(int row, int quantity) {
+    if (row < 0 || row >= m_lines.size()) {
+        return false;
+    }
+    BasketLine& line = m_lines[row];
+    int clamped = qBound(1, quantity, qMax(1, line.maxQuantity));
+    if (clamped != line.quantity) {
+        Money before = line.subtotal();
+        line.quantity = clamped;
+        emit dataChanged(index(row, QuantityColumn), index(row, SubtotalColumn));
+        setTotal(m_total - before + line.subtotal());
+        emit lineChanged(line.productId);
+    }
+    if (clamped != quantity) {
+        emit quantityClamped(line.productId, line.maxQuantity);
+        return false;
+    }
+    return true;
+}
+
+void BasketModel::removeLine(int row) {
+    if (row < 0 || row >= m_lines.size()) {
+        return;
+    }
+    Money subtotal = m_lines[row].subtotal();
+    int productId = m_lines[row].productId;
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rowById.remove(m_lines[row].productId);
+    m_lines.removeAt(row);
+    // Only the lines after the removed one move up
+    for (int i = row; i < m_lines.size(); ++i) {
+        m_rowById[m_lines[i].productId] = i;
+    }
+    endRemoveRows();
+    setTotal(m_total - subtotal);
+    emit lineChanged(productId);
+}
+
+void BasketModel::clear() { setLines({}); }
+
+void BasketModel::setLines(const QList<BasketLine>& lines) {
+    beginResetModel();
+    m_lines.clear();
+    m_rowById.clear();
+    QList<int> clamped;
+    for (const auto& line : lines) {
+        // Merge duplicates so the id -> row map stays one-to-one. The later line's stock is the fresher
+        // snapshot, and the merged quantity may not go past it.
+        int row = m_rowById.value(line.productId, -1);
+        if (row >= 0) {
+            BasketLine& merged = m_lines[row];
+            merged.maxQuantity = line.maxQuantity;
+            merged.quantity += line.quantity;
+            if (merged.quantity > merged.maxQuantity) {
+                merged.quantity = qMax(1, merged.maxQuantity);
+                if (!clamped.contains(row)) {
+                    clamped << row;
+                }
+            }
+        } else {
+            m_rowById.insert(line.productId, static_cast<int>(m_lines.size()));
+            m_lines.append(line);
+        }
+    }
+    Money total;
+    for (const auto& line : m_lines) {
+        total += line.subtotal();
+    }
+    endResetModel();
+    setTotal(total);
+    for (int row : clamped) {
+        emit quantityClamped(m_lines[row].productId, m_lines[row].maxQuantity);
+    }
+}
+
+void BasketModel::setTotal(Money total) {
+    if (total == m_total) {
+        return;
+    }
+    m_total = total;
+    emit totalChanged(m_total);
+}
+
+int BasketModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(m_lines.size());
+}
+
+int BasketModel::columnCount(const QModelIndex& parent) const { return parent.isValid() ? 0 : ColumnCount; }
+
+QVariant BasketModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return {};
+    }
+    static const QStringList headers = {"Product", "Brand", "Price", "Qty", "Subtotal", "✕"};
+    return headers.value(section);
+}
+
+QVariant BasketModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_lines.size()) {
+        return {};
+    }
+    const BasketLine& line = m_lines[index.row()];
+
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        switch (index.column()) {
+            case NameColumn:
+                return line.genericName;
+            case BrandColumn:
+                return line.brandName;
+            case PriceColumn:
+                return fmtMoney(line.unitPrice);
+            case QuantityColumn:
+                return line.quantity;
+            case SubtotalColumn:
+                return fmtMoney(line.subtotal());
+            case RemoveColumn:
+                return role == Qt::DisplayRole ? QVariant("✕") : QVariant();
+            default:
+                return {};
+        }
+    }
+    if (role == Qt::TextAlignmentRole) {
+        switch (index.column()) {
+            case PriceColumn:
+            case SubtotalColumn:
+                return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+            case QuantityColumn:
+            case RemoveColumn:
+                return static_cast<int>(Qt::AlignCenter);
+            default:
+                return {};
+        }
+    }
+    if (index.column() == RemoveColumn) {
+        if (role == Qt::ForegroundRole) {
+            return QColor("#e53e3e");
+        }
+        if (role == Qt::FontRole) {
+            return QFont("", -1, QFont::Bold);
+        }
+        if (role == Qt::ToolTipRole) {
+            return QString("Remove from receipt");
+        }
+    }
+    if (role == Qt::UserRole) {
+        return line.productId;
+    }
+    return {};
+}
+
+bool BasketModel::setData(const QModelIndex& index, const QVariant& value, int role) {
+    if (!index.isValid() || role != Qt::EditRole || index.column() != QuantityColumn) {
+        return false;
+    }
+    bool ok = false;
+    int quantity = value.toInt(&ok);
+    if (!ok) {
+        return false;
+    }
+    setQuantity(index.row(), quantity);
+    return true;
+}
+
+Qt::ItemFlags BasketModel::flags(const QModelIndex& index) const {
+    Qt::ItemFlags f = QAbstractTableModel::flags(index);
+    if (index.column() == QuantityColumn) {
+        f |= Qt::ItemIsEditable;
+    }
+    return f;
+}
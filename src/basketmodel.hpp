@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include "models.hpp"
+
+// One line of the till basket. Prices are Money, so the running total never drifts.
+struct BasketLine {
+    int productId = 0;
+    QString genericName;
+    QString brandName;
+    QString barcode;
+    Money unitPrice;
+    Money costPrice;
+    int quantity = 0;
+    int maxQuantity = 0;  // stock on hand when the line was added
+
+    [[nodiscard]] Money subtotal() const { return unitPrice * quantity; }
+    [[nodiscard]] TransactionItem toTransactionItem() const;
+    [[nodiscard]] QJsonObject toJson() const;
+    static BasketLine fromJson(const QJsonObject& obj);
+};
+
+// The POS basket. Lines are found by product id through a hash and the total is kept up to date on every
+// change, so adding, editing or removing a line costs the same with 5 lines or 500.
+class BasketModel : public QAbstractTableModel {
+    Q_OBJECT
+  public:
+    enum Column { NameColumn, BrandColumn, PriceColumn, QuantityColumn, SubtotalColumn, RemoveColumn, ColumnCount };
+    enum class AddResult { Added, Incremented, AtLimit };
+
+    explicit BasketModel(QObject* parent = nullptr);
+
+    // Adds one of `product`, or bumps its existing line.
+    AddResult add(const Product& product);
+    // Clamped to [1, maxQuantity]; returns false if the requested quantity had to be clamped.
+    bool setQuantity(int row, int quantity);
+    void removeLine(int row);
+    void clear();
+    // Replaces the basket; lines for the same product are merged and clamped to the later line's maxQuantity.
+    void setLines(const QList<BasketLine>& lines);
+
+    [[nodiscard]] const QList<BasketLine>& lines() const { return m_lines; }
+    [[nodiscard]] bool isEmpty() const { return m_lines.isEmpty(); }
+    [[nodiscard]] Money total() const { return m_total; }
+    [[nodiscard]] int rowOf(int productId) const { return m_rowById.value(productId, -1); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+  signals:
+    void totalChanged(Money total);
+    // A line was added, re-quantified or removed. Whole-basket changes (clear, setLines) emit modelReset.
+    void lineChanged(int productId);
+    void quantityClamped(int productId, int maxQuantity);
+
+  private:
+    QList<BasketLine> m_lines;
+    QHash<int, int> m_rowById;  // product id -> row
+    Money m_total;
+
+    void setTotal(Money total);
+};
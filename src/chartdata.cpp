@@ -0,0 +1,58 @@
+#include "chartdata.hpp"
+#include <QWidget>
+#include <QtCharts/QChart>
+#include <cmath>
+
+QList<QPointF> downsampleLttb(const QList<QPointF>& points, int threshold) {
+    const qsizetype n = points.size();
+    if (threshold < 3 || n <= threshold) {
+        return points;
+    }
+
+    QList<QPointF> out;
+    out.reserve(threshold);
+    out.append(points.first());
+
+    const double bucketSize = static_cast<double>(n - 2) / (threshold - 2);
+    qsizetype a = 0;  // index of the previously selected point
+
+    for (int i = 0; i < threshold - 2; ++i) {
+        // Average of the next bucket is the third corner of the triangle
+        qsizetype avgStart = static_cast<qsizetype>(std::floor((i + 1) * bucketSize)) + 1;
+        qsizetype avgEnd = qMin<qsizetype>(static_cast<qsizetype>(std::floor((i + 2) * bucketSize)) + 1, n);
+        double avgX = 0.0;
+        double avgY = 0.0;
+        for (qsizetype j = avgStart; j < avgEnd; ++j) {
+            avgX += points[j].x();
+            avgY += points[j].y();
+        }
+        const double count = static_cast<double>(qMax<qsizetype>(1, avgEnd - avgStart));
+        avgX /= count;
+        avgY /= count;
+
+        // Pick the point of the current bucket forming the largest triangle with the previous pick
+        qsizetype rangeStart = static_cast<qsizetype>(std::floor(i * bucketSize)) + 1;
+        qsizetype rangeEnd = static_cast<qsizetype>(std::floor((i + 1) * bucketSize)) + 1;
+        const QPointF& pa = points[a];
+        double maxArea = -1.0;
+        qsizetype next = rangeStart;
+        for (qsizetype j = rangeStart; j < rangeEnd; ++j) {
+            double area = std::abs((pa.x() - avgX) * (points[j].y() - pa.y()) - (pa.x() - points[j].x()) * (avgY - pa.y()));
+            if (area > maxArea) {
+                maxArea = area;
+                next = j;
+            }
+        }
+        out.append(points[next]);
+        a = next;
+    }
+
+    out.append(points.last());
+    return out;
+}
+
+int chartPointBudget(const QWidget* view) { return qMax(50, view->width() / 2); }
+
+void setChartAnimated(QChart* chart, int pointCount) {
+    chart->setAnimationOptions(pointCount > kChartAnimationLimit ? QChart::NoAnimation : QChart::SeriesAnimations);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QList>
+#include <QPointF>
+
+class QChart;
+class QWidget;
+
+// Above this many points per chart, series animations cost more than they show and are switched off.
+constexpr int kChartAnimationLimit = 60;
+
+// Largest-Triangle-Three-Buckets downsampling: keeps the first and last point and, from each of
+// `threshold - 2` equal buckets in between, the point that best preserves the visual shape.
+// `points` must be sorted by x. Returns `points` unchanged when it already fits.
+QList<QPointF> downsampleLttb(const QList<QPointF>& points, int threshold);
+
+// How many points a line chart in `view` can usefully draw: about one every two pixels.
+int chartPointBudget(const QWidget* view);
+
+// Series animations only for small charts.
+void setChartAnimated(QChart* chart, int pointCount);
@@ -0,0 +1,222 @@
+#include "cli.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <cstdio>
+#include <cstring>
+#include "database.hpp"
+#include "deltasync.hpp"
+#include "escpos.hpp"
+#include "exporters.hpp"
+#include "loadtest.hpp"
+
+bool isCliInvocation(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        for (const char* option :
+             {"--report", "--receipt", "--load-test", "--load-worker", "--export-changes", "--import-changes"}) {
+            const size_t length = std::strlen(option);
+            if (std::strncmp(argv[i], option, length) == 0 && (argv[i][length] == '\0' || argv[i][length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int runCli(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    // Same names as the GUI so the default database path resolves to the till's file
+    app.setApplicationName("Tella POS");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("Tella POS");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Tella POS headless reports");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption reportOpt("report", "Report to print: daily, monthly, sales or stockcard.", "name");
+    QCommandLineOption fromOpt("from", "First day, yyyy-MM-dd (default: today).", "date");
+    QCommandLineOption toOpt("to", "Last day, yyyy-MM-dd (default: same as --from).", "date");
+    QCommandLineOption formatOpt("format", "Output format: csv or json (default: csv).", "format", "csv");
+    QCommandLineOption productOpt("product", "Stock card of a single product id.", "id");
+    QCommandLineOption dbOpt("db", "Database file (default: the till's database).", "path");
+    QCommandLineOption receiptOpt("receipt", "Write the ESC/POS receipt of a transaction id instead.", "id");
+    QCommandLineOption allBranchesOpt("all-branches", "Include sales imported from other branches in the report.");
+    QCommandLineOption exportOpt("export-changes",
+                                 "Write the changes not yet sent to --peer into a delta bundle in this directory.",
+                                 "directory");
+    QCommandLineOption peerOpt("peer", "Who the exported bundle is for (default: shared).", "name", "shared");
+    QCommandLineOption importOpt("import-changes", "Apply a delta bundle; may be given more than once.", "file");
+    QCommandLineOption loadTestOpt("load-test",
+                                   "Run this many till processes against a new database (--db, default a temporary "
+                                   "file) and check that no sale is lost.",
+                                   "processes");
+    QCommandLineOption countOpt("count", "Operations per load-test process (default: 200).", "n", "200");
+    QCommandLineOption loadWorkerOpt("load-worker", "One load-test process.", "role");
+    loadWorkerOpt.setFlags(QCommandLineOption::HiddenFromHelp);
+    QCommandLineOption startOpt("start", "Load-test start time, epoch milliseconds.", "ms");
+    startOpt.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions(
+        {reportOpt, fromOpt, toOpt, formatOpt, productOpt, dbOpt, receiptOpt, allBranchesOpt, exportOpt, peerOpt,
+         importOpt, loadTestOpt, countOpt, loadWorkerOpt, startOpt});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto usageError = [&](const QString& message) {
+        err << "tella: " << message << "\n";
+        err.flush();
+        return 2;
+    };
+
+    auto openDatabase = [&](bool readOnly) {
+        QString dbPath = parser.value(dbOpt);
+        if (dbPath.isEmpty()) {
+            dbPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/tella.db";
+        }
+        if (!QFile::exists(dbPath)) {
+            err << "tella: database not found: " << QDir::toNativeSeparators(dbPath) << "\n";
+            return false;
+        }
+        if (!Database::instance().open(dbPath, readOnly)) {
+            err << "tella: failed to open database: " << Database::instance().lastError() << "\n";
+            return false;
+        }
+        return true;
+    };
+
+    // ---- Load test ----
+    // Several tills writing one file at once; see loadtest.hpp
+    if (parser.isSet(loadTestOpt) || parser.isSet(loadWorkerOpt)) {
+        bool ok = false;
+        const int count = parser.value(countOpt).toInt(&ok);
+        if (!ok || count <= 0) {
+            return usageError("--count expects a positive number");
+        }
+        if (parser.isSet(loadWorkerOpt)) {
+            return runLoadWorker(parser.value(loadWorkerOpt), parser.value(dbOpt), count,
+                                 parser.value(startOpt).toLongLong());
+        }
+        LoadTestOptions options;
+        options.processes = parser.value(loadTestOpt).toInt(&ok);
+        if (!ok || options.processes <= 0 || options.processes > 64) {
+            return usageError("--load-test expects 1 to 64 processes");
+        }
+        options.operations = count;
+        options.databasePath = parser.value(dbOpt);
+        return runLoadTest(options);
+    }
+
+    // ---- Delta bundles ----
+    // Exchanging changes with other branches writes to the file, so it opens the database like the till does
+    if (parser.isSet(exportOpt) || parser.isSet(importOpt)) {
+        if (!openDatabase(false)) {
+            return 1;
+        }
+        QTextStream out(stdout);
+        bool ok = true;
+        for (const QString& file : parser.values(importOpt)) {
+            DeltaReport report = DeltaSync::importBundle(file);
+            out << report.summary() << "\n";
+            ok = ok && report.ok && report.failed == 0;
+        }
+        if (parser.isSet(exportOpt)) {
+            DeltaReport report = DeltaSync::exportBundle(parser.value(exportOpt), parser.value(peerOpt));
+            out << report.summary() << "\n";
+            ok = ok && report.ok;
+        }
+        out.flush();
+        Database::instance().close();
+        return ok ? 0 : 1;
+    }
+
+    // ---- Receipt ----
+    // The exact bytes the till sends to an ESC/POS receipt device, for checking printer output
+    if (parser.isSet(receiptOpt)) {
+        bool ok = false;
+        int id = parser.value(receiptOpt).toInt(&ok);
+        if (!ok || id <= 0) {
+            return usageError("--receipt expects a transaction id");
+        }
+        if (!openDatabase(true)) {
+            return 1;
+        }
+        Transaction t = Database::instance().getTransactionById(id);
+        Database::instance().close();
+        if (t.id == 0) {
+            err << "tella: no transaction #" << id << "\n";
+            return 1;
+        }
+        QByteArray bytes = escPosReceipt(t);
+        if (std::fwrite(bytes.constData(), 1, static_cast<size_t>(bytes.size()), stdout) !=
+            static_cast<size_t>(bytes.size())) {
+            return 1;
+        }
+        return std::fflush(stdout) == 0 ? 0 : 1;
+    }
+
+    // ---- Arguments ----
+    QDate from = parser.isSet(fromOpt) ? QDate::fromString(parser.value(fromOpt), Qt::ISODate) : QDate::currentDate();
+    QDate to = parser.isSet(toOpt) ? QDate::fromString(parser.value(toOpt), Qt::ISODate) : from;
+    if (!from.isValid() || !to.isValid()) {
+        return usageError("dates must be in yyyy-MM-dd format");
+    }
+    if (from > to) {
+        return usageError("--from is after --to");
+    }
+
+    ExportJob::Request request;
+    request.fromDate = from;
+    request.toDate = to;
+
+    const QString report = parser.value(reportOpt).toLower();
+    if (report == "daily") {
+        request.source = ExportJob::Source::DailyTotals;
+    } else if (report == "monthly") {
+        request.source = ExportJob::Source::MonthlyTotals;
+    } else if (report == "sales") {
+        request.source = ExportJob::Source::ProductSales;
+        request.period = SalesPeriod::Daily;
+    } else if (report == "stockcard") {
+        request.source = ExportJob::Source::StockCard;
+        if (parser.isSet(productOpt)) {
+            bool ok = false;
+            request.productId = parser.value(productOpt).toInt(&ok);
+            if (!ok || request.productId <= 0) {
+                return usageError("--product expects a product id");
+            }
+        }
+    } else {
+        return usageError(QString("unknown report '%1' (expected daily, monthly, sales or stockcard)").arg(report));
+    }
+
+    std::unique_ptr<TableSink> sink;
+    const QString format = parser.value(formatOpt).toLower();
+    if (format == "csv") {
+        sink = std::make_unique<CsvSink>(stdout);
+    } else if (format == "json") {
+        sink = std::make_unique<JsonSink>(stdout);
+    } else {
+        return usageError(QString("unknown format '%1' (expected csv or json)").arg(format));
+    }
+
+    // ---- Database ----
+    if (!openDatabase(true)) {
+        return 1;
+    }
+    Database::instance().setReportAllBranches(parser.isSet(allBranchesOpt));
+
+    // ---- Report ----
+    QString message;
+    bool ok = ExportJob::write(request, *sink, [](int) { return true; }, &message);
+    sink.reset();
+    Database::instance().close();
+    if (!ok) {
+        err << "tella: " << message << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Headless reporting: `tella --report daily|monthly|sales|stockcard [--from] [--to] [--format csv|json]`.
+// Runs under QCoreApplication with a read-only database and writes the report to stdout, so it needs
+// no display and never loads widget, chart or print code. `tella --receipt ID` writes the ESC/POS bytes of a
+// transaction's receipt to stdout the same way. `tella --export-changes DIR` / `--import-changes FILE` exchange
+// delta bundles with other branches, and `tella --load-test N` runs the multi-till load test.
+
+// True when the arguments ask for a headless mode (checked before any QApplication exists).
+bool isCliInvocation(int argc, char* argv[]);
+
+// Returns the process exit code.
+int runCli(int argc, char* argv[]);
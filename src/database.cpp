@@ -1,36 +1,110 @@
 #include "database.hpp"
+#include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QRandomGenerator>
 #include <QStringList>
+#include <QThread>
 #include <QTimeZone>
+#include <QUrl>
+#include <QUuid>
 #include <QVariant>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include "salesstore.hpp"
 
 Database& Database::instance() {
     static Database db;
     return db;
 }
 
-bool Database::open(const QString& path) {
+thread_local QString Database::m_lastError;
+thread_local int Database::m_txDepth = 0;
+thread_local QList<QPair<int, std::function<void()>>> Database::m_afterCommit;
+thread_local int Database::m_replaying = 0;
+thread_local bool Database::m_lockTimedOut = false;
+thread_local bool Database::m_replayStock = false;
+
+// How long one statement waits inside SQLite for another connection's lock. Kept short: waiting for the write
+// lock is done by beginTransaction, with jitter, and everything else only meets a lock for moments.
+static constexpr int kBusyTimeoutMs = 250;
+// How long beginTransaction keeps trying for the write lock, and the bounds of its pauses between attempts. A
+// brief wait is for the write queue, which tries its batch again from its timer so the till stays responsive.
+static constexpr int kWriteLockWaitMs = 10000;
+static constexpr int kBriefLockWaitMs = 250;
+static constexpr int kRetryBasePauseMs = 2;
+static constexpr int kRetryMaxPauseMs = 100;
+
+// URI filenames let archives be attached read-only
+static QString connectOptions(bool readOnly) {
+    QString options = QString("QSQLITE_OPEN_URI;QSQLITE_BUSY_TIMEOUT=%1").arg(kBusyTimeoutMs);
+    return readOnly ? "QSQLITE_OPEN_READONLY;" + options : options;
+}
+
+// SQLITE_BUSY or SQLITE_LOCKED, including their extended codes
+static bool isLockError(const QSqlError& error) {
+    const int code = error.nativeErrorCode().toInt() & 0xff;
+    return code == 5 || code == 6;
+}
+
+bool Database::open(const QString& path, bool readOnly, const MigrationProgress& progress) {
+    m_path = path;
+    m_readOnly = readOnly;
+    m_ownerThread = QThread::currentThread();
     m_db = QSqlDatabase::addDatabase("QSQLITE", "tella");
     m_db.setDatabaseName(path);
+    m_db.setConnectOptions(connectOptions(readOnly));
     if (!m_db.open()) {
         m_lastError = m_db.lastError().text();
         return false;
     }
 
+    QSqlQuery q(db());
+    if (readOnly) {
+        // The schema belongs to the till; make sure it is current instead of upgrading it
+        int version = schemaVersion();
+        if (version < latestSchemaVersion()) {
+            m_lastError = version < 0 ? QString("Could not read the schema version")
+                                      : QString("Database is at schema version %1 and needs %2; open it in the till "
+                                                "once to upgrade it")
+                                            .arg(version)
+                                            .arg(latestSchemaVersion());
+            return false;
+        }
+        m_branchId = setting("branch_id");
+        return true;
+    }
+
     // Enable WAL and foreign keys
-    QSqlQuery q(m_db);
+    // Only takes effect on a new, empty file; MaintenanceJob converts older databases
+    q.exec("PRAGMA auto_vacuum=INCREMENTAL");
     q.exec("PRAGMA journal_mode=WAL");
     q.exec("PRAGMA foreign_keys=ON");
     q.exec("PRAGMA synchronous=NORMAL");
 
-    return initSchema();
+    if (!initSchema(progress)) {
+        return false;
+    }
+    m_branchId = setting("branch_id");
+    // What is in the file now is on screen after the first load; pollChanges starts from here
+    if (q.exec("SELECT COALESCE(MAX(seq), 0) FROM change_log") && q.next()) {
+        m_polledSeq = q.value(0).toLongLong();
+    }
+    q.finish();
+    return true;
 }
 
 void Database::close() {
@@ -43,14 +117,167 @@ void Database::close() {
 
 bool Database::isOpen() const { return m_db.isOpen(); }
 
+QString Database::path() const { return m_path; }
+
+QSqlDatabase Database::db() {
+    if (QThread::currentThread() == m_ownerThread) {
+        return m_db;
+    }
+
+    // QSqlDatabase handles are bound to the thread that opened them, so each worker gets its own
+    const QString name = QString("tella-%1").arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+    if (QSqlDatabase::contains(name)) {
+        return QSqlDatabase::database(name, false);
+    }
+    QSqlDatabase conn = QSqlDatabase::addDatabase("QSQLITE", name);
+    conn.setDatabaseName(m_path);
+    conn.setConnectOptions(connectOptions(m_readOnly));
+    if (!conn.open()) {
+        m_lastError = conn.lastError().text();
+        return conn;
+    }
+    QSqlQuery q(conn);
+    q.exec("PRAGMA foreign_keys=ON");
+    q.exec("PRAGMA synchronous=NORMAL");
+    return conn;
+}
+
+void Database::releaseThreadConnection() {
+    if (QThread::currentThread() == m_ownerThread) {
+        return;
+    }
+    const QString name = QString("tella-%1").arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+    {
+        QSqlDatabase conn = QSqlDatabase::database(name, false);
+        conn.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
 QString Database::lastError() const { return m_lastError; }
 
+bool Database::lockTimedOut() const { return m_lockTimedOut; }
+
 static QString hashPassword(const QString& pw) {
     return QCryptographicHash::hash(pw.toUtf8(), QCryptographicHash::Sha256).toHex();
 }
 
-bool Database::initSchema() {
-    QSqlQuery q(m_db);
+// Row stamps (created_at, updated_at) are INTEGER milliseconds since the epoch, written by Database itself.
+static qint64 nowMs() { return QDateTime::currentMSecsSinceEpoch(); }
+
+// Local time of a stored stamp. The system zone's offset is looked up once per span between two of its
+// transitions and reused as a fixed offset, so mapping a page of rows does no per-row zone arithmetic.
+static QDateTime localTimeFromMs(qint64 ms) {
+    struct Span {
+        qint64 from = 0;
+        qint64 to = 0;  // empty until the first lookup
+        QTimeZone offset;
+    };
+    static thread_local Span span;
+
+    if (ms < span.from || ms >= span.to) {
+        const QTimeZone zone = QTimeZone::systemTimeZone();
+        const QDateTime at = QDateTime::fromMSecsSinceEpoch(ms, QTimeZone::utc());
+        span.offset = QTimeZone(zone.offsetFromUtc(at));
+        span.from = std::numeric_limits<qint64>::min();
+        span.to = std::numeric_limits<qint64>::max();
+        if (zone.hasTransitions()) {
+            const QTimeZone::OffsetData previous = zone.previousTransition(at.addMSecs(1));
+            const QTimeZone::OffsetData next = zone.nextTransition(at);
+            if (previous.atUtc.isValid()) {
+                span.from = previous.atUtc.toMSecsSinceEpoch();
+            }
+            if (next.atUtc.isValid()) {
+                span.to = next.atUtc.toMSecsSinceEpoch();
+            }
+        }
+    }
+    return QDateTime::fromMSecsSinceEpoch(ms, span.offset);
+}
+
+// =================== SCHEMA ===================
+
+// Append only. A step that has shipped is never edited: files already past it will not run it again.
+const QList<Database::Migration>& Database::migrations() {
+    static const QList<Migration> steps = {
+        {1, "Creating tables", &Database::migrateBaseSchema},
+        {2, "Building the popularity index from sales history", &Database::migratePopularityIndex},
+        {3, "Storing prices in cents", &Database::migrateMoneyToCents},
+        {4, "Filing sales under their local date", &Database::migrateSaleDate},
+        {5, "Storing timestamps as epoch milliseconds", &Database::migrateEpochTimestamps},
+        {6, "Starting the change log", &Database::migrateChangeLog},
+    };
+    return steps;
+}
+
+int Database::latestSchemaVersion() { return migrations().last().version; }
+
+int Database::schemaVersion() {
+    QSqlQuery q(db());
+    if (!q.exec("PRAGMA user_version") || !q.next()) {
+        m_lastError = q.lastError().text();
+        return -1;
+    }
+    return q.value(0).toInt();
+}
+
+bool Database::initSchema(const MigrationProgress& progress) {
+    const int current = schemaVersion();
+    if (current < 0) {
+        return false;
+    }
+    if (current == latestSchemaVersion()) {
+        return true;
+    }
+    if (current > latestSchemaVersion()) {
+        m_lastError = QString("Database schema version %1 is newer than this version of Tella POS supports (%2)")
+                          .arg(current)
+                          .arg(latestSchemaVersion());
+        return false;
+    }
+
+    for (const auto& m : migrations()) {
+        if (m.version <= current) {
+            continue;
+        }
+
+        // Only whole-percent changes are passed on, so long back-fills can report per row
+        int lastPercent = -1;
+        auto stepProgress = [&](int percent) {
+            if (progress && percent != lastPercent) {
+                lastPercent = percent;
+                progress(m.description, percent);
+            }
+        };
+        QElapsedTimer timer;
+        timer.start();
+        stepProgress(0);
+
+        if (!beginTransaction()) {
+            m_lastError = db().lastError().text();
+            return false;
+        }
+        QSqlQuery q(db());
+        if (!(this->*m.apply)(stepProgress) || !q.exec(QString("PRAGMA user_version = %1").arg(m.version))) {
+            QString error = q.lastError().isValid() ? q.lastError().text() : m_lastError;
+            rollbackTransaction();
+            m_lastError = QString("Schema migration %1 (%2) failed: %3").arg(m.version).arg(m.description, error);
+            return false;
+        }
+        if (!commitTransaction()) {
+            m_lastError = db().lastError().text();
+            return false;
+        }
+        stepProgress(100);
+        qInfo() << "Schema migration" << m.version << "applied in" << timer.elapsed() << "ms";
+    }
+    return true;
+}
+
+// Version 1: the schema as it stood before versioning. Every statement is IF NOT EXISTS, so files created by
+// earlier builds (user_version 0) pass through it unchanged.
+bool Database::migrateBaseSchema(const StepProgress& /*progress*/) {
+    QSqlQuery q(db());
 
     // Users
     if (!q.exec(R"(
@@ -172,30 +399,310 @@ bool Database::initSchema() {
         return false;
     }
 
+    // Shop-wide settings
+    if (!q.exec(R"(
+        CREATE TABLE IF NOT EXISTS app_settings (
+            key TEXT PRIMARY KEY,
+            value TEXT NOT NULL
+        )
+    )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Per-product reorder levels; products without a row use the default level.
+    if (!q.exec(R"(
+        CREATE TABLE IF NOT EXISTS product_alert_levels (
+            product_id INTEGER PRIMARY KEY,
+            reorder_level INTEGER NOT NULL,
+            FOREIGN KEY (product_id) REFERENCES products(id) ON DELETE CASCADE
+        )
+    )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Recency-weighted sale counts behind the POS quick picks. Scores are kept relative to a landmark date
+    // (popularity_landmark) so a sale only ever adds to one row; see popularityWeight().
+    if (!q.exec(R"(
+        CREATE TABLE IF NOT EXISTS product_popularity (
+            product_id INTEGER PRIMARY KEY,
+            score REAL NOT NULL,
+            FOREIGN KEY (product_id) REFERENCES products(id) ON DELETE CASCADE
+        )
+    )") ||
+        !q.exec("CREATE INDEX IF NOT EXISTS idx_product_popularity_score ON product_popularity(score DESC)")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Baskets still on a till or parked there. The journal only ever gets appended to while a basket is
+    // open, which keeps each scan a single small insert; it is compacted when the basket is parked.
+    if (!q.exec(R"(
+        CREATE TABLE IF NOT EXISTS held_baskets (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            label TEXT NOT NULL DEFAULT '',
+            is_active INTEGER NOT NULL DEFAULT 1,
+            created_at TEXT NOT NULL DEFAULT (datetime('now')),
+            updated_at TEXT NOT NULL DEFAULT (datetime('now'))
+        )
+    )") ||
+        !q.exec(R"(
+        CREATE TABLE IF NOT EXISTS held_basket_journal (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            basket_id INTEGER NOT NULL,
+            product_id INTEGER NOT NULL,
+            quantity INTEGER NOT NULL,
+            line TEXT NOT NULL,
+            FOREIGN KEY (basket_id) REFERENCES held_baskets(id) ON DELETE CASCADE
+        )
+    )") ||
+        !q.exec(R"(
+        CREATE INDEX IF NOT EXISTS idx_held_basket_journal_basket
+            ON held_basket_journal(basket_id, product_id, id)
+    )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Lets "what expires before X" run as an index range scan
+    if (!q.exec(R"(
+        CREATE INDEX IF NOT EXISTS idx_product_expiry_dates_date
+            ON product_expiry_dates(expiry_date, product_id)
+    )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Date-range scans over sales (exports, reports)
+    if (!q.exec("CREATE INDEX IF NOT EXISTS idx_transactions_created_at ON transactions(created_at)")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Covers the stock card's date-range scan so rows are read in (date, product) order straight
+    // from the index instead of the table plus a sort
+    if (!q.exec(R"(
+        CREATE INDEX IF NOT EXISTS idx_stock_balances_date
+            ON stock_balances(balance_date, product_id, opening_quantity, quantity_in, quantity_out, quantity_reversal)
+    )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
     // Create default admin user if no users exist
     q.exec("SELECT COUNT(*) FROM users");
     if (q.next() && q.value(0).toInt() == 0) {
-        QSqlQuery ins(m_db);
+        QSqlQuery ins(db());
         ins.prepare("INSERT INTO users (username, password, is_active, is_admin) VALUES (?, ?, 1, 1)");
         ins.addBindValue("admin");
         ins.addBindValue(hashPassword("admin123"));
         if (!ins.exec()) {
             m_lastError = ins.lastError().text();
-            qWarning() << "Could not create default admin:" << m_lastError;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Version 2: seeds product_popularity from the sales history. Files that built it before versioning keep theirs.
+bool Database::migratePopularityIndex(const StepProgress& progress) {
+    if (!setting("popularity_landmark").isEmpty()) {
+        return true;
+    }
+    return rebuildPopularity(progress);
+}
+
+struct TableColumn {
+    const char* table;
+    const char* name;
+};
+
+// Version 3: prices and invoice amounts move from REAL to INTEGER cents columns, named for the unit so a
+// script still writing the old columns fails instead of storing shillings as cents.
+bool Database::migrateMoneyToCents(const StepProgress& progress) {
+    static const TableColumn columns[] = {
+        {"products", "cost_price"},  {"products", "selling_price"}, {"invoices", "invoice_total"},
+        {"invoices", "amount_paid"}, {"stock_in", "cost_price"},
+    };
+    constexpr int count = static_cast<int>(std::size(columns));
+
+    QSqlQuery q(db());
+    for (int i = 0; i < count; ++i) {
+        const QString table = columns[i].table;
+        const QString name = columns[i].name;
+        if (!q.exec(QString("ALTER TABLE %1 ADD COLUMN %2_cents INTEGER NOT NULL DEFAULT 0").arg(table, name)) ||
+            !q.exec(QString("UPDATE %1 SET %2_cents = CAST(round(%2 * 100) AS INTEGER)").arg(table, name)) ||
+            !q.exec(QString("ALTER TABLE %1 DROP COLUMN %2").arg(table, name))) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
+        progress((i + 1) * 100 / count);
+    }
+    return true;
+}
+
+// Version 4: each sale gets its date and hour in the shop's time zone, worked out once here and at insert, so
+// reports group on an indexed column instead of date(created_at), which is the UTC date.
+bool Database::migrateSaleDate(const StepProgress& progress) {
+    QSqlQuery q(db());
+    if (!q.exec("ALTER TABLE transactions ADD COLUMN sale_date TEXT NOT NULL DEFAULT ''") ||
+        !q.exec("ALTER TABLE transactions ADD COLUMN sale_hour INTEGER NOT NULL DEFAULT 0")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    // Read first so the updates do not run under an open scan of the same table
+    QList<QPair<int, QString>> rows;
+    q.setForwardOnly(true);
+    if (!q.exec("SELECT id, created_at FROM transactions")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    while (q.next()) {
+        rows.append({q.value(0).toInt(), q.value(1).toString()});
+    }
+
+    const QTimeZone zone = shopTimeZone();
+    QSqlQuery upd(db());
+    upd.prepare("UPDATE transactions SET sale_date=?, sale_hour=? WHERE id=?");
+    for (qsizetype i = 0; i < rows.size(); ++i) {
+        QDateTime at = QDateTime::fromString(rows[i].second, "yyyy-MM-dd hh:mm:ss");
+        at.setTimeZone(QTimeZone::utc());
+        QDateTime local = at.toTimeZone(zone);
+        upd.addBindValue(local.date().toString(Qt::ISODate));
+        upd.addBindValue(local.time().hour());
+        upd.addBindValue(rows[i].first);
+        if (!upd.exec()) {
+            m_lastError = upd.lastError().text();
+            return false;
+        }
+        progress(static_cast<int>((i + 1) * 100 / rows.size()));
+    }
+
+    if (!q.exec("CREATE INDEX IF NOT EXISTS idx_transactions_sale_date ON transactions(sale_date)")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Version 5: created_at / updated_at become INTEGER milliseconds since the epoch, so reading a row is an
+// integer read instead of parsing "yyyy-MM-dd hh:mm:ss" text. ALTER TABLE cannot give a column a non-constant
+// default, so the new columns default to 0 and every insert binds its own stamp.
+bool Database::migrateEpochTimestamps(const StepProgress& progress) {
+    static const TableColumn columns[] = {
+        {"users", "created_at"},        {"products", "created_at"},     {"products", "updated_at"},
+        {"transactions", "created_at"}, {"invoices", "created_at"},     {"stock_in", "created_at"},
+        {"held_baskets", "created_at"}, {"held_baskets", "updated_at"},
+    };
+    constexpr int count = static_cast<int>(std::size(columns));
+
+    QSqlQuery q(db());
+    if (!q.exec("DROP INDEX IF EXISTS idx_transactions_created_at")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        const QString table = columns[i].table;
+        const QString name = columns[i].name;
+        if (!q.exec(QString("ALTER TABLE %1 ADD COLUMN %2_ms INTEGER NOT NULL DEFAULT 0").arg(table, name)) ||
+            !q.exec(QString("UPDATE %1 SET %2_ms = COALESCE(CAST(round((julianday(%2) - 2440587.5) * 86400000.0) "
+                            "AS INTEGER), 0)")
+                        .arg(table, name)) ||
+            !q.exec(QString("ALTER TABLE %1 DROP COLUMN %2").arg(table, name)) ||
+            !q.exec(QString("ALTER TABLE %1 RENAME COLUMN %2_ms TO %2").arg(table, name))) {
+            m_lastError = q.lastError().text();
+            return false;
         }
+        progress((i + 1) * 100 / count);
+    }
+    if (!q.exec("CREATE INDEX idx_transactions_created_at ON transactions(created_at)")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Version 6: the change log that branches exchange, the map from other branches' row ids to local ones, and the
+// exchange watermarks. The file gets its branch id here, and the current catalogue is logged as its first changes,
+// so the first bundle a branch sends carries its products. Sales and stock from before the upgrade stay local.
+bool Database::migrateChangeLog(const StepProgress& /*progress*/) {
+    QSqlQuery q(db());
+    if (!q.exec(R"(
+        CREATE TABLE change_log (
+            seq INTEGER PRIMARY KEY,
+            origin TEXT NOT NULL,
+            origin_seq INTEGER NOT NULL,
+            entity TEXT NOT NULL,
+            op TEXT NOT NULL,
+            payload TEXT NOT NULL,
+            created_at INTEGER NOT NULL,
+            UNIQUE(origin, origin_seq)
+        )
+    )") ||
+        !q.exec(R"(
+        CREATE TABLE sync_ids (
+            entity TEXT NOT NULL,
+            origin TEXT NOT NULL,
+            origin_id INTEGER NOT NULL,
+            local_id INTEGER NOT NULL,
+            PRIMARY KEY (entity, origin, origin_id)
+        ) WITHOUT ROWID
+    )") ||
+        !q.exec("CREATE INDEX idx_sync_ids_local ON sync_ids(entity, local_id)") ||
+        !q.exec(R"(
+        CREATE TABLE sync_state (
+            peer TEXT PRIMARY KEY,
+            exported_seq INTEGER NOT NULL DEFAULT 0,
+            exported_at INTEGER NOT NULL DEFAULT 0,
+            imported_seq INTEGER NOT NULL DEFAULT 0,
+            imported_at INTEGER NOT NULL DEFAULT 0
+        )
+    )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+
+    const QString branch = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    if (!setSetting("branch_id", branch)) {
+        return false;
     }
+    m_branchId = branch;
 
+    q.prepare(R"(
+        INSERT INTO change_log (seq, origin, origin_seq, entity, op, payload, created_at)
+        SELECT p.id, ?, p.id, 'product', 'upsert',
+               json_object('generic_name', p.generic_name, 'brand_name', p.brand_name,
+                           'old_generic_name', p.generic_name, 'old_brand_name', p.brand_name,
+                           'cost_price_cents', p.cost_price_cents, 'selling_price_cents', p.selling_price_cents,
+                           'barcode', COALESCE(p.barcode, ''),
+                           'expiry_dates', json((SELECT json_group_array(e.expiry_date)
+                                                 FROM product_expiry_dates e WHERE e.product_id = p.id)),
+                           'quantity_delta', 0),
+               ?
+        FROM products p
+    )");
+    q.addBindValue(branch);
+    q.addBindValue(nowMs());
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
     return true;
 }
 
 // =================== USERS ===================
 
 bool Database::createUser(const QString& username, const QString& password, bool isAdmin) {
-    QSqlQuery q(m_db);
-    q.prepare("INSERT INTO users (username, password, is_active, is_admin) VALUES (?, ?, 1, ?)");
+    QSqlQuery q(db());
+    q.prepare("INSERT INTO users (username, password, is_active, is_admin, created_at) VALUES (?, ?, 1, ?, ?)");
     q.addBindValue(username);
     q.addBindValue(hashPassword(password));
     q.addBindValue(isAdmin ? 1 : 0);
+    q.addBindValue(nowMs());
     if (!q.exec()) {
         m_lastError = q.lastError().text();
         return false;
@@ -204,7 +711,7 @@ bool Database::createUser(const QString& username, const QString& password, bool
 }
 
 bool Database::updateUser(int id, const QString& username, const QString& newPassword, bool updatePassword) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     if (updatePassword) {
         q.prepare("UPDATE users SET username=?, password=? WHERE id=?");
         q.addBindValue(username);
@@ -223,7 +730,7 @@ bool Database::updateUser(int id, const QString& username, const QString& newPas
 }
 
 bool Database::deleteUser(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("DELETE FROM users WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
@@ -234,7 +741,7 @@ bool Database::deleteUser(int id) {
 }
 
 bool Database::activateUser(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("UPDATE users SET is_active=1 WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
@@ -245,7 +752,7 @@ bool Database::activateUser(int id) {
 }
 
 bool Database::deactivateUser(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("UPDATE users SET is_active=0 WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
@@ -256,7 +763,7 @@ bool Database::deactivateUser(int id) {
 }
 
 bool Database::promoteUser(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("UPDATE users SET is_admin=1 WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
@@ -267,7 +774,7 @@ bool Database::promoteUser(int id) {
 }
 
 bool Database::demoteUser(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("UPDATE users SET is_admin=0 WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
@@ -284,15 +791,13 @@ User Database::userFromQuery(QSqlQuery& q) {
     u.password = q.value("password").toString();
     u.isActive = q.value("is_active").toInt() != 0;
     u.isAdmin = q.value("is_admin").toInt() != 0;
-    u.createdAt = QDateTime::fromString(q.value("created_at").toString(), "yyyy-MM-dd hh:mm:ss");
-    u.createdAt.setTimeZone(QTimeZone::utc());
-    u.createdAt = u.createdAt.toLocalTime();
+    u.createdAt = localTimeFromMs(q.value("created_at").toLongLong());
     return u;
 }
 
 QList<User> Database::listUsers() {
     QList<User> users;
-    QSqlQuery q("SELECT * FROM users ORDER BY id", m_db);
+    QSqlQuery q("SELECT * FROM users ORDER BY id", db());
     while (q.next()) {
         users.append(userFromQuery(q));
     }
@@ -300,7 +805,7 @@ QList<User> Database::listUsers() {
 }
 
 User Database::getUserById(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM users WHERE id=?");
     q.addBindValue(id);
     q.exec();
@@ -311,7 +816,7 @@ User Database::getUserById(int id) {
 }
 
 User Database::getUserByUsername(const QString& username) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM users WHERE username=? LIMIT 1");
     q.addBindValue(username);
     q.exec();
@@ -325,7 +830,7 @@ User Database::getUserByUsername(const QString& username) {
 
 QList<QDate> Database::getProductExpiry(int productId) {
     QList<QDate> dates;
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT expiry_date FROM product_expiry_dates WHERE product_id=? ORDER BY expiry_date");
     q.addBindValue(productId);
     q.exec();
@@ -336,7 +841,7 @@ QList<QDate> Database::getProductExpiry(int productId) {
 }
 
 bool Database::updateProductExpiry(int productId, const QList<QDate>& dates) {
-    QSqlQuery del(m_db);
+    QSqlQuery del(db());
     del.prepare("DELETE FROM product_expiry_dates WHERE product_id=?");
     del.addBindValue(productId);
     if (!del.exec()) {
@@ -345,7 +850,7 @@ bool Database::updateProductExpiry(int productId, const QList<QDate>& dates) {
     }
 
     for (const auto& d : dates) {
-        QSqlQuery ins(m_db);
+        QSqlQuery ins(db());
         ins.prepare("INSERT OR IGNORE INTO product_expiry_dates (product_id, expiry_date) VALUES (?,?)");
         ins.addBindValue(productId);
         ins.addBindValue(d.toString(Qt::ISODate));
@@ -355,7 +860,7 @@ bool Database::updateProductExpiry(int productId, const QList<QDate>& dates) {
 }
 
 bool Database::addProductExpiry(int productId, const QDate& date) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("INSERT OR IGNORE INTO product_expiry_dates (product_id, expiry_date) VALUES (?,?)");
     q.addBindValue(productId);
     q.addBindValue(date.toString(Qt::ISODate));
@@ -367,7 +872,7 @@ bool Database::addProductExpiry(int productId, const QDate& date) {
 }
 
 bool Database::removeProductExpiry(int productId, const QDate& date) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("DELETE FROM product_expiry_dates WHERE product_id=? AND expiry_date=?");
     q.addBindValue(productId);
     q.addBindValue(date.toString(Qt::ISODate));
@@ -384,8 +889,8 @@ Product Database::productFromQuery(QSqlQuery& q) {
     p.genericName = q.value("generic_name").toString();
     p.brandName = q.value("brand_name").toString();
     p.quantity = q.value("quantity").toInt();
-    p.costPrice = q.value("cost_price").toDouble();
-    p.sellingPrice = q.value("selling_price").toDouble();
+    p.costPrice = Money::fromCents(q.value("cost_price_cents").toLongLong());
+    p.sellingPrice = Money::fromCents(q.value("selling_price_cents").toLongLong());
 
     // Handle NULL barcode as empty string
     if (q.value("barcode").isNull()) {
@@ -394,75 +899,149 @@ Product Database::productFromQuery(QSqlQuery& q) {
         p.barcode = q.value("barcode").toString();
     }
 
-    p.createdAt = QDateTime::fromString(q.value("created_at").toString(), "yyyy-MM-dd hh:mm:ss");
-    p.updatedAt = QDateTime::fromString(q.value("updated_at").toString(), "yyyy-MM-dd hh:mm:ss");
-    p.createdAt.setTimeZone(QTimeZone::utc());
-    p.updatedAt.setTimeZone(QTimeZone::utc());
-    p.createdAt = p.createdAt.toLocalTime();
-    p.updatedAt = p.updatedAt.toLocalTime();
-    p.expiryDates = getProductExpiry(p.id);
+    p.createdAt = localTimeFromMs(q.value("created_at").toLongLong());
+    p.updatedAt = localTimeFromMs(q.value("updated_at").toLongLong());
+
+    // Queries that select the expiry dates alongside the row save a lookup per product
+    int expiryColumn = q.record().indexOf("expiry_dates");
+    if (expiryColumn < 0) {
+        p.expiryDates = getProductExpiry(p.id);
+    } else {
+        const QStringList dates = q.value(expiryColumn).toString().split(',', Qt::SkipEmptyParts);
+        for (const QString& d : dates) {
+            p.expiryDates.append(QDate::fromString(d, Qt::ISODate));
+        }
+    }
     return p;
 }
 
+// What a write that only moved products touched
+static Database::DataChange touchedProducts(QList<int> productIds) {
+    Database::DataChange change;
+    change.products = std::move(productIds);
+    return change;
+}
+
+// Change-log payload of a product write. `old*` name the product as it was, which is how other files find it.
+static QJsonObject productChange(const Product& p, const QString& oldGenericName, const QString& oldBrandName,
+                                 int quantityDelta) {
+    QJsonArray dates;
+    for (const auto& d : p.expiryDates) {
+        dates.append(d.toString(Qt::ISODate));
+    }
+    return {
+        {"generic_name", p.genericName},
+        {"brand_name", p.brandName},
+        {"old_generic_name", oldGenericName},
+        {"old_brand_name", oldBrandName},
+        {"cost_price_cents", p.costPrice.cents()},
+        {"selling_price_cents", p.sellingPrice.cents()},
+        {"barcode", p.barcode},
+        {"expiry_dates", dates},
+        {"quantity_delta", quantityDelta},
+    };
+}
+
 bool Database::createProduct(const Product& p) {
-    QSqlQuery q(m_db);
+    if (!beginTransaction()) {
+        return false;
+    }
+    QSqlQuery q(db());
     q.prepare(
-        R"(INSERT INTO products (generic_name, brand_name, quantity, cost_price, selling_price, barcode, updated_at)
-                 VALUES (?, ?, ?, ?, ?, ?, datetime('now')))");
+        R"(INSERT INTO products (generic_name, brand_name, quantity, cost_price_cents, selling_price_cents, barcode,
+                                 created_at, updated_at)
+                 VALUES (?, ?, ?, ?, ?, ?, ?, ?))");
+    const qint64 now = nowMs();
     q.addBindValue(p.genericName);
     q.addBindValue(p.brandName);
     q.addBindValue(p.quantity);
-    q.addBindValue(p.costPrice);
-    q.addBindValue(p.sellingPrice);
+    q.addBindValue(p.costPrice.cents());
+    q.addBindValue(p.sellingPrice.cents());
     q.addBindValue(p.barcode.isEmpty() ? QVariant() : QVariant(p.barcode));
+    q.addBindValue(now);
+    q.addBindValue(now);
 
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
     int newId = q.lastInsertId().toInt();
     updateProductExpiry(newId, p.expiryDates);
     // initialize stock balance
     updateStockBalance(newId, p.quantity, 0, 0, 0);
-    return true;
+    if (!logChange("product", "upsert", productChange(p, p.genericName, p.brandName, p.quantity))) {
+        rollbackTransaction();
+        return false;
+    }
+    notifyChanged(touchedProducts({newId}));
+    return commitTransaction();
 }
 
 bool Database::updateProduct(const Product& p) {
-    QSqlQuery q(m_db);
+    if (!beginTransaction()) {
+        return false;
+    }
+    const Product old = getProductById(p.id);
+    const int oldQuantity = old.quantity;
+
+    QSqlQuery q(db());
     q.prepare(R"(UPDATE products SET generic_name=?, brand_name=?, quantity=?,
-                 cost_price=?, selling_price=?, barcode=?, updated_at=datetime('now')
+                 cost_price_cents=?, selling_price_cents=?, barcode=?, updated_at=?
                  WHERE id=?)");
     q.addBindValue(p.genericName);
     q.addBindValue(p.brandName);
     q.addBindValue(p.quantity);
-    q.addBindValue(p.costPrice);
-    q.addBindValue(p.sellingPrice);
+    q.addBindValue(p.costPrice.cents());
+    q.addBindValue(p.sellingPrice.cents());
     q.addBindValue(p.barcode.isEmpty() ? QVariant() : QVariant(p.barcode));
+    q.addBindValue(nowMs());
     q.addBindValue(p.id);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
 
     updateProductExpiry(p.id, p.expiryDates);
-    updateStockBalance(p.id, p.quantity, 0, 0, 0);
-    return true;
+    // Price/name edits leave the stock card alone; a manual quantity change is booked as a movement
+    int delta = p.quantity - oldQuantity;
+    if (delta != 0) {
+        updateStockBalance(p.id, oldQuantity, qMax(delta, 0), qMax(-delta, 0), 0);
+    }
+    if (old.id != 0 && !logChange("product", "upsert", productChange(p, old.genericName, old.brandName, delta))) {
+        rollbackTransaction();
+        return false;
+    }
+    notifyChanged(touchedProducts({p.id}));
+    return commitTransaction();
 }
 
 bool Database::deleteProduct(int id) {
-    QSqlQuery q(m_db);
+    if (!beginTransaction()) {
+        return false;
+    }
+    const Product old = getProductById(id);
+    QSqlQuery q(db());
     q.prepare("DELETE FROM products WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
-    return true;
+    if (old.id != 0 &&
+        !logChange("product", "delete", {{"generic_name", old.genericName}, {"brand_name", old.brandName}})) {
+        rollbackTransaction();
+        return false;
+    }
+    notifyChanged(touchedProducts({id}));
+    return commitTransaction();
 }
 
 QList<Product> Database::listProducts(const QString& nameFilter, int limit, int offset) {
     QList<Product> products;
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     if (nameFilter.isEmpty()) {
         q.prepare("SELECT * FROM products ORDER BY id LIMIT ? OFFSET ?");
         q.addBindValue(limit);
@@ -485,7 +1064,7 @@ QList<Product> Database::listProducts(const QString& nameFilter, int limit, int
 QList<Product> Database::searchProducts(const QString& name, int limit) { return listProducts(name, limit, 0); }
 
 Product Database::getProductById(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM products WHERE id=?");
     q.addBindValue(id);
     q.exec();
@@ -495,8 +1074,75 @@ Product Database::getProductById(int id) {
     return Product{};
 }
 
+QHash<int, int> Database::getProductQuantities(const QList<int>& productIds) {
+    QHash<int, int> quantities;
+    if (productIds.isEmpty()) {
+        return quantities;
+    }
+
+    QStringList ids;
+    for (int id : productIds) {
+        ids << QString::number(id);
+    }
+
+    QSqlQuery q(db());
+    if (!q.exec("SELECT id, quantity FROM products WHERE id IN (" + ids.join(',') + ")")) {
+        m_lastError = q.lastError().text();
+        return quantities;
+    }
+    while (q.next()) {
+        quantities.insert(q.value(0).toInt(), q.value(1).toInt());
+    }
+    return quantities;
+}
+
+QHash<int, QString> Database::getProductNames(const QList<int>& productIds) {
+    QHash<int, QString> names;
+    if (productIds.isEmpty()) {
+        return names;
+    }
+
+    QStringList ids;
+    for (int id : productIds) {
+        ids << QString::number(id);
+    }
+
+    QSqlQuery q(db());
+    if (!q.exec("SELECT id, generic_name FROM products WHERE id IN (" + ids.join(',') + ")")) {
+        m_lastError = q.lastError().text();
+        return names;
+    }
+    while (q.next()) {
+        names.insert(q.value(0).toInt(), q.value(1).toString());
+    }
+    return names;
+}
+
+QHash<int, QString> Database::getProductBarcodes(const QList<int>& productIds) {
+    QHash<int, QString> barcodes;
+    QString sql = "SELECT id, barcode FROM products WHERE barcode IS NOT NULL AND barcode <> ''";
+    if (!productIds.isEmpty()) {
+        QStringList ids;
+        for (int id : productIds) {
+            ids << QString::number(id);
+        }
+        sql += " AND id IN (" + ids.join(',') + ")";
+    }
+
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    if (!q.exec(sql)) {
+        m_lastError = q.lastError().text();
+        return barcodes;
+    }
+    while (q.next()) {
+        barcodes.insert(q.value(0).toInt(), q.value(1).toString());
+    }
+    return barcodes;
+}
+
 Product Database::getProductByBarcode(const QString& barcode) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM products WHERE barcode=?");
     q.addBindValue(barcode);
     q.exec();
@@ -507,7 +1153,7 @@ Product Database::getProductByBarcode(const QString& barcode) {
 }
 
 int Database::countProducts() {
-    QSqlQuery q("SELECT COUNT(*) FROM products", m_db);
+    QSqlQuery q("SELECT COUNT(*) FROM products", db());
     if (q.next()) {
         return q.value(0).toInt();
     }
@@ -515,7 +1161,9 @@ int Database::countProducts() {
 }
 
 bool Database::importProducts(const QList<Product>& products) {
-    beginTransaction();
+    if (!beginTransaction()) {
+        return false;
+    }
     for (const auto& p : products) {
         if (!createProduct(p)) {
             rollbackTransaction();
@@ -526,80 +1174,216 @@ bool Database::importProducts(const QList<Product>& products) {
 }
 
 bool Database::incrementProductQty(int id, int qty) {
-    QSqlQuery q(m_db);
-    q.prepare("UPDATE products SET quantity=quantity+?, updated_at=datetime('now') WHERE id=?");
+    if (!beginTransaction()) {
+        return false;
+    }
+    QSqlQuery q(db());
+    q.prepare("UPDATE products SET quantity=quantity+?, updated_at=? WHERE id=? RETURNING generic_name, brand_name");
     q.addBindValue(qty);
+    q.addBindValue(nowMs());
     q.addBindValue(id);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
-    return true;
+    if (q.next() && !logChange("product", "adjust",
+                               {{"generic_name", q.value(0).toString()},
+                                {"brand_name", q.value(1).toString()},
+                                {"quantity_delta", qty}})) {
+        rollbackTransaction();
+        return false;
+    }
+    q.finish();
+    notifyChanged(touchedProducts({id}));
+    return commitTransaction();
 }
 
 bool Database::decrementProductQty(int id, int qty) {
-    QSqlQuery q(m_db);
-    q.prepare("UPDATE products SET quantity=quantity-?, updated_at=datetime('now') WHERE id=? AND quantity>=?");
+    if (!beginTransaction()) {
+        return false;
+    }
+    QSqlQuery q(db());
+    q.prepare(R"(UPDATE products SET quantity=quantity-?, updated_at=? WHERE id=? AND quantity>=?
+                 RETURNING generic_name, brand_name)");
     q.addBindValue(qty);
+    q.addBindValue(nowMs());
     q.addBindValue(id);
     q.addBindValue(qty);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
-    return true;
+    if (q.next() && !logChange("product", "adjust",
+                               {{"generic_name", q.value(0).toString()},
+                                {"brand_name", q.value(1).toString()},
+                                {"quantity_delta", -qty}})) {
+        rollbackTransaction();
+        return false;
+    }
+    q.finish();
+    notifyChanged(touchedProducts({id}));
+    return commitTransaction();
 }
 
 // =================== TRANSACTIONS ===================
 
-bool Database::beginTransaction() { return m_db.transaction(); }
-
-bool Database::commitTransaction() { return m_db.commit(); }
-
-bool Database::rollbackTransaction() { return m_db.rollback(); }
-
-void Database::updateStockBalance(int productId, int openingQty, int qtyIn, int qtyOut, int qtyReversal) {
-    QString today = QDate::currentDate().toString(Qt::ISODate);
-
-    // Only sets opening_quantity on first insert of the day; DO NOTHING on conflict
-    QSqlQuery ins(m_db);
-    ins.prepare(R"(
-        INSERT INTO stock_balances 
-            (product_id, opening_quantity, quantity_in, quantity_out, quantity_reversal, balance_date)
-        VALUES (?, ?, 0, 0, 0, ?)
-        ON CONFLICT(product_id, balance_date) DO NOTHING
-    )");
-    ins.addBindValue(productId);
-    ins.addBindValue(openingQty);
-    ins.addBindValue(today);
-    ins.exec();
-
-    // Always accumulate movements for the day
-    QSqlQuery upd(m_db);
-    upd.prepare(R"(
-        UPDATE stock_balances 
-        SET quantity_in       = quantity_in + ?,
-            quantity_out      = quantity_out + ?,
-            quantity_reversal = quantity_reversal + ?
-        WHERE product_id = ? AND balance_date = ?
-    )");
-    upd.addBindValue(qtyIn);
-    upd.addBindValue(qtyOut);
-    upd.addBindValue(qtyReversal);
-    upd.addBindValue(productId);
-    upd.addBindValue(today);
-    if (!upd.exec()) {
-        qWarning() << "updateStockBalance UPDATE failed:" << upd.lastError().text();
+// The outermost level is BEGIN IMMEDIATE, so the write lock is taken up front instead of failing on the first
+// write; inner levels are savepoints that commit or roll back on their own inside it.
+bool Database::beginTransaction(bool briefLockWait) {
+    QSqlQuery q(db());
+    if (m_txDepth > 0) {
+        if (!q.exec(QString("SAVEPOINT tx_%1").arg(m_txDepth))) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
+        ++m_txDepth;
+        return true;
+    }
+
+    // Another till or process is writing: back off for a random pause under a cap that doubles per attempt, so
+    // tills that collided do not all come back at the same moment, until the wait limit has passed
+    const int waitLimitMs = briefLockWait ? kBriefLockWaitMs : kWriteLockWaitMs;
+    m_lockTimedOut = false;
+    QElapsedTimer waited;
+    waited.start();
+    for (int attempt = 0; !q.exec("BEGIN IMMEDIATE"); ++attempt) {
+        if (!isLockError(q.lastError())) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
+        if (waited.elapsed() >= waitLimitMs) {
+            m_lockWaitMs += waited.elapsed();
+            ++m_lockTimeouts;
+            m_lockTimedOut = true;
+            m_lastError = "The database is busy: another till is holding the write lock";
+            return false;
+        }
+        ++m_lockRetries;
+        const int cap = std::min(kRetryMaxPauseMs, kRetryBasePauseMs << std::min(attempt, 6));
+        QThread::msleep(QRandomGenerator::global()->bounded(cap + 1));
+    }
+    m_lockWaitMs += waited.elapsed();
+    ++m_txDepth;
+    return true;
+}
+
+bool Database::commitTransaction() {
+    if (m_txDepth == 0) {
+        m_lastError = "No transaction to commit";
+        return false;
+    }
+    QSqlQuery q(db());
+    if (m_txDepth > 1) {
+        if (!q.exec(QString("RELEASE tx_%1").arg(m_txDepth - 1))) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
+        --m_txDepth;
+        // Hooks of the released level now wait for the enclosing one
+        for (auto& hook : m_afterCommit) {
+            hook.first = qMin(hook.first, m_txDepth);
+        }
+        return true;
+    }
+
+    if (!q.exec("COMMIT")) {
+        m_lastError = q.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    m_txDepth = 0;
+    const auto hooks = std::exchange(m_afterCommit, {});
+    for (const auto& hook : hooks) {
+        hook.second();
+    }
+    return true;
+}
+
+bool Database::rollbackTransaction() {
+    if (m_txDepth == 0) {
+        return false;
+    }
+    QSqlQuery q(db());
+    const bool ok = m_txDepth > 1 ? q.exec(QString("ROLLBACK TO tx_%1").arg(m_txDepth - 1)) &&
+                                        q.exec(QString("RELEASE tx_%1").arg(m_txDepth - 1))
+                                  : q.exec("ROLLBACK");
+    --m_txDepth;
+    m_afterCommit.erase(std::remove_if(m_afterCommit.begin(), m_afterCommit.end(),
+                                       [](const auto& hook) { return hook.first > m_txDepth; }),
+                        m_afterCommit.end());
+    return ok;
+}
+
+Database::LockStats Database::lockStats() const {
+    LockStats stats;
+    stats.retries = m_lockRetries;
+    stats.waitMs = m_lockWaitMs;
+    stats.timeouts = m_lockTimeouts;
+    return stats;
+}
+
+void Database::afterCommit(std::function<void()> hook) {
+    if (m_txDepth == 0) {
+        hook();
+        return;
+    }
+    m_afterCommit.append({m_txDepth, std::move(hook)});
+}
+
+void Database::updateStockBalance(int productId, int openingQty, int qtyIn, int qtyOut, int qtyReversal) {
+    if (!recordStockMovements({{productId, openingQty, qtyIn, qtyOut, qtyReversal}})) {
+        qWarning() << "updateStockBalance failed:" << m_lastError;
+    }
+}
+
+// Rows per upsert statement; 6 binds each stays well under SQLite's bind limit
+static constexpr int kStockMovementBatch = 150;
+
+bool Database::recordStockMovements(const QList<StockMovement>& movements) {
+    // The day's first movement inserts the row with its opening quantity; later ones only add to it
+    QString today = shopToday().toString(Qt::ISODate);
+    for (qsizetype start = 0; start < movements.size(); start += kStockMovementBatch) {
+        qsizetype count = std::min<qsizetype>(kStockMovementBatch, movements.size() - start);
+        QStringList rows;
+        for (qsizetype i = 0; i < count; ++i) {
+            rows << "(?, ?, ?, ?, ?, ?)";
+        }
+
+        QSqlQuery q(db());
+        q.prepare(R"(
+            INSERT INTO stock_balances
+                (product_id, opening_quantity, quantity_in, quantity_out, quantity_reversal, balance_date)
+            VALUES )" + rows.join(", ") + R"(
+            ON CONFLICT(product_id, balance_date) DO UPDATE SET
+                quantity_in       = quantity_in + excluded.quantity_in,
+                quantity_out      = quantity_out + excluded.quantity_out,
+                quantity_reversal = quantity_reversal + excluded.quantity_reversal
+        )");
+        for (qsizetype i = start; i < start + count; ++i) {
+            const StockMovement& m = movements[i];
+            q.addBindValue(m.productId);
+            q.addBindValue(m.openingQty);
+            q.addBindValue(m.qtyIn);
+            q.addBindValue(m.qtyOut);
+            q.addBindValue(m.qtyReversal);
+            q.addBindValue(today);
+        }
+        if (!q.exec()) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
     }
+    return true;
 }
 
 Transaction Database::transactionFromQuery(QSqlQuery& q) {
     Transaction t;
     t.id = q.value("id").toInt();
     t.userId = q.value("user_id").toInt();
-    t.createdAt = QDateTime::fromString(q.value("created_at").toString(), "yyyy-MM-dd hh:mm:ss");
-    t.createdAt.setTimeZone(QTimeZone::utc());
-    t.createdAt = t.createdAt.toLocalTime();
+    t.createdAt = localTimeFromMs(q.value("created_at").toLongLong());
+    t.saleDate = QDate::fromString(q.value("sale_date").toString(), Qt::ISODate);
 
     QByteArray itemsJson = q.value("items").toByteArray();
     QJsonDocument doc = QJsonDocument::fromJson(itemsJson);
@@ -610,7 +1394,11 @@ Transaction Database::transactionFromQuery(QSqlQuery& q) {
     return t;
 }
 
-bool Database::createTransaction(const Transaction& t) {
+bool Database::createTransaction(Transaction& t) { return recordSale(t, QDateTime::currentDateTimeUtc(), true); }
+
+// A sale made at `at`: now for the till, or when another branch made it for a replayed one, which has already
+// taken its stock and so is not checked against this file's levels.
+bool Database::recordSale(Transaction& t, const QDateTime& at, bool checkStock) {
     // Build JSON
     QJsonArray arr;
     for (const auto& item : t.items) {
@@ -618,20 +1406,29 @@ bool Database::createTransaction(const Transaction& t) {
     }
     QByteArray itemsJson = QJsonDocument(arr).toJson(QJsonDocument::Compact);
 
-    beginTransaction();
+    // Stamped once: created_at as epoch milliseconds, sale date and hour in the shop's time zone
+    const QDateTime now = at.toUTC();
+    const QDateTime local = now.toTimeZone(shopTimeZone());
+    const QString today = local.date().toString(Qt::ISODate);
+
+    if (!beginTransaction()) {
+        return false;
+    }
 
     // Check stock and decrement
     for (const auto& item : t.items) {
         Product p = getProductById(item.productId);
-        if (p.id == 0 || p.quantity < item.quantity) {
+        if (p.id == 0 || (checkStock && p.quantity < item.quantity)) {
             m_lastError = QString("Insufficient stock for: %1").arg(item.genericName);
             rollbackTransaction();
             return false;
         }
+        if (!movesStock()) {
+            continue;  // another branch's sale came off its own shelves
+        }
 
         // Ensure today's balance row exists with correct opening
-        QString today = QDate::currentDate().toString(Qt::ISODate);
-        QSqlQuery check(m_db);
+        QSqlQuery check(db());
         check.prepare("SELECT id FROM stock_balances WHERE product_id=? AND balance_date=?");
         check.addBindValue(item.productId);
         check.addBindValue(today);
@@ -640,9 +1437,10 @@ bool Database::createTransaction(const Transaction& t) {
             updateStockBalance(item.productId, p.quantity, 0, 0, 0);
         }
 
-        QSqlQuery upd(m_db);
-        upd.prepare("UPDATE products SET quantity=quantity-?, updated_at=datetime('now') WHERE id=?");
+        QSqlQuery upd(db());
+        upd.prepare("UPDATE products SET quantity=quantity-?, updated_at=? WHERE id=?");
         upd.addBindValue(item.quantity);
+        upd.addBindValue(now.toMSecsSinceEpoch());
         upd.addBindValue(item.productId);
         if (!upd.exec()) {
             m_lastError = upd.lastError().text();
@@ -654,60 +1452,142 @@ bool Database::createTransaction(const Transaction& t) {
         updateStockBalance(item.productId, p.quantity, 0, item.quantity, 0);
     }
 
-    QSqlQuery q(m_db);
-    q.prepare("INSERT INTO transactions (items, user_id) VALUES (?, ?)");
+    QSqlQuery q(db());
+    q.prepare("INSERT INTO transactions (items, user_id, created_at, sale_date, sale_hour) VALUES (?, ?, ?, ?, ?)");
     q.addBindValue(QString(itemsJson));
     q.addBindValue(t.userId);
+    q.addBindValue(now.toMSecsSinceEpoch());
+    q.addBindValue(today);
+    q.addBindValue(local.time().hour());
     if (!q.exec()) {
         m_lastError = q.lastError().text();
         rollbackTransaction();
         return false;
     }
+    int newId = q.lastInsertId().toInt();
 
-    return commitTransaction();
-}
-
-bool Database::deleteTransaction(int id) {
-    Transaction t = getTransactionById(id);
-    if (t.id == 0) {
-        m_lastError = "Transaction not found";
+    // Another branch's sale says nothing about what sells at this till
+    const bool foreign = m_replaying > 0;
+    if (!foreign && !bumpPopularity(t.items)) {
+        rollbackTransaction();
         return false;
     }
 
-    beginTransaction();
-
-    // Re-increment quantities
-    for (const auto& item : t.items) {
-        QSqlQuery q(m_db);
-        q.prepare("UPDATE products SET quantity=quantity+?, updated_at=datetime('now') WHERE id=?");
-        q.addBindValue(item.quantity);
-        q.addBindValue(item.productId);
-        if (!q.exec()) {
-            m_lastError = q.lastError().text();
-            rollbackTransaction();
-            return false;
+    Transaction sold = t;
+    sold.id = newId;
+    sold.createdAt = now.toLocalTime();
+    sold.saleDate = local.date();
+    afterCommit([this, sold, foreign] {
+        if (!foreign || m_reportAllBranches) {
+            SalesStore::instance().append(sold);
         }
+    });
+    DataChange touched;
+    for (const auto& item : t.items) {
+        touched.products.append(item.productId);
+    }
+    touched.transactions.append(newId);
+    notifyChanged(touched);
 
-        // Record reversal
-        Product p = getProductById(item.productId);
-        updateStockBalance(item.productId, p.quantity, 0, 0, item.quantity);
+    if (!logChange("sale", "insert",
+                   {{"id", newId},
+                    {"items", arr},
+                    {"created_at", now.toMSecsSinceEpoch()},
+                    {"user", getUserById(t.userId).username}})) {
+        rollbackTransaction();
+        return false;
+    }
+    if (!commitTransaction()) {
+        return false;
+    }
+    t = sold;
+    return true;
+}
+
+bool Database::deleteTransaction(int id) {
+    if (!beginTransaction()) {
+        return false;
+    }
+    const QJsonObject ref = changeRef("sale", id);
+    const bool foreign = ref["origin"].toString() != m_branchId;
+    if (!logChange("sale", "delete", ref)) {
+        rollbackTransaction();
+        return false;
     }
 
-    QSqlQuery del(m_db);
-    del.prepare("DELETE FROM transactions WHERE id=?");
+    // Deleting first hands back the items, so the sale is never read on its own
+    QSqlQuery del(db());
+    del.prepare("DELETE FROM transactions WHERE id=? RETURNING items, created_at");
     del.addBindValue(id);
     if (!del.exec()) {
         m_lastError = del.lastError().text();
         rollbackTransaction();
         return false;
     }
+    if (!del.next()) {
+        m_lastError = "Transaction not found";
+        rollbackTransaction();
+        return false;
+    }
+
+    QHash<int, int> reversed;  // product id -> quantity going back on the shelf
+    QList<int> soldLines;      // product id of each line, as bumpPopularity counted them
+    const QJsonArray items = QJsonDocument::fromJson(del.value(0).toByteArray()).array();
+    for (const auto& v : items) {
+        QJsonObject item = v.toObject();
+        reversed[item["id"].toInt()] += item["quantity"].toInt();
+        soldLines.append(item["id"].toInt());
+    }
+    const QDateTime soldAt = QDateTime::fromMSecsSinceEpoch(del.value(1).toLongLong(), QTimeZone::utc());
+    del.finish();
+
+    // A cancelled sale takes back what it added to the quick-pick ranking; another branch's added nothing
+    if (!foreign && !dropPopularity(soldLines, soldAt)) {
+        rollbackTransaction();
+        return false;
+    }
 
+    // All products in one statement; RETURNING gives the new levels the stock card needs
+    DataChange touched;
+    touched.transactions.append(id);
+    if (!reversed.isEmpty() && movesStock()) {
+        QStringList cases;
+        QStringList ids;
+        for (auto it = reversed.cbegin(); it != reversed.cend(); ++it) {
+            cases << QString("WHEN %1 THEN %2").arg(it.key()).arg(it.value());
+            ids << QString::number(it.key());
+        }
+
+        QSqlQuery upd(db());
+        if (!upd.exec("UPDATE products SET quantity = quantity + CASE id " + cases.join(' ') +
+                      " END, updated_at=" + QString::number(nowMs()) + " WHERE id IN (" + ids.join(',') +
+                      ") RETURNING id, quantity")) {
+            m_lastError = upd.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
+
+        QList<StockMovement> movements;
+        while (upd.next()) {
+            int productId = upd.value(0).toInt();
+            int qty = reversed.value(productId);
+            movements.append({productId, upd.value(1).toInt() - qty, 0, 0, qty});
+            touched.products.append(productId);
+        }
+        if (!recordStockMovements(movements)) {
+            rollbackTransaction();
+            return false;
+        }
+    }
+
+    afterCommit([id] { SalesStore::instance().removeTransaction(id); });
+    notifyChanged(touched);
     return commitTransaction();
 }
 
 QList<Transaction> Database::listTransactions(int limit, int offset) {
     QList<Transaction> list;
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM transactions ORDER BY created_at DESC LIMIT ? OFFSET ?");
     q.addBindValue(limit);
     q.addBindValue(offset);
@@ -719,16 +1599,209 @@ QList<Transaction> Database::listTransactions(int limit, int offset) {
 }
 
 Transaction Database::getTransactionById(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM transactions WHERE id=?");
     q.addBindValue(id);
     q.exec();
     if (q.next()) {
         return transactionFromQuery(q);
     }
+
+    // Older sales are in the archives, newest year first
+    QList<int> years = archivedYears();
+    std::sort(years.begin(), years.end(), std::greater<int>());
+    for (int year : years) {
+        if (!attachArchive(year)) {
+            continue;
+        }
+        q.prepare(QString("SELECT * FROM archive_%1.transactions WHERE id=?").arg(year));
+        q.addBindValue(id);
+        if (q.exec() && q.next()) {
+            return transactionFromQuery(q);
+        }
+    }
     return Transaction{};
 }
 
+// =================== ARCHIVES ===================
+
+// Columns of an archived transaction, in the order both sides of the union select them
+static const char* const kArchivedColumns = "id, items, user_id, created_at, sale_date, sale_hour";
+// Ids of archived sales deleted from the live file per write transaction
+static constexpr int kArchiveDeleteBatch = 1000;
+
+QString Database::archivePath(int year) const {
+    const QFileInfo info(m_path);
+    return info.dir().filePath(QString("%1-%2.db").arg(info.completeBaseName()).arg(year));
+}
+
+QList<int> Database::archivedYears() {
+    QList<int> years;
+    for (const QString& year : setting("archived_years").split(',', Qt::SkipEmptyParts)) {
+        years << year.toInt();
+    }
+    return years;
+}
+
+bool Database::attachArchive(int year) {
+    const QString schema = QString("archive_%1").arg(year);
+    QSqlQuery q(db());
+    if (q.exec("PRAGMA database_list")) {
+        while (q.next()) {
+            if (q.value(1).toString() == schema) {
+                return true;
+            }
+        }
+    }
+
+    QUrl uri = QUrl::fromLocalFile(archivePath(year));
+    uri.setQuery("mode=ro");
+    q.prepare(QString("ATTACH DATABASE ? AS %1").arg(schema));
+    q.addBindValue(uri.toString(QUrl::FullyEncoded));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "Could not attach the" << year << "archive:" << m_lastError;
+        return false;
+    }
+    return true;
+}
+
+void Database::setReportAllBranches(bool all) {
+    if (m_reportAllBranches.exchange(all) != all) {
+        SalesStore::instance().invalidate();
+    }
+}
+
+QString Database::transactionsSource(const QDate& from, const QDate& to) {
+    // Ids are kept when a year is archived, so the live sync_ids names other branches' sales in the archives too
+    const QString ownSales =
+        m_reportAllBranches ? QString() : " WHERE id NOT IN (SELECT local_id FROM main.sync_ids WHERE entity = 'sale')";
+    QStringList parts;
+    for (int year : archivedYears()) {
+        if ((from.isValid() && year < from.year()) || (to.isValid() && year > to.year())) {
+            continue;
+        }
+        // An archive that will not attach stays in the union, so the query fails instead of leaving a year out
+        attachArchive(year);
+        parts << QString("SELECT %1 FROM archive_%2.transactions%3").arg(kArchivedColumns).arg(year).arg(ownSales);
+    }
+    if (parts.isEmpty() && ownSales.isEmpty()) {
+        return "transactions";
+    }
+    parts.prepend(QString("SELECT %1 FROM main.transactions%2").arg(kArchivedColumns, ownSales));
+    return "(" + parts.join(" UNION ALL ") + ")";
+}
+
+int Database::archiveYear(int year) {
+    const QString from = QDate(year, 1, 1).toString(Qt::ISODate);
+    const QString to = QDate(year + 1, 1, 1).toString(Qt::ISODate);
+
+    // Copy into the archive file and commit there first. Readers only union archives listed in archived_years,
+    // so a crash before the year is listed leaves rows the next run copies again, never counted twice.
+    QSqlQuery q(db());
+    q.prepare("ATTACH DATABASE ? AS archive_write");
+    q.addBindValue(archivePath(year));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return -1;
+    }
+    auto detach = [this] { QSqlQuery(db()).exec("DETACH DATABASE archive_write"); };
+    auto fail = [this, &q, &detach] {
+        m_lastError = q.lastError().text();
+        q.finish();
+        detach();
+        return -1;
+    };
+
+    if (!q.exec(R"(
+            CREATE TABLE IF NOT EXISTS archive_write.transactions (
+                id INTEGER PRIMARY KEY,
+                items TEXT NOT NULL,
+                user_id INTEGER NOT NULL,
+                created_at INTEGER NOT NULL,
+                sale_date TEXT NOT NULL,
+                sale_hour INTEGER NOT NULL
+            )
+        )") ||
+        !q.exec("CREATE INDEX IF NOT EXISTS archive_write.idx_transactions_sale_date ON transactions(sale_date)")) {
+        return fail();
+    }
+
+    // A deferred transaction only takes the write lock of the file it writes, the archive; the live file is read
+    // from a WAL snapshot, so the tills keep selling however long the copy takes
+    if (!q.exec("BEGIN DEFERRED")) {
+        return fail();
+    }
+    q.prepare(QString(R"(
+        INSERT OR REPLACE INTO archive_write.transactions (%1)
+        SELECT %1 FROM main.transactions WHERE sale_date >= ? AND sale_date < ?
+    )")
+                  .arg(kArchivedColumns));
+    q.addBindValue(from);
+    q.addBindValue(to);
+    if (!q.exec() || !q.exec("COMMIT")) {
+        m_lastError = q.lastError().text();
+        QSqlQuery(db()).exec("ROLLBACK");
+        detach();
+        return -1;
+    }
+
+    // Then drop them from the live file a slice of ids at a time, each slice its own short write transaction, so
+    // a till never waits on more than one slice. Only rows the archive holds are deleted.
+    if (!q.exec("SELECT MIN(id), MAX(id) FROM archive_write.transactions") || !q.next()) {
+        return fail();
+    }
+    const bool empty = q.value(0).isNull();
+    const qint64 firstId = q.value(0).toLongLong();
+    const qint64 lastId = q.value(1).toLongLong();
+    q.finish();
+    int moved = 0;
+    for (qint64 lo = firstId; !empty && lo <= lastId; lo += kArchiveDeleteBatch) {
+        if (!beginTransaction()) {
+            detach();
+            return -1;
+        }
+        q.prepare(R"(DELETE FROM main.transactions
+                     WHERE id IN (SELECT id FROM archive_write.transactions WHERE id >= ? AND id < ?))");
+        q.addBindValue(lo);
+        q.addBindValue(lo + kArchiveDeleteBatch);
+        if (!q.exec()) {
+            m_lastError = q.lastError().text();
+            rollbackTransaction();
+            detach();
+            return -1;
+        }
+        moved += q.numRowsAffected();
+        if (!commitTransaction()) {
+            detach();
+            return -1;
+        }
+    }
+    detach();
+
+    // Listed once the last slice is gone; in between, reports miss the slices already moved for a moment
+    QList<int> years = archivedYears();
+    if (!years.contains(year)) {
+        years << year;
+        std::sort(years.begin(), years.end());
+    }
+    QStringList listed;
+    for (int y : years) {
+        listed << QString::number(y);
+    }
+    if (!beginTransaction()) {
+        return -1;
+    }
+    if (!setSetting("archived_years", listed.join(','))) {
+        rollbackTransaction();
+        return -1;
+    }
+    if (!commitTransaction()) {
+        return -1;
+    }
+    return moved;
+}
+
 // =================== INVOICES ===================
 
 Invoice Database::invoiceFromQuery(QSqlQuery& q) {
@@ -736,67 +1809,120 @@ Invoice Database::invoiceFromQuery(QSqlQuery& q) {
     inv.id = q.value("id").toInt();
     inv.invoiceNumber = q.value("invoice_number").toString();
     inv.purchaseDate = QDate::fromString(q.value("purchase_date").toString(), Qt::ISODate);
-    inv.invoiceTotal = q.value("invoice_total").toDouble();
-    inv.amountPaid = q.value("amount_paid").toDouble();
+    inv.invoiceTotal = Money::fromCents(q.value("invoice_total_cents").toLongLong());
+    inv.amountPaid = Money::fromCents(q.value("amount_paid_cents").toLongLong());
     inv.balance = inv.invoiceTotal - inv.amountPaid;
     inv.supplier = q.value("supplier").toString();
     inv.userId = q.value("user_id").toInt();
-    inv.createdAt = QDateTime::fromString(q.value("created_at").toString(), "yyyy-MM-dd hh:mm:ss");
-    inv.createdAt.setTimeZone(QTimeZone::utc());
-    inv.createdAt = inv.createdAt.toLocalTime();
+    inv.createdAt = localTimeFromMs(q.value("created_at").toLongLong());
     return inv;
 }
 
+static Database::DataChange touchedInvoice(int invoiceId) {
+    Database::DataChange change;
+    change.invoices.append(invoiceId);
+    return change;
+}
+
+// Change-log payload of an invoice write; other files find the invoice by its old number.
+static QJsonObject invoiceChange(const Invoice& inv, const QString& oldNumber, const QString& username) {
+    return {
+        {"invoice_number", inv.invoiceNumber},
+        {"old_invoice_number", oldNumber},
+        {"purchase_date", inv.purchaseDate.toString(Qt::ISODate)},
+        {"invoice_total_cents", inv.invoiceTotal.cents()},
+        {"amount_paid_cents", inv.amountPaid.cents()},
+        {"supplier", inv.supplier},
+        {"user", username},
+    };
+}
+
 bool Database::createInvoice(Invoice& inv) {
-    QSqlQuery q(m_db);
-    q.prepare(R"(INSERT INTO invoices (invoice_number, purchase_date, invoice_total, amount_paid, supplier, user_id)
-                 VALUES (?,?,?,?,?,?))");
+    if (!beginTransaction()) {
+        return false;
+    }
+    QSqlQuery q(db());
+    q.prepare(R"(INSERT INTO invoices (invoice_number, purchase_date, invoice_total_cents, amount_paid_cents, supplier,
+                                       user_id, created_at)
+                 VALUES (?,?,?,?,?,?,?))");
     q.addBindValue(inv.invoiceNumber);
     q.addBindValue(inv.purchaseDate.toString(Qt::ISODate));
-    q.addBindValue(inv.invoiceTotal);
-    q.addBindValue(inv.amountPaid);
+    q.addBindValue(inv.invoiceTotal.cents());
+    q.addBindValue(inv.amountPaid.cents());
     q.addBindValue(inv.supplier);
     q.addBindValue(inv.userId);
+    q.addBindValue(nowMs());
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    const int newId = q.lastInsertId().toInt();
+    if (!logChange("invoice", "upsert", invoiceChange(inv, inv.invoiceNumber, getUserById(inv.userId).username))) {
+        rollbackTransaction();
+        return false;
+    }
+    notifyChanged(touchedInvoice(newId));
+    if (!commitTransaction()) {
         return false;
     }
-    inv.id = q.lastInsertId().toInt();
+    inv.id = newId;
     return true;
 }
 
 bool Database::updateInvoice(const Invoice& inv) {
-    QSqlQuery q(m_db);
-    q.prepare(R"(UPDATE invoices SET invoice_number=?, purchase_date=?, invoice_total=?,
-                 amount_paid=?, supplier=?, user_id=? WHERE id=?)");
+    if (!beginTransaction()) {
+        return false;
+    }
+    const Invoice old = getInvoiceById(inv.id);
+    QSqlQuery q(db());
+    q.prepare(R"(UPDATE invoices SET invoice_number=?, purchase_date=?, invoice_total_cents=?,
+                 amount_paid_cents=?, supplier=?, user_id=? WHERE id=?)");
     q.addBindValue(inv.invoiceNumber);
     q.addBindValue(inv.purchaseDate.toString(Qt::ISODate));
-    q.addBindValue(inv.invoiceTotal);
-    q.addBindValue(inv.amountPaid);
+    q.addBindValue(inv.invoiceTotal.cents());
+    q.addBindValue(inv.amountPaid.cents());
     q.addBindValue(inv.supplier);
     q.addBindValue(inv.userId);
     q.addBindValue(inv.id);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
-    return true;
+    if (old.id != 0 &&
+        !logChange("invoice", "upsert", invoiceChange(inv, old.invoiceNumber, getUserById(inv.userId).username))) {
+        rollbackTransaction();
+        return false;
+    }
+    notifyChanged(touchedInvoice(inv.id));
+    return commitTransaction();
 }
 
 bool Database::deleteInvoice(int id) {
-    QSqlQuery q(m_db);
+    if (!beginTransaction()) {
+        return false;
+    }
+    const Invoice old = getInvoiceById(id);
+    QSqlQuery q(db());
     q.prepare("DELETE FROM invoices WHERE id=?");
     q.addBindValue(id);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        rollbackTransaction();
         return false;
     }
-    return true;
+    if (old.id != 0 && !logChange("invoice", "delete", {{"invoice_number", old.invoiceNumber}})) {
+        rollbackTransaction();
+        return false;
+    }
+    notifyChanged(touchedInvoice(id));
+    return commitTransaction();
 }
 
 QList<Invoice> Database::listInvoices(int limit, int offset) {
     QList<Invoice> list;
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM invoices ORDER BY id DESC LIMIT ? OFFSET ?");
     q.addBindValue(limit);
     q.addBindValue(offset);
@@ -808,7 +1934,7 @@ QList<Invoice> Database::listInvoices(int limit, int offset) {
 }
 
 Invoice Database::getInvoiceById(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM invoices WHERE id=?");
     q.addBindValue(id);
     q.exec();
@@ -819,7 +1945,7 @@ Invoice Database::getInvoiceById(int id) {
 }
 
 Invoice Database::getInvoiceByNumber(const QString& num) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare("SELECT * FROM invoices WHERE invoice_number=? LIMIT 1");
     q.addBindValue(num);
     q.exec();
@@ -837,12 +1963,10 @@ StockInItem Database::stockInFromQuery(QSqlQuery& q) {
     s.productId = q.value("product_id").toInt();
     s.invoiceId = q.value("invoice_id").toInt();
     s.quantity = q.value("quantity").toInt();
-    s.costPrice = q.value("cost_price").toDouble();
+    s.costPrice = Money::fromCents(q.value("cost_price_cents").toLongLong());
     s.expiryDate = QDate::fromString(q.value("expiry_date").toString(), Qt::ISODate);
     s.comment = q.value("comment").toString();
-    s.createdAt = QDateTime::fromString(q.value("created_at").toString(), "yyyy-MM-dd hh:mm:ss");
-    s.createdAt.setTimeZone(QTimeZone::utc());
-    s.createdAt = s.createdAt.toLocalTime();
+    s.createdAt = localTimeFromMs(q.value("created_at").toLongLong());
 
     // joined
     QVariant gn = q.value("generic_name");
@@ -856,95 +1980,150 @@ StockInItem Database::stockInFromQuery(QSqlQuery& q) {
     return s;
 }
 
-bool Database::addStockIn(const StockInItem& item) {
-    beginTransaction();
+bool Database::addStockIn(StockInItem& item) {
+    if (!beginTransaction()) {
+        return false;
+    }
 
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare(R"(
         INSERT INTO stock_in (
-                    product_id, invoice_id, quantity, cost_price, expiry_date, comment
-                ) VALUES (?,?,?,?,?,?)
+                    product_id, invoice_id, quantity, cost_price_cents, expiry_date, comment, created_at
+                ) VALUES (?,?,?,?,?,?,?)
     )");
     q.addBindValue(item.productId);
     q.addBindValue(item.invoiceId);
     q.addBindValue(item.quantity);
-    q.addBindValue(item.costPrice);
+    q.addBindValue(item.costPrice.cents());
     q.addBindValue(item.expiryDate.isValid() ? item.expiryDate.toString(Qt::ISODate) : QString(""));
     q.addBindValue(item.comment);
+    q.addBindValue(nowMs());
     if (!q.exec()) {
         m_lastError = q.lastError().text();
         rollbackTransaction();
         return false;
     }
+    const int newId = q.lastInsertId().toInt();
 
-    // Update product quantity
+    // Another branch's delivery is on the record here but went onto its own shelves
     Product p = getProductById(item.productId);
-    QSqlQuery upd(m_db);
-    upd.prepare("UPDATE products SET quantity=quantity+?, updated_at=datetime('now') WHERE id=?");
-    upd.addBindValue(item.quantity);
-    upd.addBindValue(item.productId);
-    if (!upd.exec()) {
-        m_lastError = upd.lastError().text();
-        rollbackTransaction();
-        return false;
-    }
+    if (movesStock()) {
+        // Update product quantity
+        QSqlQuery upd(db());
+        upd.prepare("UPDATE products SET quantity=quantity+?, updated_at=? WHERE id=?");
+        upd.addBindValue(item.quantity);
+        upd.addBindValue(nowMs());
+        upd.addBindValue(item.productId);
+        if (!upd.exec()) {
+            m_lastError = upd.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
 
-    // Update expiry dates
-    if (item.expiryDate.isValid()) {
-        if (p.quantity <= 0) {
-            // Replace expiry dates
-            updateProductExpiry(item.productId, {item.expiryDate});
-        } else {
-            addProductExpiry(item.productId, item.expiryDate);
+        // Update expiry dates
+        if (item.expiryDate.isValid()) {
+            if (p.quantity <= 0) {
+                // Replace expiry dates
+                updateProductExpiry(item.productId, {item.expiryDate});
+            } else {
+                addProductExpiry(item.productId, item.expiryDate);
+            }
         }
-    }
 
-    // Update stock balance
-    updateStockBalance(item.productId, p.quantity, item.quantity, 0, 0);
+        // Update stock balance
+        updateStockBalance(item.productId, p.quantity, item.quantity, 0, 0);
+    }
 
-    return commitTransaction();
+    if (!logChange("stock_in", "insert",
+                   {{"id", newId},
+                    {"generic_name", p.genericName},
+                    {"brand_name", p.brandName},
+                    {"invoice_number", getInvoiceById(item.invoiceId).invoiceNumber},
+                    {"quantity", item.quantity},
+                    {"cost_price_cents", item.costPrice.cents()},
+                    {"expiry_date", item.expiryDate.isValid() ? item.expiryDate.toString(Qt::ISODate) : QString()},
+                    {"comment", item.comment}})) {
+        rollbackTransaction();
+        return false;
+    }
+    DataChange touched = touchedProducts({item.productId});
+    touched.invoices.append(item.invoiceId);
+    notifyChanged(touched);
+    if (!commitTransaction()) {
+        return false;
+    }
+    item.id = newId;
+    return true;
 }
 
 bool Database::deleteStockIn(int id) {
-    StockInItem si = getStockInById(id);
-    if (si.id == 0) {
-        m_lastError = "StockIn not found";
+    if (!beginTransaction()) {
         return false;
     }
-
-    beginTransaction();
-
-    // Decrement product quantity
-    QSqlQuery upd(m_db);
-    upd.prepare("UPDATE products SET quantity=MAX(0, quantity-?), updated_at=datetime('now') WHERE id=?");
-    upd.addBindValue(si.quantity);
-    upd.addBindValue(si.productId);
-    if (!upd.exec()) {
-        m_lastError = upd.lastError().text();
+    if (!logChange("stock_in", "delete", changeRef("stock_in", id))) {
         rollbackTransaction();
         return false;
     }
 
-    // Remove expiry date
-    if (si.expiryDate.isValid()) {
-        removeProductExpiry(si.productId, si.expiryDate);
-    }
-
-    QSqlQuery del(m_db);
-    del.prepare("DELETE FROM stock_in WHERE id=?");
+    // The row and the product's level before the change come back from the delete itself
+    QSqlQuery del(db());
+    del.prepare(R"(DELETE FROM stock_in WHERE id=?
+                   RETURNING product_id, quantity, expiry_date,
+                             (SELECT quantity FROM products p WHERE p.id = stock_in.product_id), invoice_id)");
     del.addBindValue(id);
     if (!del.exec()) {
         m_lastError = del.lastError().text();
         rollbackTransaction();
         return false;
     }
+    if (!del.next()) {
+        m_lastError = "StockIn not found";
+        rollbackTransaction();
+        return false;
+    }
+    const int productId = del.value(0).toInt();
+    const int quantity = del.value(1).toInt();
+    const QDate expiryDate = QDate::fromString(del.value(2).toString(), Qt::ISODate);
+    const int before = del.value(3).toInt();
+    const int invoiceId = del.value(4).toInt();
+    del.finish();
+
+    if (movesStock()) {
+        // Decrement product quantity
+        QSqlQuery upd(db());
+        upd.prepare("UPDATE products SET quantity=MAX(0, quantity-?), updated_at=? WHERE id=? RETURNING quantity");
+        upd.addBindValue(quantity);
+        upd.addBindValue(nowMs());
+        upd.addBindValue(productId);
+        if (!upd.exec()) {
+            m_lastError = upd.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
+        int after = upd.next() ? upd.value(0).toInt() : before;
+        upd.finish();
+
+        // Recorded as a negative reversal: the receipt is undone rather than the stock sold
+        if (after != before && !recordStockMovements({{productId, before, 0, 0, after - before}})) {
+            rollbackTransaction();
+            return false;
+        }
+
+        // Remove expiry date
+        if (expiryDate.isValid()) {
+            removeProductExpiry(productId, expiryDate);
+        }
+    }
 
+    DataChange touched = touchedProducts({productId});
+    touched.invoices.append(invoiceId);
+    notifyChanged(touched);
     return commitTransaction();
 }
 
 QList<StockInItem> Database::getStockInByInvoice(int invoiceId) {
     QList<StockInItem> list;
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare(R"(SELECT si.*, p.generic_name, p.brand_name
                  FROM stock_in si JOIN products p ON si.product_id=p.id
                  WHERE si.invoice_id=? ORDER BY si.id)");
@@ -957,7 +2136,7 @@ QList<StockInItem> Database::getStockInByInvoice(int invoiceId) {
 }
 
 StockInItem Database::getStockInById(int id) {
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
     q.prepare(R"(SELECT si.*, p.generic_name, p.brand_name
                  FROM stock_in si JOIN products p ON si.product_id=p.id
                  WHERE si.id=?)");
@@ -973,21 +2152,23 @@ StockInItem Database::getStockInById(int id) {
 
 QList<SalesReport> Database::getDailySalesReports(const QString& dateFilter) {
     QList<SalesReport> list;
-    QSqlQuery q(m_db);
-    QString sql = R"(
+    const QDate day = QDate::fromString(dateFilter, Qt::ISODate);
+    QSqlQuery q(db());
+    QString sql = QString(R"(
         SELECT
-            date(t.created_at) AS transaction_date,
+            t.sale_date AS transaction_date,
             SUM(
-                CAST(json_extract(item.value, '$.quantity') AS REAL) *
-                CAST(json_extract(item.value, '$.selling_price') AS REAL)
+                CAST(json_extract(item.value, '$.quantity') AS INTEGER) *
+                CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER)
             ) AS total_income
-        FROM transactions t, json_each(t.items) AS item
-    )";
+        FROM %1 t, json_each(t.items) AS item
+    )")
+                      .arg(transactionsSource(day, day));
 
     if (!dateFilter.isEmpty()) {
-        sql += " WHERE date(t.created_at) = '" + dateFilter + "'";
+        sql += " WHERE t.sale_date = '" + dateFilter + "'";
     }
-    sql += " GROUP BY date(t.created_at) ORDER BY transaction_date DESC";
+    sql += " GROUP BY t.sale_date ORDER BY transaction_date DESC";
 
     if (!q.exec(sql)) {
         m_lastError = q.lastError().text();
@@ -997,7 +2178,7 @@ QList<SalesReport> Database::getDailySalesReports(const QString& dateFilter) {
     while (q.next()) {
         SalesReport r;
         r.transactionDate = QDate::fromString(q.value(0).toString(), Qt::ISODate);
-        r.totalIncome = q.value(1).toDouble();
+        r.totalIncome = Money::fromCents(q.value(1).toLongLong());
         list.append(r);
     }
     return list;
@@ -1005,18 +2186,19 @@ QList<SalesReport> Database::getDailySalesReports(const QString& dateFilter) {
 
 QList<MonthlySalesReport> Database::getMonthlySalesReports() {
     QList<MonthlySalesReport> list;
-    QString sql = R"(
+    QString sql = QString(R"(
         SELECT
-            strftime('%Y-%m-01', t.created_at) AS month,
+            strftime('%Y-%m-01', t.sale_date) AS month,
             SUM(
-                CAST(json_extract(item.value, '$.quantity') AS REAL) *
-                CAST(json_extract(item.value, '$.selling_price') AS REAL)
+                CAST(json_extract(item.value, '$.quantity') AS INTEGER) *
+                CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER)
             ) AS total_income
-        FROM transactions t, json_each(t.items) AS item
-        GROUP BY strftime('%Y-%m', t.created_at)
+        FROM %1 t, json_each(t.items) AS item
+        GROUP BY strftime('%Y-%m', t.sale_date)
         ORDER BY month DESC
-    )";
-    QSqlQuery q(m_db);
+    )")
+                      .arg(transactionsSource());
+    QSqlQuery q(db());
     if (!q.exec(sql)) {
         m_lastError = q.lastError().text();
         qWarning() << "getMonthlySalesReports error:" << m_lastError;
@@ -1025,7 +2207,7 @@ QList<MonthlySalesReport> Database::getMonthlySalesReports() {
     while (q.next()) {
         MonthlySalesReport r;
         r.month = QDate::fromString(q.value(0).toString(), Qt::ISODate);
-        r.totalIncome = q.value(1).toDouble();
+        r.totalIncome = Money::fromCents(q.value(1).toLongLong());
         list.append(r);
     }
     return list;
@@ -1033,18 +2215,19 @@ QList<MonthlySalesReport> Database::getMonthlySalesReports() {
 
 QList<AnnualSalesReport> Database::getAnnualSalesReports() {
     QList<AnnualSalesReport> list;
-    QString sql = R"(
+    QString sql = QString(R"(
         SELECT
-            strftime('%Y-01-01', t.created_at) AS yr,
+            strftime('%Y-01-01', t.sale_date) AS yr,
             SUM(
-                CAST(json_extract(item.value, '$.quantity') AS REAL) *
-                CAST(json_extract(item.value, '$.selling_price') AS REAL)
+                CAST(json_extract(item.value, '$.quantity') AS INTEGER) *
+                CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER)
             ) AS total_income
-        FROM transactions t, json_each(t.items) AS item
-        GROUP BY strftime('%Y', t.created_at)
+        FROM %1 t, json_each(t.items) AS item
+        GROUP BY strftime('%Y', t.sale_date)
         ORDER BY yr DESC
-    )";
-    QSqlQuery q(m_db);
+    )")
+                      .arg(transactionsSource());
+    QSqlQuery q(db());
     if (!q.exec(sql)) {
         m_lastError = q.lastError().text();
         qWarning() << "getAnnualSalesReports error:" << m_lastError;
@@ -1053,35 +2236,99 @@ QList<AnnualSalesReport> Database::getAnnualSalesReports() {
     while (q.next()) {
         AnnualSalesReport r;
         r.year = QDate::fromString(q.value(0).toString(), Qt::ISODate);
-        r.totalIncome = q.value(1).toDouble();
+        r.totalIncome = Money::fromCents(q.value(1).toLongLong());
         list.append(r);
     }
     return list;
 }
 
-QList<ProductSale> Database::getDailyProductSales(const QDate& date) {
-    QList<ProductSale> list;
-    QString sql = R"(
+QList<SalesReport> Database::getDailySalesReports(const QDate& fromDate, const QDate& toDate) {
+    QList<SalesReport> list;
+    QSqlQuery q(db());
+    q.prepare(QString(R"(
         SELECT
-            date(t.created_at) AS transaction_date,
-            CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
-            json_extract(item.value, '$.generic_name') AS product_name,
-            CAST(json_extract(item.value, '$.cost_price') AS REAL) AS cost_price,
-            CAST(json_extract(item.value, '$.selling_price') AS REAL) AS selling_price,
-            SUM(CAST(json_extract(item.value, '$.quantity') AS INTEGER)) AS quantity_sold,
-            SUM(CAST(json_extract(item.value,'$.quantity') AS REAL)*CAST(json_extract(item.value,'$.selling_price') AS REAL)) AS income,
-            SUM(CAST(json_extract(item.value,'$.quantity') AS REAL)*(CAST(json_extract(item.value,'$.selling_price') AS REAL)-CAST(json_extract(item.value,'$.cost_price') AS REAL))) AS profit
-        FROM transactions t, json_each(t.items) AS item
-        WHERE date(t.created_at) = ?
-        GROUP BY product_id, product_name
-        ORDER BY income DESC
-    )";
-    QSqlQuery q(m_db);
-    q.prepare(sql);
-    q.addBindValue(date.toString(Qt::ISODate));
+            t.sale_date AS transaction_date,
+            SUM(
+                CAST(json_extract(item.value, '$.quantity') AS INTEGER) *
+                CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER)
+            ) AS total_income
+        FROM %1 t, json_each(t.items) AS item
+        WHERE t.sale_date >= ? AND t.sale_date < ?
+        GROUP BY t.sale_date
+        ORDER BY transaction_date
+    )")
+                  .arg(transactionsSource(fromDate, toDate)));
+    q.addBindValue(fromDate.toString(Qt::ISODate));
+    q.addBindValue(toDate.addDays(1).toString(Qt::ISODate));
     if (!q.exec()) {
         m_lastError = q.lastError().text();
-        qWarning() << "getDailyProductSales error:" << m_lastError;
+        qWarning() << "getDailySalesReports error:" << m_lastError;
+        return list;
+    }
+    while (q.next()) {
+        SalesReport r;
+        r.transactionDate = QDate::fromString(q.value(0).toString(), Qt::ISODate);
+        r.totalIncome = Money::fromCents(q.value(1).toLongLong());
+        list.append(r);
+    }
+    return list;
+}
+
+QList<MonthlySalesReport> Database::getMonthlySalesReports(const QDate& fromDate, const QDate& toDate) {
+    QList<MonthlySalesReport> list;
+    QSqlQuery q(db());
+    q.prepare(QString(R"(
+        SELECT
+            strftime('%Y-%m-01', t.sale_date) AS month,
+            SUM(
+                CAST(json_extract(item.value, '$.quantity') AS INTEGER) *
+                CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER)
+            ) AS total_income
+        FROM %1 t, json_each(t.items) AS item
+        WHERE t.sale_date >= ? AND t.sale_date < ?
+        GROUP BY strftime('%Y-%m', t.sale_date)
+        ORDER BY month
+    )")
+                  .arg(transactionsSource(fromDate, toDate)));
+    q.addBindValue(QDate(fromDate.year(), fromDate.month(), 1).toString(Qt::ISODate));
+    q.addBindValue(QDate(toDate.year(), toDate.month(), 1).addMonths(1).toString(Qt::ISODate));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "getMonthlySalesReports error:" << m_lastError;
+        return list;
+    }
+    while (q.next()) {
+        MonthlySalesReport r;
+        r.month = QDate::fromString(q.value(0).toString(), Qt::ISODate);
+        r.totalIncome = Money::fromCents(q.value(1).toLongLong());
+        list.append(r);
+    }
+    return list;
+}
+
+QList<ProductSale> Database::getDailyProductSales(const QDate& date) {
+    QList<ProductSale> list;
+    QString sql = R"(
+        SELECT
+            t.sale_date AS transaction_date,
+            CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
+            json_extract(item.value, '$.generic_name') AS product_name,
+            CAST(round(json_extract(item.value, '$.cost_price') * 100) AS INTEGER) AS cost_price,
+            CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER) AS selling_price,
+            SUM(CAST(json_extract(item.value, '$.quantity') AS INTEGER)) AS quantity_sold,
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)) AS income,
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*(CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)-CAST(round(json_extract(item.value,'$.cost_price')*100) AS INTEGER))) AS profit
+        FROM %1 t, json_each(t.items) AS item
+        WHERE t.sale_date = ?
+        GROUP BY product_id, product_name
+        ORDER BY income DESC
+    )";
+    QSqlQuery q(db());
+    q.prepare(QString(sql).arg(transactionsSource(date, date)));
+    q.addBindValue(date.toString(Qt::ISODate));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "getDailyProductSales error:" << m_lastError;
         return list;
     }
     while (q.next()) {
@@ -1089,11 +2336,11 @@ QList<ProductSale> Database::getDailyProductSales(const QDate& date) {
         p.transactionDate = QDate::fromString(q.value(0).toString(), Qt::ISODate);
         p.productId = q.value(1).toInt();
         p.productName = q.value(2).toString();
-        p.costPrice = q.value(3).toDouble();
-        p.sellingPrice = q.value(4).toDouble();
+        p.costPrice = Money::fromCents(q.value(3).toLongLong());
+        p.sellingPrice = Money::fromCents(q.value(4).toLongLong());
         p.quantitySold = q.value(5).toInt();
-        p.income = q.value(6).toDouble();
-        p.profit = q.value(7).toDouble();
+        p.income = Money::fromCents(q.value(6).toLongLong());
+        p.profit = Money::fromCents(q.value(7).toLongLong());
         list.append(p);
     }
     return list;
@@ -1103,23 +2350,23 @@ QList<ProductSale> Database::getMonthlyProductSales(int year, int month) {
     QList<ProductSale> list;
     QString sql = R"(
         SELECT
-            strftime('%Y-%m-01', t.created_at) AS transaction_date,
+            strftime('%Y-%m-01', t.sale_date) AS transaction_date,
             CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
             json_extract(item.value, '$.generic_name') AS product_name,
-            CAST(json_extract(item.value, '$.cost_price') AS REAL) AS cost_price,
-            CAST(json_extract(item.value, '$.selling_price') AS REAL) AS selling_price,
+            CAST(round(json_extract(item.value, '$.cost_price') * 100) AS INTEGER) AS cost_price,
+            CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER) AS selling_price,
             SUM(CAST(json_extract(item.value, '$.quantity') AS INTEGER)) AS quantity_sold,
-            SUM(CAST(json_extract(item.value,'$.quantity') AS REAL)*CAST(json_extract(item.value,'$.selling_price') AS REAL)) AS income,
-            SUM(CAST(json_extract(item.value,'$.quantity') AS REAL)*(CAST(json_extract(item.value,'$.selling_price') AS REAL)-CAST(json_extract(item.value,'$.cost_price') AS REAL))) AS profit
-        FROM transactions t, json_each(t.items) AS item
-        WHERE strftime('%Y', t.created_at) = ? AND strftime('%m', t.created_at) = ?
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)) AS income,
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*(CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)-CAST(round(json_extract(item.value,'$.cost_price')*100) AS INTEGER))) AS profit
+        FROM %1 t, json_each(t.items) AS item
+        WHERE t.sale_date >= ? AND t.sale_date < ?
         GROUP BY product_id, product_name
         ORDER BY income DESC
     )";
-    QSqlQuery q(m_db);
-    q.prepare(sql);
-    q.addBindValue(QString::number(year));
-    q.addBindValue(QString("%1").arg(month, 2, 10, QChar('0')));
+    QSqlQuery q(db());
+    q.prepare(QString(sql).arg(transactionsSource(QDate(year, month, 1), QDate(year, month, 1))));
+    q.addBindValue(QDate(year, month, 1).toString(Qt::ISODate));
+    q.addBindValue(QDate(year, month, 1).addMonths(1).toString(Qt::ISODate));
     if (!q.exec()) {
         m_lastError = q.lastError().text();
         return list;
@@ -1129,11 +2376,11 @@ QList<ProductSale> Database::getMonthlyProductSales(int year, int month) {
         p.transactionDate = QDate::fromString(q.value(0).toString(), Qt::ISODate);
         p.productId = q.value(1).toInt();
         p.productName = q.value(2).toString();
-        p.costPrice = q.value(3).toDouble();
-        p.sellingPrice = q.value(4).toDouble();
+        p.costPrice = Money::fromCents(q.value(3).toLongLong());
+        p.sellingPrice = Money::fromCents(q.value(4).toLongLong());
         p.quantitySold = q.value(5).toInt();
-        p.income = q.value(6).toDouble();
-        p.profit = q.value(7).toDouble();
+        p.income = Money::fromCents(q.value(6).toLongLong());
+        p.profit = Money::fromCents(q.value(7).toLongLong());
         list.append(p);
     }
     return list;
@@ -1143,22 +2390,23 @@ QList<ProductSale> Database::getAnnualProductSales(int year) {
     QList<ProductSale> list;
     QString sql = R"(
         SELECT
-            strftime('%Y-01-01', t.created_at) AS transaction_date,
+            strftime('%Y-01-01', t.sale_date) AS transaction_date,
             CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
             json_extract(item.value, '$.generic_name') AS product_name,
-            CAST(json_extract(item.value, '$.cost_price') AS REAL) AS cost_price,
-            CAST(json_extract(item.value, '$.selling_price') AS REAL) AS selling_price,
+            CAST(round(json_extract(item.value, '$.cost_price') * 100) AS INTEGER) AS cost_price,
+            CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER) AS selling_price,
             SUM(CAST(json_extract(item.value, '$.quantity') AS INTEGER)) AS quantity_sold,
-            SUM(CAST(json_extract(item.value,'$.quantity') AS REAL)*CAST(json_extract(item.value,'$.selling_price') AS REAL)) AS income,
-            SUM(CAST(json_extract(item.value,'$.quantity') AS REAL)*(CAST(json_extract(item.value,'$.selling_price') AS REAL)-CAST(json_extract(item.value,'$.cost_price') AS REAL))) AS profit
-        FROM transactions t, json_each(t.items) AS item
-        WHERE strftime('%Y', t.created_at) = ?
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)) AS income,
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*(CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)-CAST(round(json_extract(item.value,'$.cost_price')*100) AS INTEGER))) AS profit
+        FROM %1 t, json_each(t.items) AS item
+        WHERE t.sale_date >= ? AND t.sale_date < ?
         GROUP BY product_id, product_name
         ORDER BY income DESC
     )";
-    QSqlQuery q(m_db);
-    q.prepare(sql);
-    q.addBindValue(QString::number(year));
+    QSqlQuery q(db());
+    q.prepare(QString(sql).arg(transactionsSource(QDate(year, 1, 1), QDate(year, 1, 1))));
+    q.addBindValue(QDate(year, 1, 1).toString(Qt::ISODate));
+    q.addBindValue(QDate(year + 1, 1, 1).toString(Qt::ISODate));
     if (!q.exec()) {
         m_lastError = q.lastError().text();
         return list;
@@ -1168,22 +2416,33 @@ QList<ProductSale> Database::getAnnualProductSales(int year) {
         p.transactionDate = QDate::fromString(q.value(0).toString(), Qt::ISODate);
         p.productId = q.value(1).toInt();
         p.productName = q.value(2).toString();
-        p.costPrice = q.value(3).toDouble();
-        p.sellingPrice = q.value(4).toDouble();
+        p.costPrice = Money::fromCents(q.value(3).toLongLong());
+        p.sellingPrice = Money::fromCents(q.value(4).toLongLong());
         p.quantitySold = q.value(5).toInt();
-        p.income = q.value(6).toDouble();
-        p.profit = q.value(7).toDouble();
+        p.income = Money::fromCents(q.value(6).toLongLong());
+        p.profit = Money::fromCents(q.value(7).toLongLong());
         list.append(p);
     }
     return list;
 }
 
-QList<StockCard> Database::getStockCard(const QDate& fromDate, const QDate& toDate) {
+QList<StockCard> Database::fetchStockCard(StockCardCursor& cursor, int limit) {
     QList<StockCard> list;
+    if (cursor.atEnd) {
+        return list;
+    }
+    if (!cursor.lastDate.isValid()) {
+        // Start just past the range so the keyset condition below also covers the first page
+        cursor.lastDate = cursor.toDate.addDays(1);
+        cursor.lastProductId = 0;
+    }
+
+    // Keyset paging: every page is a fresh seek on idx_stock_balances_date, so no statement
+    // (and no read lock) is held while the user scrolls.
     QString sql = R"(
             SELECT
                 sb.balance_date,
-                p.id AS product_id,
+                sb.product_id,
                 p.generic_name,
                 p.brand_name,
                 sb.opening_quantity,
@@ -1193,16 +2452,22 @@ QList<StockCard> Database::getStockCard(const QDate& fromDate, const QDate& toDa
                 (sb.opening_quantity + sb.quantity_in - sb.quantity_out + sb.quantity_reversal) AS closing
             FROM stock_balances sb
             JOIN products p ON sb.product_id = p.id
-            WHERE sb.balance_date BETWEEN ? AND ?
-            ORDER BY sb.balance_date DESC, p.generic_name
+            WHERE sb.balance_date >= ?
+              AND (sb.balance_date, sb.product_id) < (?, ?)
+            ORDER BY sb.balance_date DESC, sb.product_id DESC
+            LIMIT ?
         )";
 
-    QSqlQuery q(m_db);
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
     q.prepare(sql);
-    q.addBindValue(fromDate.toString(Qt::ISODate));
-    q.addBindValue(toDate.toString(Qt::ISODate));
+    q.addBindValue(cursor.fromDate.toString(Qt::ISODate));
+    q.addBindValue(cursor.lastDate.toString(Qt::ISODate));
+    q.addBindValue(cursor.lastProductId);
+    q.addBindValue(limit);
     if (!q.exec()) {
         m_lastError = q.lastError().text();
+        cursor.atEnd = true;
         return list;
     }
 
@@ -1219,33 +2484,304 @@ QList<StockCard> Database::getStockCard(const QDate& fromDate, const QDate& toDa
         sc.closingQuantity = q.value(8).toInt();
         list.append(sc);
     }
+
+    if (list.size() < limit) {
+        cursor.atEnd = true;
+    }
+    if (!list.isEmpty()) {
+        cursor.lastDate = list.last().date;
+        cursor.lastProductId = list.last().productId;
+    }
     return list;
 }
 
-QList<Product> Database::getMostCommonProducts(int limit) {
-    QList<Product> list;
-    QString sql = R"(
+QList<StockCard> Database::getProductStockCard(int productId, const QDate& fromDate, const QDate& toDate) {
+    QList<StockCard> list;
+    Product p = getProductById(productId);
+    if (p.id == 0 || fromDate > toDate) {
+        return list;
+    }
+
+    // Balance carried into the range: closing of the last movement day before it (UNIQUE index seek)
+    QSqlQuery prev(db());
+    prev.prepare(R"(
+        SELECT opening_quantity + quantity_in - quantity_out + quantity_reversal
+        FROM stock_balances
+        WHERE product_id = ? AND balance_date < ?
+        ORDER BY balance_date DESC
+        LIMIT 1
+    )");
+    prev.addBindValue(productId);
+    prev.addBindValue(fromDate.toString(Qt::ISODate));
+    if (!prev.exec()) {
+        m_lastError = prev.lastError().text();
+        return list;
+    }
+    bool haveCarry = prev.next();
+    int carry = haveCarry ? prev.value(0).toInt() : 0;
+
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    q.prepare(R"(
+        SELECT balance_date, opening_quantity, quantity_in, quantity_out, quantity_reversal
+        FROM stock_balances
+        WHERE product_id = ? AND balance_date BETWEEN ? AND ?
+        ORDER BY balance_date
+    )");
+    q.addBindValue(productId);
+    q.addBindValue(fromDate.toString(Qt::ISODate));
+    q.addBindValue(toDate.toString(Qt::ISODate));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return list;
+    }
+
+    bool haveRow = q.next();
+    if (!haveCarry && haveRow) {
+        // No history before the range: the stock sat at the first recorded opening
+        carry = q.value(1).toInt();
+    } else if (!haveCarry) {
+        // Nothing before or inside the range: the stock sat at the opening of the next movement day after it,
+        // or at today's quantity if the product has not moved since
+        QSqlQuery next(db());
+        next.prepare(R"(
+            SELECT opening_quantity
+            FROM stock_balances
+            WHERE product_id = ? AND balance_date > ?
+            ORDER BY balance_date
+            LIMIT 1
+        )");
+        next.addBindValue(productId);
+        next.addBindValue(toDate.toString(Qt::ISODate));
+        if (!next.exec()) {
+            m_lastError = next.lastError().text();
+            return list;
+        }
+        carry = next.next() ? next.value(0).toInt() : p.quantity;
+    }
+
+    list.reserve(static_cast<int>(fromDate.daysTo(toDate)) + 1);
+    for (QDate day = fromDate; day <= toDate; day = day.addDays(1)) {
+        StockCard sc;
+        sc.date = day;
+        sc.productId = p.id;
+        sc.genericName = p.genericName;
+        sc.brandName = p.brandName;
+
+        if (haveRow && QDate::fromString(q.value(0).toString(), Qt::ISODate) == day) {
+            sc.openingQuantity = q.value(1).toInt();
+            sc.quantityIn = q.value(2).toInt();
+            sc.quantityOut = q.value(3).toInt();
+            sc.quantityReversal = q.value(4).toInt();
+            haveRow = q.next();
+        } else {
+            sc.openingQuantity = carry;
+        }
+        sc.closingQuantity = sc.openingQuantity + sc.quantityIn - sc.quantityOut + sc.quantityReversal;
+        carry = sc.closingQuantity;
+        list.append(sc);
+    }
+    return list;
+}
+
+bool Database::forEachProductSale(SalesPeriod period, const QDate& fromDate, const QDate& toDate,
+                                  const std::function<bool(const ProductSale&)>& row) {
+    // Same buckets as the on-screen report: monthly/annual ranges cover whole months/years
+    QDate from = fromDate;
+    QDate to = toDate;
+    expandToPeriod(period, from, to);
+    QString bucket = period == SalesPeriod::Monthly  ? "strftime('%Y-%m-01', t.sale_date)"
+                     : period == SalesPeriod::Annual ? "strftime('%Y-01-01', t.sale_date)"
+                                                     : "t.sale_date";
+
+    QString sql = QString(R"(
         SELECT
+            %1 AS transaction_date,
             CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
-            COUNT(*) AS cnt
-        FROM transactions t, json_each(t.items) AS item
-        GROUP BY product_id
-        ORDER BY cnt DESC
+            json_extract(item.value, '$.generic_name') AS product_name,
+            CAST(round(json_extract(item.value, '$.cost_price') * 100) AS INTEGER) AS cost_price,
+            CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER) AS selling_price,
+            SUM(CAST(json_extract(item.value, '$.quantity') AS INTEGER)) AS quantity_sold,
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)) AS income,
+            SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*(CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)-CAST(round(json_extract(item.value,'$.cost_price')*100) AS INTEGER))) AS profit
+        FROM %2 t, json_each(t.items) AS item
+        WHERE t.sale_date >= ? AND t.sale_date < ?
+        GROUP BY transaction_date, product_id, product_name
+        ORDER BY transaction_date, income DESC
+    )")
+                      .arg(bucket, transactionsSource(from, to));
+
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    q.prepare(sql);
+    q.addBindValue(from.toString(Qt::ISODate));
+    q.addBindValue(to.addDays(1).toString(Qt::ISODate));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "forEachProductSale error:" << m_lastError;
+        return false;
+    }
+    while (q.next()) {
+        ProductSale p;
+        p.transactionDate = QDate::fromString(q.value(0).toString(), Qt::ISODate);
+        p.productId = q.value(1).toInt();
+        p.productName = q.value(2).toString();
+        p.costPrice = Money::fromCents(q.value(3).toLongLong());
+        p.sellingPrice = Money::fromCents(q.value(4).toLongLong());
+        p.quantitySold = q.value(5).toInt();
+        p.income = Money::fromCents(q.value(6).toLongLong());
+        p.profit = Money::fromCents(q.value(7).toLongLong());
+        if (!row(p)) {
+            break;
+        }
+    }
+    return true;
+}
+
+void Database::expandToPeriod(SalesPeriod period, QDate& from, QDate& to) {
+    if (period == SalesPeriod::Monthly) {
+        from = QDate(from.year(), from.month(), 1);
+        to = QDate(to.year(), to.month(), 1).addMonths(1).addDays(-1);
+    } else if (period == SalesPeriod::Annual) {
+        from = QDate(from.year(), 1, 1);
+        to = QDate(to.year(), 12, 31);
+    }
+}
+
+QList<ProductSale> Database::getTopProducts(const QDate& fromDate, const QDate& toDate, ProductMetric metric,
+                                            int n) {
+    QList<ProductSale> list;
+    QString orderBy = metric == ProductMetric::Profit     ? "profit"
+                      : metric == ProductMetric::Quantity ? "quantity_sold"
+                                                          : "income";
+
+    // Grouped by id so renamed products are not split; the current name wins over the one on the receipt.
+    // ORDER BY ... LIMIT lets SQLite keep only the best n groups instead of sorting them all.
+    QString sql = QString(R"(
+        WITH sold AS (
+            SELECT
+                CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
+                MAX(json_extract(item.value, '$.generic_name')) AS product_name,
+                SUM(CAST(json_extract(item.value, '$.quantity') AS INTEGER)) AS quantity_sold,
+                SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*
+                    CAST(round(json_extract(item.value,'$.cost_price')*100) AS INTEGER)) AS cost,
+                SUM(CAST(json_extract(item.value,'$.quantity') AS INTEGER)*
+                    CAST(round(json_extract(item.value,'$.selling_price')*100) AS INTEGER)) AS income
+            FROM %2 t, json_each(t.items) AS item
+            WHERE t.sale_date >= ? AND t.sale_date < ?
+            GROUP BY product_id
+        )
+        SELECT s.product_id, COALESCE(p.generic_name, s.product_name), s.quantity_sold,
+               s.cost, s.income, s.income - s.cost AS profit
+        FROM sold s
+        LEFT JOIN products p ON p.id = s.product_id
+        ORDER BY %1 DESC
         LIMIT ?
-    )";
-    QSqlQuery q(m_db);
+    )")
+                      .arg(orderBy, transactionsSource(fromDate, toDate));
+
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
     q.prepare(sql);
+    q.addBindValue(fromDate.toString(Qt::ISODate));
+    q.addBindValue(toDate.addDays(1).toString(Qt::ISODate));
+    q.addBindValue(n);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "getTopProducts error:" << m_lastError;
+        return list;
+    }
+    while (q.next()) {
+        ProductSale p;
+        p.productId = q.value(0).toInt();
+        p.productName = q.value(1).toString();
+        p.quantitySold = q.value(2).toInt();
+        p.income = Money::fromCents(q.value(4).toLongLong());
+        p.profit = Money::fromCents(q.value(5).toLongLong());
+        if (p.quantitySold > 0) {
+            p.costPrice = Money::fromCents(q.value(3).toLongLong()).dividedBy(p.quantitySold);
+            p.sellingPrice = p.income.dividedBy(p.quantitySold);
+        }
+        list.append(p);
+    }
+    return list;
+}
+
+bool Database::forEachStockCardRow(int productId, const QDate& fromDate, const QDate& toDate,
+                                   const std::function<bool(const StockCard&)>& row) {
+    if (productId != 0) {
+        // At most one row per day, so the gap-filled list is small enough to build first
+        for (const auto& sc : getProductStockCard(productId, fromDate, toDate)) {
+            if (!row(sc)) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    q.prepare(R"(
+        SELECT
+            sb.balance_date,
+            sb.product_id,
+            p.generic_name,
+            p.brand_name,
+            sb.opening_quantity,
+            sb.quantity_in,
+            sb.quantity_out,
+            sb.quantity_reversal,
+            (sb.opening_quantity + sb.quantity_in - sb.quantity_out + sb.quantity_reversal) AS closing
+        FROM stock_balances sb
+        JOIN products p ON sb.product_id = p.id
+        WHERE sb.balance_date BETWEEN ? AND ?
+        ORDER BY sb.balance_date DESC, sb.product_id DESC
+    )");
+    q.addBindValue(fromDate.toString(Qt::ISODate));
+    q.addBindValue(toDate.toString(Qt::ISODate));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    while (q.next()) {
+        StockCard sc;
+        sc.date = QDate::fromString(q.value(0).toString(), Qt::ISODate);
+        sc.productId = q.value(1).toInt();
+        sc.genericName = q.value(2).toString();
+        sc.brandName = q.value(3).toString();
+        sc.openingQuantity = q.value(4).toInt();
+        sc.quantityIn = q.value(5).toInt();
+        sc.quantityOut = q.value(6).toInt();
+        sc.quantityReversal = q.value(7).toInt();
+        sc.closingQuantity = q.value(8).toInt();
+        if (!row(sc)) {
+            break;
+        }
+    }
+    return true;
+}
+
+QList<Product> Database::getMostCommonProducts(int limit) {
+    QList<Product> list;
+    // Read off the popularity index in score order, with each product's expiry dates in the same row
+    QSqlQuery q(db());
+    q.prepare(R"(
+        SELECT p.*,
+               (SELECT group_concat(expiry_date)
+                FROM (SELECT expiry_date FROM product_expiry_dates
+                      WHERE product_id = p.id ORDER BY expiry_date)) AS expiry_dates
+        FROM product_popularity pp
+        JOIN products p ON p.id = pp.product_id
+        ORDER BY pp.score DESC
+        LIMIT ?
+    )");
     q.addBindValue(limit);
     if (!q.exec()) {
         // Fallback: just return first N products
         return listProducts(QString(), limit, 0);
     }
     while (q.next()) {
-        int pid = q.value(0).toInt();
-        Product p = getProductById(pid);
-        if (p.id > 0) {
-            list.append(p);
-        }
+        list.append(productFromQuery(q));
     }
     // if empty, return all
     if (list.isEmpty()) {
@@ -1253,3 +2789,928 @@ QList<Product> Database::getMostCommonProducts(int limit) {
     }
     return list;
 }
+
+// A sale at `at` is worth 2^(days since the landmark / half-life). Every score shares that factor, so
+// ranking by the stored score is ranking by the decayed score without rewriting old rows.
+double Database::popularityWeight(const QDateTime& at) {
+    QDate landmark = QDate::fromString(setting("popularity_landmark"), Qt::ISODate);
+    double halfLife = qMax(1.0, setting("popularity_half_life_days", "30").toDouble());
+    double days = QDateTime(landmark, QTime(0, 0), QTimeZone::utc()).secsTo(at) / 86400.0;
+    return std::exp2(days / halfLife);
+}
+
+bool Database::bumpPopularity(const QList<TransactionItem>& items) {
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    double weight = popularityWeight(now);
+
+    // Move the landmark forward before the weights get large enough to lose precision
+    if (weight > 1e12) {
+        QSqlQuery rebase(db());
+        rebase.prepare("UPDATE product_popularity SET score = score / ?");
+        rebase.addBindValue(weight);
+        if (!rebase.exec()) {
+            m_lastError = rebase.lastError().text();
+            return false;
+        }
+        if (!setSetting("popularity_landmark", now.date().toString(Qt::ISODate))) {
+            return false;
+        }
+        weight = popularityWeight(now);
+    }
+
+    QSqlQuery q(db());
+    q.prepare(R"(
+        INSERT INTO product_popularity (product_id, score) VALUES (?, ?)
+        ON CONFLICT(product_id) DO UPDATE SET score = score + excluded.score
+    )");
+    for (const auto& item : items) {
+        q.addBindValue(item.productId);
+        q.addBindValue(weight);
+        if (!q.exec()) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Takes back the weight a sale made at `soldAt` added for each of `productIds`. The weight is worked out against
+// the current landmark, so it matches the score even after a rebase.
+bool Database::dropPopularity(const QList<int>& productIds, const QDateTime& soldAt) {
+    const double weight = popularityWeight(soldAt);
+    QSqlQuery q(db());
+    q.prepare("UPDATE product_popularity SET score = MAX(0, score - ?) WHERE product_id = ?");
+    for (int productId : productIds) {
+        q.addBindValue(weight);
+        q.addBindValue(productId);
+        if (!q.exec()) {
+            m_lastError = q.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+QHash<int, double> Database::getPopularityScores(const QList<int>& productIds) {
+    QHash<int, double> scores;
+    if (productIds.isEmpty()) {
+        return scores;
+    }
+
+    QStringList ids;
+    for (int id : productIds) {
+        ids << QString::number(id);
+    }
+
+    QSqlQuery q(db());
+    if (!q.exec("SELECT product_id, score FROM product_popularity WHERE product_id IN (" + ids.join(',') + ")")) {
+        m_lastError = q.lastError().text();
+        return scores;
+    }
+    while (q.next()) {
+        scores.insert(q.value(0).toInt(), q.value(1).toDouble());
+    }
+    return scores;
+}
+
+// Runs inside the caller's transaction.
+bool Database::rebuildPopularity(const StepProgress& progress) {
+    QDate landmark = QDate::currentDate();
+    double halfLife = qMax(1.0, setting("popularity_half_life_days", "30").toDouble());
+
+    // One row per product per day is enough resolution for a half-life measured in weeks. Archived years are
+    // left out: a sale that old weighs less than 2^-12 of one today.
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    if (!q.exec(R"(
+            SELECT CAST(json_extract(item.value, '$.id') AS INTEGER) AS product_id,
+                   CASE typeof(t.created_at)
+                       WHEN 'integer' THEN date(t.created_at / 1000, 'unixepoch')
+                       ELSE date(t.created_at)
+                   END AS day,
+                   COUNT(*)
+            FROM transactions t, json_each(t.items) AS item
+            GROUP BY product_id, day
+        )")) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    QHash<int, double> scores;
+    if (progress) {
+        progress(50);  // the grouping is the slow part
+    }
+    while (q.next()) {
+        int days = static_cast<int>(landmark.daysTo(QDate::fromString(q.value(1).toString(), Qt::ISODate)));
+        scores[q.value(0).toInt()] += q.value(2).toDouble() * std::exp2(days / halfLife);
+    }
+
+    QSqlQuery ins(db());
+    if (!ins.exec("DELETE FROM product_popularity")) {
+        m_lastError = ins.lastError().text();
+        return false;
+    }
+    // Products deleted since their sale are skipped by the join
+    ins.prepare("INSERT INTO product_popularity (product_id, score) SELECT id, ? FROM products WHERE id = ?");
+    int done = 0;
+    for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+        ins.addBindValue(it.value());
+        ins.addBindValue(it.key());
+        if (!ins.exec()) {
+            m_lastError = ins.lastError().text();
+            return false;
+        }
+        if (progress) {
+            progress(50 + static_cast<int>(50 * ++done / scores.size()));
+        }
+    }
+    return setSetting("popularity_landmark", landmark.toString(Qt::ISODate));
+}
+
+// =================== HELD BASKETS ===================
+
+int Database::createHeldBasket(int userId, bool active) {
+    QSqlQuery q(db());
+    q.prepare("INSERT INTO held_baskets (user_id, is_active, created_at, updated_at) VALUES (?, ?, ?, ?)");
+    const qint64 now = nowMs();
+    q.addBindValue(userId);
+    q.addBindValue(active ? 1 : 0);
+    q.addBindValue(now);
+    q.addBindValue(now);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return 0;
+    }
+    return q.lastInsertId().toInt();
+}
+
+bool Database::appendBasketJournal(const QList<BasketJournalEntry>& entries) {
+    if (entries.isEmpty()) {
+        return true;
+    }
+
+    if (!beginTransaction()) {
+        m_lastError = db().lastError().text();
+        return false;
+    }
+
+    QSqlQuery q(db());
+    q.prepare("INSERT INTO held_basket_journal (basket_id, product_id, quantity, line) VALUES (?, ?, ?, ?)");
+    QStringList baskets;
+    for (const auto& e : entries) {
+        q.addBindValue(e.basketId);
+        q.addBindValue(e.productId);
+        q.addBindValue(e.quantity);
+        q.addBindValue(QString::fromUtf8(QJsonDocument(e.line).toJson(QJsonDocument::Compact)));
+        if (!q.exec()) {
+            m_lastError = q.lastError().text();
+            rollbackTransaction();
+            return false;
+        }
+        QString id = QString::number(e.basketId);
+        if (!baskets.contains(id)) {
+            baskets << id;
+        }
+    }
+
+    QSqlQuery touch(db());
+    if (!touch.exec("UPDATE held_baskets SET updated_at=" + QString::number(nowMs()) + " WHERE id IN (" +
+                    baskets.join(',') + ")")) {
+        m_lastError = touch.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    return commitTransaction();
+}
+
+bool Database::setHeldBasketActive(int basketId, bool active, const QString& label) {
+    QSqlQuery q(db());
+    q.prepare("UPDATE held_baskets SET is_active=?, label=?, updated_at=? WHERE id=?");
+    q.addBindValue(active ? 1 : 0);
+    q.addBindValue(label);
+    q.addBindValue(nowMs());
+    q.addBindValue(basketId);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return active || compactBasketJournal(basketId);
+}
+
+// Keeps only the newest entry of each line that is still in the basket.
+bool Database::compactBasketJournal(int basketId) {
+    if (!beginTransaction()) {
+        m_lastError = db().lastError().text();
+        return false;
+    }
+
+    QSqlQuery q(db());
+    q.prepare(R"(
+        DELETE FROM held_basket_journal
+        WHERE basket_id = ?
+          AND (quantity <= 0 OR id NOT IN (
+                SELECT MAX(id) FROM held_basket_journal WHERE basket_id = ? GROUP BY product_id))
+    )");
+    q.addBindValue(basketId);
+    q.addBindValue(basketId);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    return commitTransaction();
+}
+
+bool Database::deleteHeldBasket(int basketId) {
+    QSqlQuery q(db());
+    q.prepare("DELETE FROM held_baskets WHERE id=?");
+    q.addBindValue(basketId);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QList<HeldBasket> Database::getHeldBaskets() {
+    QList<HeldBasket> baskets;
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    // Newest entry per (basket, product), in the order each product first appeared in the basket
+    if (!q.exec(R"(
+        SELECT b.id, b.user_id, b.label, b.is_active, b.updated_at, j.quantity, j.line
+        FROM held_baskets b
+        LEFT JOIN (
+            SELECT basket_id, MIN(id) AS first_id, MAX(id) AS last_id
+            FROM held_basket_journal
+            GROUP BY basket_id, product_id
+        ) k ON k.basket_id = b.id
+        LEFT JOIN held_basket_journal j ON j.id = k.last_id
+        ORDER BY b.id, k.first_id
+    )")) {
+        m_lastError = q.lastError().text();
+        return baskets;
+    }
+
+    while (q.next()) {
+        int id = q.value(0).toInt();
+        if (baskets.isEmpty() || baskets.last().id != id) {
+            HeldBasket b;
+            b.id = id;
+            b.userId = q.value(1).toInt();
+            b.label = q.value(2).toString();
+            b.active = q.value(3).toInt() != 0;
+            b.updatedAt = localTimeFromMs(q.value(4).toLongLong());
+            baskets << b;
+        }
+        int quantity = q.value(5).toInt();
+        if (q.value(6).isNull() || quantity <= 0) {
+            continue;
+        }
+        QJsonObject line = QJsonDocument::fromJson(q.value(6).toString().toUtf8()).object();
+        line["quantity"] = quantity;
+        baskets.last().lines << line;
+    }
+    return baskets;
+}
+
+// =================== CHANGE LOG ===================
+
+QString Database::branchId() const { return m_branchId; }
+
+bool Database::logChange(const QString& entity, const QString& op, const QJsonObject& payload) {
+    if (m_replaying > 0) {
+        return true;  // applyChange logs the change it replays, under the branch that made it
+    }
+    QSqlQuery q(db());
+    q.prepare(R"(INSERT INTO change_log (seq, origin, origin_seq, entity, op, payload, created_at)
+                 SELECT n, ?, n, ?, ?, ?, ? FROM (SELECT COALESCE(MAX(seq), 0) + 1 AS n FROM change_log)
+                 RETURNING seq)");
+    q.addBindValue(m_branchId);
+    q.addBindValue(entity);
+    q.addBindValue(op);
+    q.addBindValue(QString::fromUtf8(QJsonDocument(payload).toJson(QJsonDocument::Compact)));
+    q.addBindValue(nowMs());
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    if (q.next()) {
+        rememberOwnChange(q.value(0).toLongLong());
+    }
+    return true;
+}
+
+bool Database::forEachChange(qint64 afterSeq, const std::function<bool(const Change&)>& row) {
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    q.prepare(R"(SELECT seq, origin, origin_seq, entity, op, payload, created_at FROM change_log
+                 WHERE seq > ? ORDER BY seq)");
+    q.addBindValue(afterSeq);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    while (q.next()) {
+        Change c;
+        c.seq = q.value(0).toLongLong();
+        c.origin = q.value(1).toString();
+        c.originSeq = q.value(2).toLongLong();
+        c.entity = q.value(3).toString();
+        c.op = q.value(4).toString();
+        c.payload = QJsonDocument::fromJson(q.value(5).toByteArray()).object();
+        c.createdAt = q.value(6).toLongLong();
+        if (!row(c)) {
+            break;
+        }
+    }
+    return true;
+}
+
+// Where the row `localId` was made: {origin, id} of the branch that replayed it here, else this file's own
+QJsonObject Database::changeRef(const QString& entity, int localId) {
+    QSqlQuery q(db());
+    q.prepare("SELECT origin, origin_id FROM sync_ids WHERE entity=? AND local_id=?");
+    q.addBindValue(entity);
+    q.addBindValue(localId);
+    if (q.exec() && q.next()) {
+        return {{"origin", q.value(0).toString()}, {"id", q.value(1).toLongLong()}};
+    }
+    return {{"origin", m_branchId}, {"id", localId}};
+}
+
+// 0 when the row never reached this file
+int Database::localIdFor(const QString& entity, const QString& origin, qint64 originId) {
+    if (origin == m_branchId) {
+        return static_cast<int>(originId);
+    }
+    QSqlQuery q(db());
+    q.prepare("SELECT local_id FROM sync_ids WHERE entity=? AND origin=? AND origin_id=?");
+    q.addBindValue(entity);
+    q.addBindValue(origin);
+    q.addBindValue(originId);
+    if (q.exec() && q.next()) {
+        return q.value(0).toInt();
+    }
+    return 0;
+}
+
+bool Database::mapSyncId(const QString& entity, const QString& origin, qint64 originId, int localId) {
+    QSqlQuery q(db());
+    q.prepare("INSERT OR REPLACE INTO sync_ids (entity, origin, origin_id, local_id) VALUES (?, ?, ?, ?)");
+    q.addBindValue(entity);
+    q.addBindValue(origin);
+    q.addBindValue(originId);
+    q.addBindValue(localId);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Products are matched across files by name, which is unique
+int Database::productIdByName(const QString& genericName, const QString& brandName) {
+    QSqlQuery q(db());
+    q.prepare("SELECT id FROM products WHERE generic_name=? AND brand_name=?");
+    q.addBindValue(genericName);
+    q.addBindValue(brandName);
+    if (q.exec() && q.next()) {
+        return q.value(0).toInt();
+    }
+    return 0;
+}
+
+// The product `names` refers to, created out of stock when its own change has not arrived yet. 0 on failure.
+int Database::ensureProduct(const QJsonObject& names, Money costPrice, Money sellingPrice) {
+    const QString genericName = names["generic_name"].toString();
+    const QString brandName = names["brand_name"].toString();
+    if (int id = productIdByName(genericName, brandName)) {
+        return id;
+    }
+    Product p;
+    p.genericName = genericName;
+    p.brandName = brandName;
+    p.costPrice = costPrice;
+    p.sellingPrice = sellingPrice;
+    return createProduct(p) ? productIdByName(genericName, brandName) : 0;
+}
+
+// Users are matched by name; rows by someone unknown here are filed under the first admin
+int Database::userIdByName(const QString& username) {
+    if (int id = getUserByUsername(username).id) {
+        return id;
+    }
+    QSqlQuery q(db());
+    if (q.exec("SELECT id FROM users WHERE is_admin=1 ORDER BY id LIMIT 1") && q.next()) {
+        return q.value(0).toInt();
+    }
+    return 0;
+}
+
+bool Database::applyChange(const Change& change, bool& applied) {
+    applied = false;
+    QSqlQuery seen(db());
+    seen.prepare("SELECT 1 FROM change_log WHERE origin=? AND origin_seq=?");
+    seen.addBindValue(change.origin);
+    seen.addBindValue(change.originSeq);
+    if (!seen.exec()) {
+        m_lastError = seen.lastError().text();
+        return false;
+    }
+    if (seen.next()) {
+        return true;
+    }
+    seen.finish();
+
+    if (!beginTransaction()) {
+        return false;
+    }
+    m_replayStock = setting("sync_shared_stock", "0") == "1";
+    ++m_replaying;
+    const bool ok = replayChange(change);
+    --m_replaying;
+    if (!ok) {
+        rollbackTransaction();
+        return false;
+    }
+
+    QSqlQuery q(db());
+    q.prepare(R"(INSERT INTO change_log (seq, origin, origin_seq, entity, op, payload, created_at)
+                 SELECT COALESCE(MAX(seq), 0) + 1, ?, ?, ?, ?, ?, ? FROM change_log
+                 RETURNING seq)");
+    q.addBindValue(change.origin);
+    q.addBindValue(change.originSeq);
+    q.addBindValue(change.entity);
+    q.addBindValue(change.op);
+    q.addBindValue(QString::fromUtf8(QJsonDocument(change.payload).toJson(QJsonDocument::Compact)));
+    q.addBindValue(change.createdAt);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        rollbackTransaction();
+        return false;
+    }
+    if (q.next()) {
+        rememberOwnChange(q.value(0).toLongLong());
+    }
+    q.finish();
+    if (!commitTransaction()) {
+        return false;
+    }
+    applied = true;
+    return true;
+}
+
+// Replays a change from another file through the ordinary write paths. Branches are separate shops by default:
+// their sales and stock-ins are recorded here for the books but came off and went onto their own shelves, so
+// this file's stock is left alone. Files that share one stockroom set `sync_shared_stock` to 1; then quantities
+// move by the change's delta rather than being set, and a sale or stock-in is applied as the operation it was, so
+// the order in which bundles arrive does not matter for stock levels.
+bool Database::replayChange(const Change& change) {
+    const QJsonObject& d = change.payload;
+
+    if (change.entity == "product") {
+        const QString genericName = d["generic_name"].toString();
+        const QString brandName = d["brand_name"].toString();
+        int id = productIdByName(d["old_generic_name"].toString(genericName), d["old_brand_name"].toString(brandName));
+        if (id == 0) {
+            id = productIdByName(genericName, brandName);
+        }
+        if (change.op == "delete") {
+            return id == 0 || deleteProduct(id);
+        }
+        if (change.op == "adjust") {
+            if (!movesStock()) {
+                return true;  // a count on another branch's shelf
+            }
+            if (id == 0) {
+                id = ensureProduct(d, Money(), Money());
+                if (id == 0) {
+                    return false;
+                }
+            }
+            Product p = getProductById(id);
+            p.quantity += d["quantity_delta"].toInt();
+            return updateProduct(p);
+        }
+
+        const QString barcode = d["barcode"].toString();
+        if (id == 0 && !barcode.isEmpty()) {
+            id = getProductByBarcode(barcode).id;
+        }
+        Product p = id == 0 ? Product{} : getProductById(id);
+        p.genericName = genericName;
+        p.brandName = brandName;
+        p.costPrice = Money::fromCents(d["cost_price_cents"].toInteger());
+        p.sellingPrice = Money::fromCents(d["selling_price_cents"].toInteger());
+        p.barcode = barcode;
+        p.expiryDates.clear();
+        for (const auto& date : d["expiry_dates"].toArray()) {
+            p.expiryDates.append(QDate::fromString(date.toString(), Qt::ISODate));
+        }
+        if (movesStock()) {
+            p.quantity += d["quantity_delta"].toInt();
+        }
+        return id == 0 ? createProduct(p) : updateProduct(p);
+    }
+
+    if (change.entity == "invoice") {
+        const QString number = d["invoice_number"].toString();
+        Invoice inv = getInvoiceByNumber(d["old_invoice_number"].toString(number));
+        if (inv.id == 0) {
+            inv = getInvoiceByNumber(number);
+        }
+        if (change.op == "delete") {
+            return inv.id == 0 || deleteInvoice(inv.id);
+        }
+        inv.invoiceNumber = number;
+        inv.purchaseDate = QDate::fromString(d["purchase_date"].toString(), Qt::ISODate);
+        inv.invoiceTotal = Money::fromCents(d["invoice_total_cents"].toInteger());
+        inv.amountPaid = Money::fromCents(d["amount_paid_cents"].toInteger());
+        inv.supplier = d["supplier"].toString();
+        inv.userId = userIdByName(d["user"].toString());
+        return inv.id == 0 ? createInvoice(inv) : updateInvoice(inv);
+    }
+
+    if (change.entity == "stock_in") {
+        if (change.op == "delete") {
+            const int id = localIdFor("stock_in", d["origin"].toString(), d["id"].toInteger());
+            return id == 0 || getStockInById(id).id == 0 || deleteStockIn(id);
+        }
+
+        StockInItem item;
+        item.productId = ensureProduct(d, Money::fromCents(d["cost_price_cents"].toInteger()), Money());
+        Invoice inv = getInvoiceByNumber(d["invoice_number"].toString());
+        if (inv.id == 0) {
+            inv.invoiceNumber = d["invoice_number"].toString();
+            inv.purchaseDate = localTimeFromMs(change.createdAt).date();
+            inv.userId = userIdByName(QString());
+            if (!createInvoice(inv)) {
+                return false;
+            }
+        }
+        item.invoiceId = inv.id;
+        item.quantity = d["quantity"].toInt();
+        item.costPrice = Money::fromCents(d["cost_price_cents"].toInteger());
+        item.expiryDate = QDate::fromString(d["expiry_date"].toString(), Qt::ISODate);
+        item.comment = d["comment"].toString();
+        if (item.productId == 0 || !addStockIn(item)) {
+            return false;
+        }
+        return mapSyncId("stock_in", change.origin, d["id"].toInteger(), item.id);
+    }
+
+    if (change.entity == "sale") {
+        if (change.op == "delete") {
+            const int id = localIdFor("sale", d["origin"].toString(), d["id"].toInteger());
+            // Never arrived, already cancelled or moved to an archive: nothing to cancel here
+            QSqlQuery q(db());
+            q.prepare("SELECT 1 FROM transactions WHERE id=?");
+            q.addBindValue(id);
+            if (!q.exec()) {
+                m_lastError = q.lastError().text();
+                return false;
+            }
+            return id == 0 || !q.next() || deleteTransaction(id);
+        }
+
+        Transaction t;
+        t.userId = userIdByName(d["user"].toString());
+        for (const auto& v : d["items"].toArray()) {
+            TransactionItem item = TransactionItem::fromJson(v.toObject());
+            item.productId = ensureProduct(v.toObject(), item.costPrice, item.sellingPrice);
+            if (item.productId == 0) {
+                return false;
+            }
+            t.items.append(item);
+        }
+        if (!recordSale(t, QDateTime::fromMSecsSinceEpoch(d["created_at"].toInteger()), false)) {
+            return false;
+        }
+        return mapSyncId("sale", change.origin, d["id"].toInteger(), t.id);
+    }
+
+    m_lastError = QString("Unknown change %1/%2").arg(change.entity, change.op);
+    return false;
+}
+
+qint64 Database::exportedSeq(const QString& peer) {
+    QSqlQuery q(db());
+    q.prepare("SELECT exported_seq FROM sync_state WHERE peer=?");
+    q.addBindValue(peer);
+    if (q.exec() && q.next()) {
+        return q.value(0).toLongLong();
+    }
+    return 0;
+}
+
+bool Database::setExportedSeq(const QString& peer, qint64 seq) {
+    QSqlQuery q(db());
+    q.prepare(R"(INSERT INTO sync_state (peer, exported_seq, exported_at) VALUES (?, ?, ?)
+                 ON CONFLICT(peer) DO UPDATE SET exported_seq=excluded.exported_seq,
+                                                 exported_at=excluded.exported_at)");
+    q.addBindValue(peer);
+    q.addBindValue(seq);
+    q.addBindValue(nowMs());
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool Database::setImported(const QString& origin, qint64 originSeq) {
+    QSqlQuery q(db());
+    q.prepare(R"(INSERT INTO sync_state (peer, imported_seq, imported_at) VALUES (?, ?, ?)
+                 ON CONFLICT(peer) DO UPDATE SET imported_seq=MAX(imported_seq, excluded.imported_seq),
+                                                 imported_at=excluded.imported_at)");
+    q.addBindValue(origin);
+    q.addBindValue(originSeq);
+    q.addBindValue(nowMs());
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// =================== SETTINGS ===================
+
+QString Database::setting(const QString& key, const QString& defaultValue) {
+    QSqlQuery q(db());
+    q.prepare("SELECT value FROM app_settings WHERE key=?");
+    q.addBindValue(key);
+    if (q.exec() && q.next()) {
+        return q.value(0).toString();
+    }
+    return defaultValue;
+}
+
+bool Database::setSetting(const QString& key, const QString& value) {
+    QSqlQuery q(db());
+    q.prepare("INSERT INTO app_settings (key, value) VALUES (?, ?) ON CONFLICT(key) DO UPDATE SET value=excluded.value");
+    q.addBindValue(key);
+    q.addBindValue(value);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QTimeZone Database::shopTimeZone() {
+    QTimeZone zone(setting("shop_time_zone").toUtf8());
+    return zone.isValid() ? zone : QTimeZone::systemTimeZone();
+}
+
+QDate Database::shopToday() { return QDateTime::currentDateTimeUtc().toTimeZone(shopTimeZone()).date(); }
+
+// =================== STOCK ALERTS ===================
+
+int Database::defaultReorderLevel() { return setting("default_reorder_level", "10").toInt(); }
+
+bool Database::setReorderLevel(int productId, int level) {
+    QSqlQuery q(db());
+    q.prepare(R"(INSERT INTO product_alert_levels (product_id, reorder_level) VALUES (?, ?)
+                 ON CONFLICT(product_id) DO UPDATE SET reorder_level=excluded.reorder_level)");
+    q.addBindValue(productId);
+    q.addBindValue(level);
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        return false;
+    }
+    notifyChanged(touchedProducts({productId}));
+    return true;
+}
+
+StockAlert Database::stockAlertFromQuery(QSqlQuery& q) {
+    StockAlert a;
+    a.productId = q.value("id").toInt();
+    a.genericName = q.value("generic_name").toString();
+    a.brandName = q.value("brand_name").toString();
+    a.quantity = q.value("quantity").toInt();
+    a.reorderLevel = q.value("reorder_level").toInt();
+    a.nextExpiry = QDate::fromString(q.value("next_expiry").toString(), Qt::ISODate);
+    return a;
+}
+
+// Shared by both alert queries; the expiry sub-select is served by UNIQUE(product_id, expiry_date).
+static const char* kStockAlertSelect = R"(
+    SELECT p.id, p.generic_name, p.brand_name, p.quantity,
+           COALESCE(a.reorder_level, ?) AS reorder_level,
+           (SELECT MIN(e.expiry_date) FROM product_expiry_dates e WHERE e.product_id = p.id) AS next_expiry
+    FROM products p
+    LEFT JOIN product_alert_levels a ON a.product_id = p.id
+)";
+
+QList<StockAlert> Database::getStockAlerts(const QDate& horizon) {
+    QList<StockAlert> list;
+    QSqlQuery q(db());
+    // The IN sub-select is a range scan over idx_product_expiry_dates_date.
+    q.prepare(QString(kStockAlertSelect) + R"(
+        WHERE p.quantity <= COALESCE(a.reorder_level, ?)
+           OR p.id IN (SELECT product_id FROM product_expiry_dates WHERE expiry_date <= ?)
+    )");
+    int defaultLevel = defaultReorderLevel();
+    q.addBindValue(defaultLevel);
+    q.addBindValue(defaultLevel);
+    q.addBindValue(horizon.toString(Qt::ISODate));
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "getStockAlerts error:" << m_lastError;
+        return list;
+    }
+    while (q.next()) {
+        list.append(stockAlertFromQuery(q));
+    }
+    return list;
+}
+
+QList<StockAlert> Database::getStockAlertInputs(const QList<int>& productIds) {
+    QList<StockAlert> list;
+    if (productIds.isEmpty()) {
+        return list;
+    }
+
+    QStringList ids;
+    for (int id : productIds) {
+        ids << QString::number(id);
+    }
+
+    QSqlQuery q(db());
+    q.prepare(QString(kStockAlertSelect) + " WHERE p.id IN (" + ids.join(',') + ")");
+    q.addBindValue(defaultReorderLevel());
+    if (!q.exec()) {
+        m_lastError = q.lastError().text();
+        qWarning() << "getStockAlertInputs error:" << m_lastError;
+        return list;
+    }
+    while (q.next()) {
+        list.append(stockAlertFromQuery(q));
+    }
+    return list;
+}
+
+// =================== CHANGE NOTIFICATIONS ===================
+
+bool Database::DataChange::isEmpty() const {
+    return products.isEmpty() && transactions.isEmpty() && invoices.isEmpty() && !unknown;
+}
+
+void Database::DataChange::merge(const DataChange& other) {
+    auto add = [](QList<int>& to, const QList<int>& from) {
+        for (int id : from) {
+            if (!to.contains(id)) {
+                to.append(id);
+            }
+        }
+    };
+    add(products, other.products);
+    add(transactions, other.transactions);
+    add(invoices, other.invoices);
+    unknown = unknown || other.unknown;
+}
+
+int Database::addChangeListener(ChangeListener listener) {
+    int id = m_nextListenerId++;
+    m_changeListeners.insert(id, std::move(listener));
+    return id;
+}
+
+void Database::removeChangeListener(int id) { m_changeListeners.remove(id); }
+
+void Database::notifyChanged(const DataChange& change) {
+    // Listeners read the rows back, so they hear of a change only once it is committed
+    if (m_txDepth > 0) {
+        afterCommit([this, change] { notifyChanged(change); });
+        return;
+    }
+    // Listeners are GUI objects; writes made on a worker thread are announced on the main thread
+    if (QThread::currentThread() != m_ownerThread) {
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(), [this, change] { notifyChanged(change); }, Qt::QueuedConnection);
+        return;
+    }
+    if (m_changeListeners.isEmpty() || change.isEmpty()) {
+        return;
+    }
+    // Held until the event loop comes round, so a batch of writes costs the screens one update
+    m_pendingChange.merge(change);
+    if (!m_deliveryQueued) {
+        m_deliveryQueued = true;
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [this] { deliverChanges(); }, Qt::QueuedConnection);
+    }
+}
+
+void Database::deliverChanges() {
+    m_deliveryQueued = false;
+    const DataChange change = std::exchange(m_pendingChange, DataChange{});
+    // Copy so a listener may unregister itself while being called
+    const auto listeners = m_changeListeners;
+    for (const auto& listener : listeners) {
+        listener(change);
+    }
+}
+
+void Database::rememberOwnChange(qint64 seq) {
+    if (!m_polling) {
+        return;  // headless runs never poll, so there is nothing to skip
+    }
+    // Recorded once committed: a rolled-back seq is taken again by the next writer, which may be another till
+    afterCommit([this, seq] {
+        QMutexLocker lock(&m_ownSeqsMutex);
+        m_ownSeqs.insert(seq);
+    });
+}
+
+void Database::pollChanges() {
+    if (!isOpen() || m_readOnly || m_txDepth > 0 || QThread::currentThread() != m_ownerThread) {
+        return;
+    }
+    m_polling = true;
+    // Tills take the write lock in turn and number changes under it, so they commit in seq order and nothing
+    // can appear below the watermark later
+    QList<Change> changes;
+    if (!forEachChange(m_polledSeq, [&](const Change& c) {
+            changes.append(c);
+            return true;
+        })) {
+        qWarning() << "pollChanges error:" << m_lastError;
+        return;
+    }
+    if (changes.isEmpty()) {
+        return;
+    }
+    m_polledSeq = changes.last().seq;
+
+    DataChange touched;
+    QList<Change> sales;
+    for (const auto& c : changes) {
+        {
+            QMutexLocker lock(&m_ownSeqsMutex);
+            if (m_ownSeqs.remove(c.seq)) {
+                continue;
+            }
+        }
+        describeChange(c, touched);
+        if (c.entity == "sale") {
+            sales.append(c);
+        }
+    }
+
+    // The sales store hears of this process's own sales as they commit; the others' are patched in here, so
+    // columnar reports keep matching the SQL ones
+    auto& store = SalesStore::instance();
+    for (const auto& c : sales) {
+        const QJsonObject& d = c.payload;
+        if (c.op == "delete") {
+            store.removeTransaction(localIdFor("sale", d["origin"].toString(), d["id"].toInteger()));
+        } else if (c.origin != m_branchId && !m_reportAllBranches) {
+            continue;  // imported from another branch
+        } else if (int id = localIdFor("sale", c.origin, d["id"].toInteger())) {
+            const Transaction t = getTransactionById(id);
+            if (t.id != 0) {
+                store.append(t);
+            }
+        }
+    }
+    notifyChanged(touched);
+}
+
+// The rows here that a change committed by another process touched, found the way replayChange finds them. Rows
+// it deleted cannot be named any more, so those only say that something is gone.
+void Database::describeChange(const Change& change, DataChange& touched) {
+    const QJsonObject& d = change.payload;
+    auto product = [&](const QJsonObject& names) {
+        if (int id = productIdByName(names["generic_name"].toString(), names["brand_name"].toString())) {
+            touched.products.append(id);
+        }
+    };
+    auto invoice = [&](const QString& number) {
+        if (int id = getInvoiceByNumber(number).id) {
+            touched.invoices.append(id);
+        }
+    };
+
+    if (change.op == "delete") {
+        touched.unknown = true;
+        if (change.entity == "sale") {
+            if (int id = localIdFor("sale", d["origin"].toString(), d["id"].toInteger())) {
+                touched.transactions.append(id);
+            }
+        }
+    } else if (change.entity == "product") {
+        product(d);
+    } else if (change.entity == "invoice") {
+        invoice(d["invoice_number"].toString());
+    } else if (change.entity == "stock_in") {
+        product(d);
+        invoice(d["invoice_number"].toString());
+    } else if (change.entity == "sale") {
+        if (int id = localIdFor("sale", change.origin, d["id"].toInteger())) {
+            touched.transactions.append(id);
+            for (const auto& item : getTransactionById(id).items) {
+                touched.products.append(item.productId);
+            }
+        }
+    }
+}
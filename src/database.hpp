@@ -1,24 +1,59 @@
 #pragma once
 
 #include <QDate>
+#include <QHash>
+#include <QJsonObject>
 #include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
 #include <QString>
+#include <QTimeZone>
+#include <atomic>
+#include <functional>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
 
 #include "models.hpp"
 
+class QThread;
+
+// Position in a stock card listing between calls to Database::fetchStockCard.
+struct StockCardCursor {
+    QDate fromDate;
+    QDate toDate;
+    QDate lastDate;  // key of the last row returned; invalid before the first page
+    int lastProductId = 0;
+    bool atEnd = false;
+};
+
 class Database {
   public:
     static Database& instance();
 
-    bool open(const QString& path);
+    // Step being applied and 0-100 within it, while an older file is brought up to date.
+    using MigrationProgress = std::function<void(const QString& step, int percent)>;
+
+    // A read-only open skips schema setup and never writes to the file (headless reports); it fails on a
+    // file the till has not upgraded yet.
+    bool open(const QString& path, bool readOnly = false, const MigrationProgress& progress = {});
     void close();
     [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] QString path() const;
+
+    // Connection for the calling thread. The thread that called open() uses the main connection; any other
+    // thread gets its own connection to the same file, which it should drop with releaseThreadConnection().
+    QSqlDatabase db();
+    void releaseThreadConnection();
     [[nodiscard]] QString lastError() const;
 
-    bool initSchema();
+    // Applies the migrations the file has not had yet, in order. PRAGMA user_version records the last one,
+    // so opening an up-to-date file costs a single pragma read.
+    bool initSchema(const MigrationProgress& progress = {});
+    // -1 if it cannot be read.
+    int schemaVersion();
+    static int latestSchemaVersion();
 
     // Users
     bool createUser(const QString& username, const QString& password, bool isAdmin = false);
@@ -39,6 +74,12 @@ class Database {
     QList<Product> listProducts(const QString& nameFilter = QString(), int limit = 50, int offset = 0);
     QList<Product> searchProducts(const QString& name, int limit = 50);
     Product getProductById(int id);
+    // Current stock level of each of `productIds` that still exists, in one query.
+    QHash<int, int> getProductQuantities(const QList<int>& productIds);
+    // Current generic name of each of `productIds` that still exists.
+    QHash<int, QString> getProductNames(const QList<int>& productIds);
+    // Non-empty barcodes of `productIds`, or of every product when the list is empty.
+    QHash<int, QString> getProductBarcodes(const QList<int>& productIds);
     Product getProductByBarcode(const QString& barcode);
     int countProducts();
     bool importProducts(const QList<Product>& products);
@@ -46,11 +87,32 @@ class Database {
     bool decrementProductQty(int id, int qty);
 
     // Transactions
-    bool createTransaction(const Transaction& t);
+    // On success t.id is set to the new transaction's id.
+    bool createTransaction(Transaction& t);
     bool deleteTransaction(int id);
+    // Newest first, from the live file only.
     QList<Transaction> listTransactions(int limit = 50, int offset = 0);
+    // Looks in the archives when the sale is no longer in the live file.
     Transaction getTransactionById(int id);
 
+    // Archives: whole years of transactions moved out of the live file into "<name>-<year>.db" beside it, so the
+    // file the till writes to stays small. They are attached read-only, per connection, when a query needs them.
+    // Moves the sales of `year` into its archive; returns how many moved, or -1. Not inside a transaction.
+    int archiveYear(int year);
+    QList<int> archivedYears();
+    [[nodiscard]] QString archivePath(int year) const;
+    // Attaches the archive of `year` to the calling thread's connection as schema "archive_<year>", read-only.
+    bool attachArchive(int year);
+    // FROM-clause source for the sales dated [from, to] (a null date leaves that end open): `transactions`, or
+    // its UNION ALL with the archives of the years the range reaches. Other branches' sales are left out unless
+    // reportAllBranches() is set.
+    QString transactionsSource(const QDate& from = QDate(), const QDate& to = QDate());
+    // Sales replayed from other branches' delta bundles (those sync_ids maps to a local id) are this file's record
+    // of another shop's takings. Reports and the sales store leave them out unless this is set, the reports'
+    // "All branches" option; the quick-pick ranking never counts them.
+    void setReportAllBranches(bool all);
+    [[nodiscard]] bool reportAllBranches() const { return m_reportAllBranches; }
+
     // Invoices
     bool createInvoice(Invoice& inv);
     bool updateInvoice(const Invoice& inv);
@@ -60,27 +122,138 @@ class Database {
     Invoice getInvoiceByNumber(const QString& num);
 
     // Stock In
-    bool addStockIn(const StockInItem& item);
+    // Sets item.id on success.
+    bool addStockIn(StockInItem& item);
     bool deleteStockIn(int id);
     QList<StockInItem> getStockInByInvoice(int invoiceId);
     StockInItem getStockInById(int id);
 
-    // Reports
+    // The shop's time zone: the `shop_time_zone` setting (an IANA id such as "Africa/Kampala"), else the
+    // system's. Sales and stock movements are filed under their date there.
+    QTimeZone shopTimeZone();
+    QDate shopToday();
+
+    // Reports, bucketed by the sale date in the shop's time zone
     QList<SalesReport> getDailySalesReports(const QString& dateFilter = QString());
     QList<MonthlySalesReport> getMonthlySalesReports();
+    // Range variants, oldest first. The monthly range covers the whole months of both dates.
+    QList<SalesReport> getDailySalesReports(const QDate& fromDate, const QDate& toDate);
+    QList<MonthlySalesReport> getMonthlySalesReports(const QDate& fromDate, const QDate& toDate);
     QList<AnnualSalesReport> getAnnualSalesReports();
     QList<ProductSale> getDailyProductSales(const QDate& date);
     QList<ProductSale> getMonthlyProductSales(int year, int month);
     QList<ProductSale> getAnnualProductSales(int year);
-    QList<StockCard> getStockCard(const QDate& fromDate, const QDate& toDate);
+    // Next page (at most `limit` rows) of the all-products stock card, newest day first.
+    QList<StockCard> fetchStockCard(StockCardCursor& cursor, int limit);
+    // One row per day for a single product; days without movement carry the previous closing balance.
+    QList<StockCard> getProductStockCard(int productId, const QDate& fromDate, const QDate& toDate);
+
+    // Streaming readers for exports: each row is handed to `row` straight off a forward-only query, so memory
+    // stays flat however long the range is. Return false from `row` to stop early. Safe on worker threads.
+    bool forEachProductSale(SalesPeriod period, const QDate& fromDate, const QDate& toDate,
+                            const std::function<bool(const ProductSale&)>& row);
+    // Widens [from, to] to the whole months/years a monthly/annual report covers.
+    static void expandToPeriod(SalesPeriod period, QDate& from, QDate& to);
+
+    // The `n` best products over [fromDate, toDate] by `metric`, one row per product id with the range totals.
+    // transactionDate is left null; costPrice and sellingPrice are averages per unit sold.
+    QList<ProductSale> getTopProducts(const QDate& fromDate, const QDate& toDate, ProductMetric metric, int n);
+    // productId 0 streams the all-products card (newest day first); otherwise the gap-filled card of one product.
+    bool forEachStockCardRow(int productId, const QDate& fromDate, const QDate& toDate,
+                             const std::function<bool(const StockCard&)>& row);
 
-    // Most common products
+    // Most common products, ranked by the recency-weighted popularity index that createTransaction maintains
     QList<Product> getMostCommonProducts(int limit = 10);
+    // Popularity score of each of `productIds` that has one; scores only compare with each other.
+    QHash<int, double> getPopularityScores(const QList<int>& productIds);
 
-    // Transaction helpers
-    bool beginTransaction();
+    // Held baskets: the till journals its basket so a crash loses nothing and baskets can be parked.
+    // Returns the new basket id, or 0 on failure.
+    int createHeldBasket(int userId, bool active);
+    // Appends all entries in one transaction and touches updated_at of their baskets.
+    bool appendBasketJournal(const QList<BasketJournalEntry>& entries);
+    // Parking also compacts the journal to one entry per remaining line.
+    bool setHeldBasketActive(int basketId, bool active, const QString& label = QString());
+    bool deleteHeldBasket(int basketId);
+    // Every held basket (all tills), oldest first.
+    QList<HeldBasket> getHeldBaskets();
+
+    // Settings (shop-wide key/value pairs stored in the database)
+    QString setting(const QString& key, const QString& defaultValue = QString());
+    bool setSetting(const QString& key, const QString& value);
+
+    // Stock alerts
+    int defaultReorderLevel();
+    bool setReorderLevel(int productId, int level);
+    // All products that are at/below their reorder level or have a batch expiring on or before `horizon`.
+    QList<StockAlert> getStockAlerts(const QDate& horizon);
+    // Current alert inputs for the given products, whether or not they are in alert.
+    QList<StockAlert> getStockAlertInputs(const QList<int>& productIds);
+
+    // Change log: every write to products, invoices, stock-ins and sales appends a change in the same transaction,
+    // so branches can send each other what happened since they last exchanged (see deltasync.hpp). Sales and
+    // stock-ins travel as operations and quantity changes as deltas, so files that exchange everything converge
+    // on the same stock whatever order the bundles arrive in.
+    struct Change {
+        qint64 seq = 0;        // order in this file
+        QString origin;        // branch id of the file that made the change
+        qint64 originSeq = 0;  // order there
+        QString entity;        // product, invoice, stock_in or sale
+        QString op;            // upsert, adjust, insert or delete
+        QJsonObject payload;
+        qint64 createdAt = 0;  // epoch milliseconds
+    };
+    // Random id given to this file when its change log was created.
+    [[nodiscard]] QString branchId() const;
+    // Changes with seq > `afterSeq`, oldest first, straight off a forward-only query.
+    bool forEachChange(qint64 afterSeq, const std::function<bool(const Change&)>& row);
+    // Replays a change made in another file through the normal write paths, unless this file already has it
+    // (`applied` says which), and logs it as received so it is passed on to further branches. Another branch's
+    // sales, stock-ins and counts move this file's stock only with `sync_shared_stock` set to 1.
+    bool applyChange(const Change& change, bool& applied);
+    // Highest seq already sent to `peer`; the exporter's watermark.
+    qint64 exportedSeq(const QString& peer);
+    bool setExportedSeq(const QString& peer, qint64 seq);
+    bool setImported(const QString& origin, qint64 originSeq);
+
+    // What committed writes touched, so open screens can patch the affected rows instead of reloading. A listed
+    // row that can no longer be read was deleted.
+    struct DataChange {
+        QList<int> products;      // stock level, expiry dates, reorder level, prices or names
+        QList<int> transactions;  // sales made or deleted
+        QList<int> invoices;      // created, edited or deleted, or stock booked in against them
+        bool unknown = false;     // another process deleted rows this one cannot name; views reload
+        [[nodiscard]] bool isEmpty() const;
+        void merge(const DataChange& other);
+    };
+    // Listeners run on the main thread once the write is committed. Everything committed during one event-loop
+    // turn (a write-queue batch, an import) arrives as one change.
+    using ChangeListener = std::function<void(const DataChange& change)>;
+    int addChangeListener(ChangeListener listener);
+    void removeChangeListener(int id);
+    // Announces what other processes (tills on the same file, a delta import) have committed since the last call,
+    // read from the change log. This process's own writes were announced when they committed and are skipped.
+    void pollChanges();
+
+    // Transaction helpers. They nest: inside an open transaction, begin/commit/rollback work on a savepoint, so a
+    // nested write that fails undoes only itself. State is per thread, like the connections. The outermost begin
+    // takes the write lock up front; while another till holds it, begin retries with jittered backoff for up to
+    // 10 s before failing, or 250 ms with `briefLockWait` for a caller that retries later itself (WriteQueue).
+    bool beginTransaction(bool briefLockWait = false);
+    // The last outermost begin on this thread failed because another connection kept the write lock.
+    [[nodiscard]] bool lockTimedOut() const;
     bool commitTransaction();
     bool rollbackTransaction();
+    // Runs `hook` once the outermost transaction commits (now, outside one); dropped if its level rolls back.
+    void afterCommit(std::function<void()> hook);
+
+    // Write-lock contention this process has seen since it started.
+    struct LockStats {
+        qint64 retries = 0;   // begins that found another connection writing and backed off
+        qint64 waitMs = 0;    // time spent waiting for the write lock
+        qint64 timeouts = 0;  // begins that gave up
+    };
+    [[nodiscard]] LockStats lockStats() const;
 
     // Deleted constructors/operators MUST be public to prevent misuse by other classes, but we make them private to
     // prevent instantiation
@@ -91,8 +264,37 @@ class Database {
     Database() = default;
     ~Database() = default;
 
+    // Progress of one long step (a schema migration or an index rebuild), 0-100
+    using StepProgress = std::function<void(int percent)>;
+    struct Migration {
+        int version = 0;
+        const char* description = "";
+        bool (Database::*apply)(const StepProgress& progress) = nullptr;
+    };
+
     QSqlDatabase m_db;
-    QString m_lastError;
+    QString m_path;
+    QString m_branchId;
+    bool m_readOnly = false;
+    QThread* m_ownerThread = nullptr;
+    static thread_local QString m_lastError;  // per thread, like the connections
+    static thread_local int m_txDepth;        // open transaction levels on this thread's connection
+    static thread_local QList<QPair<int, std::function<void()>>> m_afterCommit;  // (level, hook)
+    static thread_local int m_replaying;  // applyChange is running: writes are not logged as local changes
+    static thread_local bool m_lockTimedOut;
+    static thread_local bool m_replayStock;  // the change being replayed moves this file's stock too
+    std::atomic<bool> m_reportAllBranches{false};
+    std::atomic<qint64> m_lockRetries{0};
+    std::atomic<qint64> m_lockWaitMs{0};
+    std::atomic<qint64> m_lockTimeouts{0};
+    QHash<int, ChangeListener> m_changeListeners;
+    int m_nextListenerId = 1;
+    DataChange m_pendingChange;  // committed, waiting for the next event-loop turn
+    bool m_deliveryQueued = false;
+    qint64 m_polledSeq = 0;  // change log read up to here by pollChanges
+    std::atomic<bool> m_polling{false};
+    QMutex m_ownSeqsMutex;
+    QSet<qint64> m_ownSeqs;  // change log rows this process committed and has not polled past yet
 
     Product productFromQuery(QSqlQuery& q);
     User userFromQuery(QSqlQuery& q);
@@ -105,5 +307,47 @@ class Database {
     bool removeProductExpiry(int productId, const QDate& date);
     QList<QDate> getProductExpiry(int productId);
 
+    // One day's movement of a product for stock_balances; openingQty only counts for the day's first row.
+    struct StockMovement {
+        int productId = 0;
+        int openingQty = 0;
+        int qtyIn = 0;
+        int qtyOut = 0;
+        int qtyReversal = 0;
+    };
     void updateStockBalance(int productId, int openingQty, int qtyIn, int qtyOut = 0, int qtyReversal = 0);
+    bool recordStockMovements(const QList<StockMovement>& movements);
+    void notifyChanged(const DataChange& change);
+    void deliverChanges();
+    void describeChange(const Change& change, DataChange& touched);
+    bool recordSale(Transaction& t, const QDateTime& at, bool checkStock);
+
+    // Change log helpers, in database.cpp
+    bool logChange(const QString& entity, const QString& op, const QJsonObject& payload);
+    void rememberOwnChange(qint64 seq);
+    QJsonObject changeRef(const QString& entity, int localId);
+    int localIdFor(const QString& entity, const QString& origin, qint64 originId);
+    bool mapSyncId(const QString& entity, const QString& origin, qint64 originId, int localId);
+    int productIdByName(const QString& genericName, const QString& brandName);
+    int ensureProduct(const QJsonObject& names, Money costPrice, Money sellingPrice);
+    int userIdByName(const QString& username);
+    bool replayChange(const Change& change);
+    // False while replaying another branch's change into a file that keeps its own stock.
+    [[nodiscard]] bool movesStock() const { return m_replaying == 0 || m_replayStock; }
+    double popularityWeight(const QDateTime& at);
+    bool bumpPopularity(const QList<TransactionItem>& items);
+    bool dropPopularity(const QList<int>& productIds, const QDateTime& soldAt);
+    bool rebuildPopularity(const StepProgress& progress = {});
+    bool compactBasketJournal(int basketId);
+    StockAlert stockAlertFromQuery(QSqlQuery& q);
+
+    // Schema migrations, in database.cpp. Each step runs in one transaction with its user_version bump, so an
+    // interrupted upgrade resumes at the step that did not finish.
+    static const QList<Migration>& migrations();
+    bool migrateBaseSchema(const StepProgress& progress);
+    bool migratePopularityIndex(const StepProgress& progress);
+    bool migrateMoneyToCents(const StepProgress& progress);
+    bool migrateSaleDate(const StepProgress& progress);
+    bool migrateEpochTimestamps(const StepProgress& progress);
+    bool migrateChangeLog(const StepProgress& progress);
 };
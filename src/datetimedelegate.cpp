@@ -0,0 +1,12 @@
+#include "datetimedelegate.hpp"
+#include <QDateTime>
+
+DateTimeDelegate::DateTimeDelegate(const QString& format, QObject* parent)
+    : QStyledItemDelegate(parent), m_format(format) {}
+
+QString DateTimeDelegate::displayText(const QVariant& value, const QLocale& locale) const {
+    if (value.metaType().id() == QMetaType::QDateTime) {
+        return value.toDateTime().toString(m_format);
+    }
+    return QStyledItemDelegate::displayText(value, locale);
+}
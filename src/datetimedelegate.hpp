@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QString>
+#include <QStyledItemDelegate>
+
+// Shows QDateTime cell values in a fixed format. Tables keep the QDateTime itself in the display role, so
+// text is only produced for the cells that are actually painted.
+class DateTimeDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+  public:
+    explicit DateTimeDelegate(const QString& format, QObject* parent = nullptr);
+
+    QString displayText(const QVariant& value, const QLocale& locale) const override;
+
+  private:
+    QString m_format;
+};
@@ -0,0 +1,186 @@
+#include "deltasync.hpp"
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include "database.hpp"
+
+// File layout: this line, then the zlib-compressed (qCompress) JSON document
+//   {"format": 1, "origin": <branch id>, "from": seq, "to": seq, "created_at": ms, "origins": [<branch id>, ...],
+//    "changes": [[<index into origins>, origin_seq, entity, op, created_at, payload], ...]}
+static const QByteArray kMagic = "TELLA-DELTA 1\n";
+
+QString DeltaReport::summary() const {
+    if (!ok) {
+        return QString("Delta %1 failed: %2").arg(file.isEmpty() ? QString("exchange") : file, error);
+    }
+    if (file.isEmpty()) {
+        return "No changes to export";
+    }
+    if (fromSeq != 0 || toSeq != 0) {
+        return QString("Exported %1 changes (%2-%3) to %4, %5 KB in %6 ms")
+            .arg(changes)
+            .arg(fromSeq + 1)
+            .arg(toSeq)
+            .arg(QDir::toNativeSeparators(file))
+            .arg(static_cast<double>(bytes) / 1024.0, 0, 'f', 1)
+            .arg(elapsedMs);
+    }
+    QString text = QString("Imported %1: %2 applied, %3 already here, %4 failed in %5 ms")
+                       .arg(QDir::toNativeSeparators(file))
+                       .arg(applied)
+                       .arg(skipped)
+                       .arg(failed)
+                       .arg(elapsedMs);
+    if (!error.isEmpty()) {
+        text += " (first failure: " + error + ")";
+    }
+    return text;
+}
+
+DeltaReport DeltaSync::exportBundle(const QString& directory, const QString& peer) {
+    DeltaReport report;
+    QElapsedTimer timer;
+    timer.start();
+    auto& db = Database::instance();
+
+    // Origins are listed once and referred to by index, so each change carries a small integer instead of an id
+    report.fromSeq = db.exportedSeq(peer);
+    QJsonArray origins;
+    QHash<QString, int> originIndex;
+    QJsonArray changes;
+    bool read = db.forEachChange(report.fromSeq, [&](const Database::Change& c) {
+        auto it = originIndex.constFind(c.origin);
+        if (it == originIndex.cend()) {
+            it = originIndex.insert(c.origin, static_cast<int>(origins.size()));
+            origins.append(c.origin);
+        }
+        changes.append(QJsonArray{*it, c.originSeq, c.entity, c.op, c.createdAt, c.payload});
+        report.toSeq = c.seq;
+        return true;
+    });
+    if (!read) {
+        report.error = db.lastError();
+        return report;
+    }
+    report.changes = static_cast<int>(changes.size());
+    if (changes.isEmpty()) {
+        report.ok = true;
+        report.fromSeq = report.toSeq = 0;
+        report.elapsedMs = timer.elapsed();
+        return report;
+    }
+
+    const QJsonObject bundle{
+        {"format", 1},
+        {"origin", db.branchId()},
+        {"from", report.fromSeq},
+        {"to", report.toSeq},
+        {"created_at", QDateTime::currentMSecsSinceEpoch()},
+        {"origins", origins},
+        {"changes", changes},
+    };
+    const QByteArray bytes = kMagic + qCompress(QJsonDocument(bundle).toJson(QJsonDocument::Compact), 9);
+
+    report.file = QDir(directory).filePath(
+        QString("tella-%1-%2-%3.tdelta").arg(db.branchId().left(8)).arg(report.fromSeq + 1).arg(report.toSeq));
+    QSaveFile out(report.file);
+    if (!out.open(QIODevice::WriteOnly) || out.write(bytes) != bytes.size() || !out.commit()) {
+        report.error = out.errorString();
+        return report;
+    }
+    report.bytes = bytes.size();
+
+    // Only moved once the bundle is safely on disk; a bundle sent twice is harmless, one never sent is not
+    if (!db.setExportedSeq(peer, report.toSeq)) {
+        report.error = db.lastError();
+        return report;
+    }
+    report.ok = true;
+    report.elapsedMs = timer.elapsed();
+    return report;
+}
+
+DeltaReport DeltaSync::importBundle(const QString& file) {
+    DeltaReport report;
+    report.file = file;
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        report.error = in.errorString();
+        return report;
+    }
+    const QByteArray bytes = in.readAll();
+    report.bytes = bytes.size();
+    if (!bytes.startsWith(kMagic)) {
+        report.error = "not a Tella delta bundle";
+        return report;
+    }
+    const QJsonObject bundle = QJsonDocument::fromJson(qUncompress(bytes.mid(kMagic.size()))).object();
+    if (bundle["format"].toInt() != 1) {
+        report.error = "unreadable or unsupported bundle";
+        return report;
+    }
+
+    const QJsonArray origins = bundle["origins"].toArray();
+    const QJsonArray changes = bundle["changes"].toArray();
+    report.changes = static_cast<int>(changes.size());
+
+    // One transaction for the whole bundle; each change is a savepoint inside it, so one that cannot be applied
+    // is rolled back alone and the rest still land
+    auto& db = Database::instance();
+    if (!db.beginTransaction()) {
+        report.error = db.lastError();
+        return report;
+    }
+    for (const auto& value : changes) {
+        const QJsonArray row = value.toArray();
+        const int origin = row.at(0).toInt(-1);
+        if (row.size() < 6 || origin < 0 || origin >= origins.size()) {
+            ++report.failed;
+            if (report.error.isEmpty()) {
+                report.error = "malformed change";
+            }
+            continue;
+        }
+        Database::Change c;
+        c.origin = origins.at(origin).toString();
+        c.originSeq = row.at(1).toInteger();
+        c.entity = row.at(2).toString();
+        c.op = row.at(3).toString();
+        c.createdAt = row.at(4).toInteger();
+        c.payload = row.at(5).toObject();
+
+        bool applied = false;
+        if (!db.applyChange(c, applied)) {
+            ++report.failed;
+            if (report.error.isEmpty()) {
+                report.error = QString("%1 %2 from %3: %4").arg(c.entity, c.op, c.origin, db.lastError());
+            }
+        } else if (applied) {
+            ++report.applied;
+        } else {
+            ++report.skipped;
+        }
+    }
+    if (!db.setImported(bundle["origin"].toString(), bundle["to"].toInteger())) {
+        report.error = db.lastError();
+        db.rollbackTransaction();
+        return report;
+    }
+    if (!db.commitTransaction()) {
+        report.error = db.lastError();
+        report.applied = 0;
+        return report;
+    }
+    report.ok = true;
+    report.elapsedMs = timer.elapsed();
+    return report;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QString>
+
+struct DeltaReport {
+    bool ok = false;
+    QString error;       // for an import, the first change that could not be applied
+    QString file;        // the bundle written or read
+    int changes = 0;     // in the bundle
+    int applied = 0;     // import: new to this file
+    int skipped = 0;     // import: already here
+    int failed = 0;      // import: rolled back on their own
+    qint64 fromSeq = 0;  // export: the change-log range written, (fromSeq, toSeq]
+    qint64 toSeq = 0;
+    qint64 bytes = 0;
+    qint64 elapsedMs = 0;
+
+    [[nodiscard]] QString summary() const;
+};
+
+// Delta bundles between branches: the change log since a watermark, written as one compressed file that can go
+// across on a USB stick or through a shared folder, and applied at the other end in a single transaction.
+//
+// A bundle holds every change the file has, its own and those it received, so branches that only exchange with a
+// head office still see each other's. Importing is idempotent: changes are keyed by the branch that made them and
+// their order there, and the ones a file already has are skipped, so a bundle can be imported twice or arrive by
+// two routes. Runs on the calling thread with Database::instance().
+class DeltaSync {
+  public:
+    // Writes the changes not yet sent to `peer` (any name: a branch, "head-office", a shared folder) into a new
+    // "tella-<branch>-<from>-<to>.tdelta" in `directory`, then moves the peer's watermark past them. Writes
+    // nothing when there is nothing new.
+    static DeltaReport exportBundle(const QString& directory, const QString& peer);
+    static DeltaReport importBundle(const QString& file);
+};
@@ -0,0 +1,116 @@
+#include "escpos.hpp"
+#include <QString>
+#include <algorithm>
+#include <initializer_list>
+
+static constexpr char ESC = 0x1B;
+static constexpr char GS = 0x1D;
+static constexpr int kRasterBandRows = 256;  // rows per GS v 0 command; some printers buffer no more
+
+static QByteArray cmd(std::initializer_list<char> bytes) {
+    return QByteArray(bytes.begin(), static_cast<qsizetype>(bytes.size()));
+}
+
+static QByteArray text(const QString& s) { return s.toLatin1(); }
+
+// `s` cut or padded to exactly `width` columns
+static QByteArray cell(const QString& s, int width, bool alignRight = false) {
+    QString fitted = s.left(width);
+    return text(alignRight ? fitted.rightJustified(width) : fitted.leftJustified(width));
+}
+
+static QByteArray row(const QString& left, const QString& right, int columns) {
+    int rightWidth = std::min(static_cast<int>(right.size()), columns);
+    return cell(left, columns - rightWidth) + cell(right, rightWidth, true) + '\n';
+}
+
+static QByteArray rule(char c, int columns) { return QByteArray(columns, c) + '\n'; }
+
+// Everything before the first per-sale byte. It never changes, so it is built once per process.
+static const QByteArray& receiptHeader() {
+    static const QByteArray header = [] {
+        QByteArray b;
+        b += cmd({ESC, '@'});  // initialise
+        b += cmd({ESC, 't', 16});  // code page WPC1252
+        b += cmd({ESC, 'a', 1});  // centre
+        b += cmd({GS, '!', 0x11});  // double width and height
+        b += "Tella POS\n";
+        b += cmd({GS, '!', 0x00});
+        b += "Sales Receipt\n";
+        b += cmd({ESC, 'a', 0});  // left
+        return b;
+    }();
+    return header;
+}
+
+QByteArray escPosReceipt(const Transaction& t, int columns) {
+    // Qty, price and subtotal columns; the name gets the rest, or a line of its own when it does not fit
+    constexpr int qtyW = 5;
+    constexpr int priceW = 9;
+    constexpr int subW = 10;
+    const int nameW = std::max(columns - qtyW - priceW - subW, 0);
+
+    QByteArray b = receiptHeader();
+    b.reserve(b.size() + (t.items.size() + 16) * (columns + 1));
+    b += rule('=', columns);
+    b += row("Date:", t.createdAt.toString("dd/MM/yyyy hh:mm"), columns);
+    b += row("Ref #:", QString::number(t.id), columns);
+    b += rule('-', columns);
+
+    b += cmd({ESC, 'E', 1});  // bold
+    b += cell("Item", nameW) + cell("Qty", qtyW, true) + cell("Price", priceW, true) + cell("Sub", subW, true) + '\n';
+    b += cmd({ESC, 'E', 0});
+    b += rule('-', columns);
+
+    Money grandTotal;
+    for (const auto& item : t.items) {
+        const Money sub = item.subtotal();
+        grandTotal += sub;
+
+        QString name = item.genericName;
+        if (!item.brandName.isEmpty() && name.size() + item.brandName.size() + 3 <= nameW) {
+            name += " (" + item.brandName + ")";
+        }
+        if (name.size() > nameW) {
+            b += cell(name, columns).trimmed() + '\n';
+            name.clear();
+        }
+        b += cell(name, nameW) + cell(QString::number(item.quantity), qtyW, true) +
+             cell(QString::number(item.sellingPrice.toDouble(), 'f', 0), priceW, true) +
+             cell(QString::number(sub.toDouble(), 'f', 0), subW, true) + '\n';
+    }
+
+    b += rule('=', columns);
+    b += cmd({ESC, 'E', 1});
+    b += cmd({GS, '!', 0x01});  // double height keeps the columns lined up
+    b += row("TOTAL (UGX)", QString::number(grandTotal.toDouble(), 'f', 2), columns);
+    b += cmd({GS, '!', 0x00});
+    b += cmd({ESC, 'E', 0});
+    b += rule('=', columns);
+
+    b += cmd({ESC, 'a', 1});
+    b += "Thank you for your purchase!\n";
+    b += "Tella POS - Serving you better\n";
+    b += cmd({ESC, 'a', 0});
+    b += cmd({ESC, 'd', 4});  // feed past the cutter
+    b += cmd({GS, 'V', 66, 0});  // partial cut
+    return b;
+}
+
+QByteArray escPosRaster(const QByteArray& bits, int widthBytes, int height) {
+    QByteArray b;
+    b.reserve(bits.size() + (height / kRasterBandRows + 1) * 8 + 16);
+    b += cmd({ESC, '@'});
+    for (int y = 0; y < height; y += kRasterBandRows) {
+        const int rows = std::min(kRasterBandRows, height - y);
+        b += cmd({GS, 'v', '0', 0});
+        b += static_cast<char>(widthBytes & 0xFF);
+        b += static_cast<char>((widthBytes >> 8) & 0xFF);
+        b += static_cast<char>(rows & 0xFF);
+        b += static_cast<char>((rows >> 8) & 0xFF);
+        b += bits.mid(static_cast<qsizetype>(y) * widthBytes, static_cast<qsizetype>(rows) * widthBytes);
+    }
+    b += cmd({ESC, 'd', 4});
+    b += cmd({GS, 'V', 66, 0});
+    return b;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QByteArray>
+#include "models.hpp"
+
+// ESC/POS byte streams for thermal receipt printers. Only QtCore is used, so the same bytes come out of
+// the print worker thread and out of `tella --receipt`, which makes the output easy to diff.
+
+constexpr int kReceiptColumns = 48;  // Font A on 80 mm paper
+constexpr int kReceiptDots = 576;    // printable width of 80 mm paper at 203 dpi
+
+// Whole receipt as printer text: initialise, shop header, lines, total, footer, feed and cut.
+// Text is sent in code page WPC1252; characters outside it print as '?'.
+QByteArray escPosReceipt(const Transaction& t, int columns = kReceiptColumns);
+
+// A pre-rendered receipt as GS v 0 raster bands, for printers without a usable character set.
+// `bits` holds `height` rows of `widthBytes` bytes each, most significant bit leftmost, 1 = black.
+QByteArray escPosRaster(const QByteArray& bits, int widthBytes, int height);
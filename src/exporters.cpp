@@ -0,0 +1,576 @@
+#include "exporters.hpp"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QtEndian>
+#include <array>
+#include "database.hpp"
+
+namespace {
+
+constexpr qsizetype kFlushThreshold = 64 * 1024;
+
+// zlib-compatible CRC-32; chainable, start with 0
+quint32 crc32Update(quint32 crc, const char* data, qsizetype len) {
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc ^= 0xFFFFFFFFu;
+    for (qsizetype i = 0; i < len; ++i) {
+        crc = table[(crc ^ static_cast<quint8>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void put16(QByteArray& b, quint16 v) {
+    char buf[2];
+    qToLittleEndian(v, buf);
+    b.append(buf, 2);
+}
+
+void put32(QByteArray& b, quint32 v) {
+    char buf[4];
+    qToLittleEndian(v, buf);
+    b.append(buf, 4);
+}
+
+void dosDateTime(quint16& time, quint16& date) {
+    QDateTime now = QDateTime::currentDateTime();
+    time = static_cast<quint16>((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+    date = static_cast<quint16>(((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day());
+}
+
+bool isNumeric(const QVariant& v) {
+    switch (v.typeId()) {
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+            return true;
+        default:
+            return false;
+    }
+}
+
+QString cellText(const QVariant& v) {
+    if (v.typeId() == QMetaType::QDate) {
+        return v.toDate().toString(Qt::ISODate);
+    }
+    if (v.typeId() == QMetaType::Double) {
+        return QString::number(v.toDouble(), 'f', 2);
+    }
+    return v.toString();
+}
+
+QByteArray xmlEscape(const QString& text) {
+    QString out;
+    out.reserve(text.size());
+    for (QChar c : text) {
+        switch (c.unicode()) {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '"':
+                out += "&quot;";
+                break;
+            default:
+                // Control characters other than tab/newline are not allowed in XML 1.0
+                if (c.unicode() >= 0x20 || c == '\t' || c == '\n' || c == '\r') {
+                    out += c;
+                }
+        }
+    }
+    return out.toUtf8();
+}
+
+}  // namespace
+
+// =================== TableSink ===================
+
+std::unique_ptr<TableSink> TableSink::forPath(const QString& path, const QString& sheetName) {
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "xlsx") {
+        return std::make_unique<XlsxSink>(path, sheetName);
+    }
+    if (suffix == "json") {
+        return std::make_unique<JsonSink>(path);
+    }
+    return std::make_unique<CsvSink>(path);
+}
+
+// =================== CsvSink ===================
+
+CsvSink::CsvSink(const QString& path) : m_file(path) {}
+
+CsvSink::CsvSink(FILE* stream) : m_stream(stream) {}
+
+bool CsvSink::open(const QStringList& headers) {
+    bool opened = m_stream ? m_file.open(m_stream, QIODevice::WriteOnly)
+                           : m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    if (!m_stream) {
+        // BOM so Excel picks UTF-8 for product names
+        m_file.write("\xEF\xBB\xBF");
+    }
+    return writeLine(headers);
+}
+
+bool CsvSink::writeRow(const QVariantList& row) {
+    QStringList fields;
+    fields.reserve(row.size());
+    for (const auto& v : row) {
+        fields << cellText(v);
+    }
+    return writeLine(fields);
+}
+
+bool CsvSink::writeLine(const QStringList& fields) {
+    QByteArray line;
+    for (int i = 0; i < fields.size(); ++i) {
+        if (i > 0) {
+            line += ',';
+        }
+        QString f = fields[i];
+        if (f.contains(',') || f.contains('"') || f.contains('\n') || f.contains('\r')) {
+            f = QString("\"%1\"").arg(f.replace("\"", "\"\""));
+        }
+        line += f.toUtf8();
+    }
+    line += "\r\n";
+    if (m_file.write(line) != line.size()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool CsvSink::finish() {
+    if (!m_file.flush()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_file.close();
+    return true;
+}
+
+// =================== JsonSink ===================
+
+JsonSink::JsonSink(const QString& path) : m_file(path) {}
+
+JsonSink::JsonSink(FILE* stream) : m_stream(stream) {}
+
+bool JsonSink::open(const QStringList& headers) {
+    bool opened = m_stream ? m_file.open(m_stream, QIODevice::WriteOnly)
+                           : m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_keys.clear();
+    for (const auto& h : headers) {
+        m_keys << h.toLower().replace(' ', '_');
+    }
+    m_rows = 0;
+    return m_file.write("[") == 1;
+}
+
+bool JsonSink::writeRow(const QVariantList& row) {
+    QJsonObject obj;
+    for (int i = 0; i < row.size() && i < m_keys.size(); ++i) {
+        const QVariant& v = row[i];
+        if (isNumeric(v)) {
+            obj[m_keys[i]] = v.toDouble();
+        } else {
+            obj[m_keys[i]] = cellText(v);
+        }
+    }
+    QByteArray line = (m_rows++ == 0 ? "\n" : ",\n") + QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    if (m_file.write(line) != line.size()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool JsonSink::finish() {
+    if (m_file.write("\n]\n") != 3 || !m_file.flush()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_file.close();
+    return true;
+}
+
+// =================== XlsxSink ===================
+
+XlsxSink::XlsxSink(const QString& path, const QString& sheetName) : m_file(path), m_sheetName(sheetName) {}
+
+bool XlsxSink::open(const QStringList& headers) {
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    const QByteArray decl = R"(<?xml version="1.0" encoding="UTF-8" standalone="yes"?>)"
+                            "\n";
+    if (!addEntry("[Content_Types].xml",
+                  decl + R"(<Types xmlns="http://schemas.openxmlformats.org/package/2006/content-types">)"
+                         R"(<Default Extension="rels" ContentType="application/vnd.openxmlformats-package.relationships+xml"/>)"
+                         R"(<Default Extension="xml" ContentType="application/xml"/>)"
+                         R"(<Override PartName="/xl/workbook.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml"/>)"
+                         R"(<Override PartName="/xl/worksheets/sheet1.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml"/>)"
+                         R"(</Types>)") ||
+        !addEntry("_rels/.rels",
+                  decl + R"(<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">)"
+                         R"(<Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument" Target="xl/workbook.xml"/>)"
+                         R"(</Relationships>)") ||
+        !addEntry("xl/workbook.xml",
+                  decl + R"(<workbook xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main" )"
+                         R"(xmlns:r="http://schemas.openxmlformats.org/officeDocument/2006/relationships">)"
+                         R"(<sheets><sheet name=")" +
+                      xmlEscape(m_sheetName.left(31)) + R"(" sheetId="1" r:id="rId1"/></sheets></workbook>)") ||
+        !addEntry("xl/_rels/workbook.xml.rels",
+                  decl + R"(<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">)"
+                         R"(<Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet" Target="worksheets/sheet1.xml"/>)"
+                         R"(</Relationships>)")) {
+        return false;
+    }
+
+    if (!beginEntry("xl/worksheets/sheet1.xml")) {
+        return false;
+    }
+    m_buffer = decl + R"(<worksheet xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main"><sheetData>)";
+
+    QVariantList headerRow;
+    for (const auto& h : headers) {
+        headerRow << h;
+    }
+    return writeRowXml(headerRow);
+}
+
+bool XlsxSink::writeRow(const QVariantList& row) { return writeRowXml(row); }
+
+bool XlsxSink::writeRowXml(const QVariantList& row) {
+    m_buffer += "<row r=\"" + QByteArray::number(++m_rowNumber) + "\">";
+    for (const auto& v : row) {
+        if (isNumeric(v)) {
+            m_buffer += "<c><v>" + QByteArray::number(v.toDouble(), 'g', 15) + "</v></c>";
+        } else {
+            m_buffer += "<c t=\"inlineStr\"><is><t>" + xmlEscape(cellText(v)) + "</t></is></c>";
+        }
+    }
+    m_buffer += "</row>";
+    return m_buffer.size() < kFlushThreshold || flushSheet();
+}
+
+bool XlsxSink::flushSheet() {
+    if (m_buffer.isEmpty()) {
+        return true;
+    }
+    m_sheetCrc = crc32Update(m_sheetCrc, m_buffer.constData(), m_buffer.size());
+    m_sheetSize += m_buffer.size();
+    if (m_sheetSize > 0xFFFFFFFFll) {
+        m_error = "Export is too large for an XLSX file without ZIP64; use CSV instead.";
+        return false;
+    }
+    if (m_file.write(m_buffer) != m_buffer.size()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_buffer.clear();
+    return true;
+}
+
+bool XlsxSink::beginEntry(const QByteArray& name) {
+    quint16 time = 0;
+    quint16 date = 0;
+    dosDateTime(time, date);
+
+    Entry e;
+    e.name = name;
+    e.offset = static_cast<quint32>(m_file.pos());
+    m_entries.append(e);
+
+    // CRC and sizes are zero for now and patched in endEntry()
+    QByteArray h;
+    put32(h, 0x04034b50);
+    put16(h, 20);      // version needed
+    put16(h, 0x0800);  // UTF-8 names
+    put16(h, 0);       // stored
+    put16(h, time);
+    put16(h, date);
+    put32(h, 0);
+    put32(h, 0);
+    put32(h, 0);
+    put16(h, static_cast<quint16>(name.size()));
+    put16(h, 0);
+    h += name;
+    if (m_file.write(h) != h.size()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_sheetCrc = 0;
+    m_sheetSize = 0;
+    return true;
+}
+
+bool XlsxSink::endEntry() {
+    Entry& e = m_entries.last();
+    e.crc = m_sheetCrc;
+    e.size = static_cast<quint32>(m_sheetSize);
+
+    QByteArray patch;
+    put32(patch, e.crc);
+    put32(patch, e.size);
+    put32(patch, e.size);
+    qint64 end = m_file.pos();
+    if (!m_file.seek(e.offset + 14) || m_file.write(patch) != patch.size() || !m_file.seek(end)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool XlsxSink::addEntry(const QByteArray& name, const QByteArray& data) {
+    if (!beginEntry(name)) {
+        return false;
+    }
+    m_buffer = data;
+    return flushSheet() && endEntry();
+}
+
+bool XlsxSink::finish() {
+    m_buffer += "</sheetData></worksheet>";
+    if (!flushSheet() || !endEntry()) {
+        return false;
+    }
+
+    quint16 time = 0;
+    quint16 date = 0;
+    dosDateTime(time, date);
+
+    const qint64 cdOffset = m_file.pos();
+    QByteArray cd;
+    for (const auto& e : m_entries) {
+        put32(cd, 0x02014b50);
+        put16(cd, 20);  // version made by
+        put16(cd, 20);  // version needed
+        put16(cd, 0x0800);
+        put16(cd, 0);
+        put16(cd, time);
+        put16(cd, date);
+        put32(cd, e.crc);
+        put32(cd, e.size);
+        put32(cd, e.size);
+        put16(cd, static_cast<quint16>(e.name.size()));
+        put16(cd, 0);  // extra
+        put16(cd, 0);  // comment
+        put16(cd, 0);  // disk
+        put16(cd, 0);  // internal attributes
+        put32(cd, 0);  // external attributes
+        put32(cd, e.offset);
+        cd += e.name;
+    }
+
+    QByteArray eocd;
+    put32(eocd, 0x06054b50);
+    put16(eocd, 0);
+    put16(eocd, 0);
+    put16(eocd, static_cast<quint16>(m_entries.size()));
+    put16(eocd, static_cast<quint16>(m_entries.size()));
+    put32(eocd, static_cast<quint32>(cd.size()));
+    put32(eocd, static_cast<quint32>(cdOffset));
+    put16(eocd, 0);
+
+    if (m_file.write(cd) != cd.size() || m_file.write(eocd) != eocd.size() || !m_file.flush()) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_file.close();
+    return true;
+}
+
+// =================== ExportJob ===================
+
+ExportJob::ExportJob(QObject* parent) : QObject(parent) {}
+
+ExportJob::~ExportJob() {
+    if (m_thread) {
+        m_cancel = true;
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void ExportJob::cancel() { m_cancel = true; }
+
+bool ExportJob::start(const Request& request) {
+    if (m_running) {
+        return false;
+    }
+    m_running = true;
+    m_cancel = false;
+
+    m_thread = QThread::create([this, request] {
+        int lastPercent = -1;
+        QString message;
+        bool ok = run(
+            request,
+            [this, &lastPercent](int percent) {
+                if (percent != lastPercent) {
+                    lastPercent = percent;
+                    QMetaObject::invokeMethod(this, [this, percent] { emit progress(percent); }, Qt::QueuedConnection);
+                }
+                return !m_cancel;
+            },
+            &message);
+        Database::instance().releaseThreadConnection();
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, ok, message] {
+                m_running = false;
+                m_thread = nullptr;  // deleted via QThread::finished
+                emit finished(ok, message);
+            },
+            Qt::QueuedConnection);
+    });
+    connect(m_thread, &QThread::finished, m_thread, &QObject::deleteLater);
+    m_thread->start(QThread::LowPriority);
+    return true;
+}
+
+bool ExportJob::run(const Request& request, const std::function<bool(int percent)>& progress, QString* message) {
+    QElapsedTimer timer;
+    timer.start();
+
+    auto sink = TableSink::forPath(request.path, request.source == Source::StockCard ? "Stock Card" : "Sales");
+    qint64 rows = 0;
+    if (!write(request, *sink, progress, message, &rows)) {
+        sink.reset();
+        QFile::remove(request.path);
+        return false;
+    }
+
+    *message = QString("Exported %L1 rows to %2 in %3 s")
+                   .arg(rows)
+                   .arg(QFileInfo(request.path).fileName())
+                   .arg(timer.elapsed() / 1000.0, 0, 'f', 1);
+    return true;
+}
+
+bool ExportJob::write(const Request& request, TableSink& sink, const std::function<bool(int percent)>& progress,
+                      QString* message, qint64* rowCount) {
+    QStringList headers;
+    switch (request.source) {
+        case Source::ProductSales:
+            headers = {"Date", "Product ID", "Product", "Qty Sold", "Cost", "Selling Price", "Income", "Profit"};
+            break;
+        case Source::StockCard:
+            headers = {"Date", "Product ID", "Product", "Brand", "Opening", "In", "Out", "Reversal", "Closing"};
+            break;
+        case Source::DailyTotals:
+            headers = {"Date", "Income"};
+            break;
+        case Source::MonthlyTotals:
+            headers = {"Month", "Income"};
+            break;
+    }
+    if (!sink.open(headers)) {
+        *message = sink.error();
+        return false;
+    }
+
+    // Progress follows the date of the row being written; every source streams in date order
+    const qint64 days = qMax<qint64>(1, request.fromDate.daysTo(request.toDate) + 1);
+    const bool newestFirst = request.source == Source::StockCard && request.productId == 0;
+    qint64 rows = 0;
+    bool writeFailed = false;
+    bool cancelled = false;
+
+    auto emitRow = [&](const QDate& date, const QVariantList& values) {
+        if (!sink.writeRow(values)) {
+            writeFailed = true;
+            return false;
+        }
+        ++rows;
+        qint64 done = newestFirst ? date.daysTo(request.toDate) : request.fromDate.daysTo(date);
+        if (!progress(static_cast<int>(qBound<qint64>(0, done * 100 / days, 100)))) {
+            cancelled = true;
+            return false;
+        }
+        return true;
+    };
+
+    bool queryOk = true;
+    switch (request.source) {
+        case Source::ProductSales:
+            queryOk = Database::instance().forEachProductSale(
+                request.period, request.fromDate, request.toDate, [&](const ProductSale& s) {
+                    return emitRow(s.transactionDate, {s.transactionDate, s.productId, s.productName, s.quantitySold,
+                                                       s.costPrice.toDouble(), s.sellingPrice.toDouble(),
+                                                       s.income.toDouble(), s.profit.toDouble()});
+                });
+            break;
+        case Source::StockCard:
+            queryOk = Database::instance().forEachStockCardRow(
+                request.productId, request.fromDate, request.toDate, [&](const StockCard& sc) {
+                    return emitRow(sc.date, {sc.date, sc.productId, sc.genericName, sc.brandName, sc.openingQuantity,
+                                             sc.quantityIn, sc.quantityOut, sc.quantityReversal, sc.closingQuantity});
+                });
+            break;
+        case Source::DailyTotals:
+            for (const auto& r : Database::instance().getDailySalesReports(request.fromDate, request.toDate)) {
+                if (!emitRow(r.transactionDate, {r.transactionDate, r.totalIncome.toDouble()})) {
+                    break;
+                }
+            }
+            break;
+        case Source::MonthlyTotals:
+            for (const auto& r : Database::instance().getMonthlySalesReports(request.fromDate, request.toDate)) {
+                if (!emitRow(r.month, {r.month, r.totalIncome.toDouble()})) {
+                    break;
+                }
+            }
+            break;
+    }
+
+    if (!queryOk || writeFailed || cancelled || !sink.finish()) {
+        if (cancelled) {
+            *message = "Export cancelled.";
+        } else if (!queryOk) {
+            *message = Database::instance().lastError();
+        } else {
+            *message = sink.error();
+        }
+        return false;
+    }
+
+    progress(100);
+    if (rowCount) {
+        *rowCount = rows;
+    }
+    return true;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QDate>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include "models.hpp"
+
+class QThread;
+
+// Row-at-a-time table writer. Rows are written through as they arrive, so the size of an export
+// is bounded by the file, not by memory.
+class TableSink {
+  public:
+    virtual ~TableSink() = default;
+
+    virtual bool open(const QStringList& headers) = 0;
+    // Numbers are written as numbers, dates as ISO text, everything else as text.
+    virtual bool writeRow(const QVariantList& row) = 0;
+    virtual bool finish() = 0;
+
+    [[nodiscard]] QString error() const { return m_error; }
+
+    // CSV, JSON or XLSX, chosen by the file suffix.
+    static std::unique_ptr<TableSink> forPath(const QString& path, const QString& sheetName);
+
+  protected:
+    QString m_error;
+};
+
+class CsvSink : public TableSink {
+  public:
+    explicit CsvSink(const QString& path);
+    explicit CsvSink(FILE* stream);  // e.g. stdout; written without a BOM
+    bool open(const QStringList& headers) override;
+    bool writeRow(const QVariantList& row) override;
+    bool finish() override;
+
+  private:
+    QFile m_file;
+    FILE* m_stream = nullptr;
+    bool writeLine(const QStringList& fields);
+};
+
+// JSON array with one object per row, keyed by the snake_cased headers. Rows are written as they come.
+class JsonSink : public TableSink {
+  public:
+    explicit JsonSink(const QString& path);
+    explicit JsonSink(FILE* stream);
+    bool open(const QStringList& headers) override;
+    bool writeRow(const QVariantList& row) override;
+    bool finish() override;
+
+  private:
+    QFile m_file;
+    FILE* m_stream = nullptr;
+    QStringList m_keys;
+    qint64 m_rows = 0;
+};
+
+// Minimal single-sheet workbook: inline strings, no styles, parts STOREd in the zip. The sheet part is
+// streamed and its CRC/size patched into the local header afterwards, so nothing is held back in memory.
+class XlsxSink : public TableSink {
+  public:
+    XlsxSink(const QString& path, const QString& sheetName);
+    bool open(const QStringList& headers) override;
+    bool writeRow(const QVariantList& row) override;
+    bool finish() override;
+
+  private:
+    struct Entry {
+        QByteArray name;
+        quint32 crc = 0;
+        quint32 size = 0;
+        quint32 offset = 0;
+    };
+
+    QFile m_file;
+    QString m_sheetName;
+    QList<Entry> m_entries;
+    QByteArray m_buffer;  // pending sheet bytes
+    quint32 m_sheetCrc = 0;
+    qint64 m_sheetSize = 0;
+    int m_rowNumber = 0;
+
+    bool addEntry(const QByteArray& name, const QByteArray& data);
+    bool beginEntry(const QByteArray& name);
+    bool endEntry();
+    bool flushSheet();
+    bool writeRowXml(const QVariantList& row);
+};
+
+// Runs one export on a worker thread with its own database connection.
+class ExportJob : public QObject {
+    Q_OBJECT
+  public:
+    enum class Source { ProductSales, StockCard, DailyTotals, MonthlyTotals };
+
+    struct Request {
+        Source source = Source::ProductSales;
+        SalesPeriod period = SalesPeriod::Daily;  // ProductSales only
+        int productId = 0;                        // StockCard only; 0 = all products
+        QDate fromDate;
+        QDate toDate;
+        QString path;
+    };
+
+    explicit ExportJob(QObject* parent = nullptr);
+    ~ExportJob() override;
+
+    // Returns false if an export is already running.
+    bool start(const Request& request);
+    void cancel();
+    [[nodiscard]] bool isRunning() const { return m_running; }
+
+    // Synchronous export to request.path on the calling thread. `progress` gets 0-100 and returns false to cancel.
+    static bool run(const Request& request, const std::function<bool(int percent)>& progress, QString* message);
+    // Streams the rows of `request` into an unopened sink. Used by run() and by the command-line reports.
+    static bool write(const Request& request, TableSink& sink, const std::function<bool(int percent)>& progress,
+                      QString* message, qint64* rows = nullptr);
+
+  signals:
+    void progress(int percent);
+    void finished(bool ok, const QString& message);
+
+  private:
+    QThread* m_thread = nullptr;
+    std::atomic_bool m_cancel{false};
+    bool m_running = false;
+};
@@ -6,9 +6,12 @@
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QMessageBox>
+#include <QPointer>
 #include <QStringListModel>
 #include <QVBoxLayout>
 #include "database.hpp"
+#include "datetimedelegate.hpp"
+#include "writequeue.hpp"
 
 // =================== InvoiceDialog ===================
 
@@ -38,14 +41,14 @@ InvoiceDialog::InvoiceDialog(QWidget* parent, const Invoice& inv)
     m_invoiceTotal->setRange(0, 999999999);
     m_invoiceTotal->setDecimals(2);
     m_invoiceTotal->setPrefix("UGX ");
-    m_invoiceTotal->setValue(inv.invoiceTotal);
+    m_invoiceTotal->setValue(inv.invoiceTotal.toDouble());
     form->addRow("Invoice Total*:", m_invoiceTotal);
 
     m_amountPaid = new QDoubleSpinBox;
     m_amountPaid->setRange(0, 999999999);
     m_amountPaid->setDecimals(2);
     m_amountPaid->setPrefix("UGX ");
-    m_amountPaid->setValue(inv.amountPaid);
+    m_amountPaid->setValue(inv.amountPaid.toDouble());
     form->addRow("Amount Paid*:", m_amountPaid);
 
     m_supplier = new QLineEdit(inv.supplier);
@@ -73,8 +76,8 @@ Invoice InvoiceDialog::getInvoice() const {
     inv.id = m_invoiceId;
     inv.invoiceNumber = m_invoiceNumber->text().trimmed();
     inv.purchaseDate = m_purchaseDate->date();
-    inv.invoiceTotal = m_invoiceTotal->value();
-    inv.amountPaid = m_amountPaid->value();
+    inv.invoiceTotal = Money::fromDouble(m_invoiceTotal->value());
+    inv.amountPaid = Money::fromDouble(m_amountPaid->value());
     inv.supplier = m_supplier->text().trimmed();
     return inv;
 }
@@ -135,7 +138,7 @@ StockInDialog::StockInDialog(int invoiceId, QWidget* parent) : QDialog(parent),
                                         .arg(products[0].id)
                                         .arg(products[0].quantity));
             m_productLabel->setStyleSheet("color: #2f855a; font-size: 12px; font-weight: 500;");
-            m_costPrice->setValue(products[0].costPrice);
+            m_costPrice->setValue(products[0].costPrice.toDouble());
         } else {
             m_selectedProductId = 0;
             m_productLabel->setText("No product found");
@@ -166,7 +169,7 @@ StockInItem StockInDialog::getStockIn() const {
     si.productId = m_selectedProductId;
     si.invoiceId = m_invoiceId;
     si.quantity = m_quantity->value();
-    si.costPrice = m_costPrice->value();
+    si.costPrice = Money::fromDouble(m_costPrice->value());
     si.expiryDate = m_expiryDate->date();
     si.comment = m_comment->text().trimmed();
     return si;
@@ -178,8 +181,22 @@ InvoiceDetailWidget::InvoiceDetailWidget(const Invoice& inv, const User& user, Q
     : QWidget(parent), m_invoice(inv), m_user(user) {
     setupUi();
     refreshItems();
+
+    // Stock booked in or taken off this invoice, here or at another till
+    m_changeListenerId = Database::instance().addChangeListener([this](const Database::DataChange& change) {
+        if (!change.unknown && !change.invoices.contains(m_invoice.id)) {
+            return;
+        }
+        if (Database::instance().getInvoiceById(m_invoice.id).id == 0) {
+            emit backRequested();
+        } else {
+            refreshItems();
+        }
+    });
 }
 
+InvoiceDetailWidget::~InvoiceDetailWidget() { Database::instance().removeChangeListener(m_changeListenerId); }
+
 void InvoiceDetailWidget::setupUi() {
     auto* root = new QVBoxLayout(this);
     root->setContentsMargins(16, 16, 16, 16);
@@ -218,10 +235,10 @@ void InvoiceDetailWidget::setupUi() {
 
     addInfo("SUPPLIER", m_invoice.supplier);
     addInfo("DATE", m_invoice.purchaseDate.toString("dd MMM yyyy"));
-    addInfo("TOTAL", QString("UGX %L1").arg(m_invoice.invoiceTotal, 0, 'f', 2));
-    addInfo("PAID", QString("UGX %L1").arg(m_invoice.amountPaid, 0, 'f', 2));
-    double bal = m_invoice.invoiceTotal - m_invoice.amountPaid;
-    addInfo("BALANCE", QString("UGX %L1").arg(bal, 0, 'f', 2), bal > 0 ? "#e53e3e" : "#2f855a");
+    addInfo("TOTAL", QString("UGX %L1").arg(m_invoice.invoiceTotal.toDouble(), 0, 'f', 2));
+    addInfo("PAID", QString("UGX %L1").arg(m_invoice.amountPaid.toDouble(), 0, 'f', 2));
+    Money bal = m_invoice.invoiceTotal - m_invoice.amountPaid;
+    addInfo("BALANCE", QString("UGX %L1").arg(bal.toDouble(), 0, 'f', 2), bal > Money() ? "#e53e3e" : "#2f855a");
 
     summaryLayout->addStretch();
     root->addWidget(summary);
@@ -273,7 +290,7 @@ void InvoiceDetailWidget::refreshItems() {
     QList<StockInItem> items = Database::instance().getStockInByInvoice(m_invoice.id);
     m_itemsTable->setRowCount(0);
     m_itemsTable->setRowCount(static_cast<int>(items.size()));
-    double grandTotal = 0;
+    Money grandTotal;
 
     for (int i = 0; i < items.size(); ++i) {
         const StockInItem& si = items[i];
@@ -284,11 +301,11 @@ void InvoiceDetailWidget::refreshItems() {
         qtyItem->setTextAlignment(Qt::AlignCenter);
         m_itemsTable->setItem(i, 2, qtyItem);
 
-        m_itemsTable->setItem(i, 3, new QTableWidgetItem(QString("UGX %1").arg(si.costPrice, 0, 'f', 2)));
+        m_itemsTable->setItem(i, 3, new QTableWidgetItem(QString("UGX %1").arg(si.costPrice.toDouble(), 0, 'f', 2)));
 
-        double total = si.quantity * si.costPrice;
+        Money total = si.costPrice * si.quantity;
         grandTotal += total;
-        m_itemsTable->setItem(i, 4, new QTableWidgetItem(QString("UGX %1").arg(total, 0, 'f', 2)));
+        m_itemsTable->setItem(i, 4, new QTableWidgetItem(QString("UGX %1").arg(total.toDouble(), 0, 'f', 2)));
 
         m_itemsTable->setItem(
             i, 5, new QTableWidgetItem(si.expiryDate.isValid() ? si.expiryDate.toString("MMM yyyy") : "N/A"));
@@ -311,12 +328,15 @@ void InvoiceDetailWidget::refreshItems() {
 void InvoiceDetailWidget::onAddStockIn() {
     StockInDialog dlg(m_invoice.id, this);
     if (dlg.exec() == QDialog::Accepted) {
-        StockInItem si = dlg.getStockIn();
-        if (!Database::instance().addStockIn(si)) {
-            QMessageBox::critical(this, "Error", Database::instance().lastError());
-        } else {
-            refreshItems();
-        }
+        // Queued, so stock-ins entered during a rush of sales commit together with them
+        QPointer<InvoiceDetailWidget> self(this);
+        WriteQueue::instance().enqueue(
+            [si = dlg.getStockIn()]() mutable { return Database::instance().addStockIn(si); },
+            [self](bool ok, const QString& error) {
+                if (self && !ok) {
+                    QMessageBox::critical(self, "Error", error);
+                }
+            });
     }
 }
 
@@ -327,15 +347,25 @@ void InvoiceDetailWidget::onDeleteStockIn(int id) {
     if (ret == QMessageBox::Yes) {
         if (!Database::instance().deleteStockIn(id)) {
             QMessageBox::critical(this, "Error", Database::instance().lastError());
-        } else {
-            refreshItems();
         }
     }
 }
 
 // =================== InvoicesWidget ===================
 
-InvoicesWidget::InvoicesWidget(const User& user, QWidget* parent) : QWidget(parent), m_currentUser(user) { setupUi(); }
+InvoicesWidget::InvoicesWidget(const User& user, QWidget* parent) : QWidget(parent), m_currentUser(user) {
+    setupUi();
+    loadData();
+    m_changeListenerId = Database::instance().addChangeListener([this](const Database::DataChange& change) {
+        if (change.unknown) {
+            loadData();
+        } else if (!change.invoices.isEmpty()) {
+            updateRows(change.invoices);
+        }
+    });
+}
+
+InvoicesWidget::~InvoicesWidget() { Database::instance().removeChangeListener(m_changeListenerId); }
 
 void InvoicesWidget::setupUi() {
     auto* root = new QVBoxLayout(this);
@@ -378,6 +408,7 @@ void InvoicesWidget::setupUi() {
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_table->setAlternatingRowColors(true);
+    m_table->setItemDelegateForColumn(6, new DateTimeDelegate("dd MMM yyyy hh:mm", m_table));
 
     for (int i = 0; i < m_table->columnCount(); ++i) {
         m_table->horizontalHeader()->setSectionResizeMode(i, QHeaderView::Stretch);
@@ -401,11 +432,6 @@ void InvoicesWidget::setupUi() {
     connect(addBtn, &QPushButton::clicked, this, &InvoicesWidget::onAdd);
 }
 
-void InvoicesWidget::refresh() {
-    m_stack->setCurrentIndex(0);
-    loadData();
-}
-
 void InvoicesWidget::onSearch(const QString& text) {
     Q_UNUSED(text)
     loadData();
@@ -428,6 +454,27 @@ void InvoicesWidget::loadData() {
     }
 }
 
+// Repaints the rows of `invoiceIds` and drops deleted ones; a new invoice reloads the list, which is newest first
+void InvoicesWidget::updateRows(const QList<int>& invoiceIds) {
+    for (int id : invoiceIds) {
+        int row = 0;
+        while (row < m_table->rowCount() && m_table->item(row, 1)->data(Qt::UserRole).toInt() != id) {
+            ++row;
+        }
+        const Invoice inv = Database::instance().getInvoiceById(id);
+        if (row == m_table->rowCount()) {
+            if (inv.id != 0) {
+                loadData();
+                return;
+            }
+        } else if (inv.id == 0) {
+            m_table->removeRow(row);
+        } else {
+            setRow(row, inv);
+        }
+    }
+}
+
 void InvoicesWidget::setRow(int row, const Invoice& inv) {
     m_table->setItem(row, 0, new QTableWidgetItem(inv.purchaseDate.toString("dd MMM yyyy")));
 
@@ -437,19 +484,21 @@ void InvoicesWidget::setRow(int row, const Invoice& inv) {
     m_table->setItem(row, 1, numItem);
 
     m_table->setItem(row, 2, new QTableWidgetItem(inv.supplier));
-    m_table->setItem(row, 3, new QTableWidgetItem(QString("UGX %1").arg(inv.invoiceTotal, 0, 'f', 2)));
-    m_table->setItem(row, 4, new QTableWidgetItem(QString("UGX %1").arg(inv.amountPaid, 0, 'f', 2)));
+    m_table->setItem(row, 3, new QTableWidgetItem(QString("UGX %1").arg(inv.invoiceTotal.toDouble(), 0, 'f', 2)));
+    m_table->setItem(row, 4, new QTableWidgetItem(QString("UGX %1").arg(inv.amountPaid.toDouble(), 0, 'f', 2)));
 
-    double bal = inv.invoiceTotal - inv.amountPaid;
-    auto* balItem = new QTableWidgetItem(QString("UGX %1").arg(bal, 0, 'f', 2));
-    if (bal > 0) {
+    Money bal = inv.invoiceTotal - inv.amountPaid;
+    auto* balItem = new QTableWidgetItem(QString("UGX %1").arg(bal.toDouble(), 0, 'f', 2));
+    if (bal > Money()) {
         balItem->setForeground(QColor("#e53e3e"));
     } else {
         balItem->setForeground(QColor("#2f855a"));
     }
     m_table->setItem(row, 5, balItem);
 
-    m_table->setItem(row, 6, new QTableWidgetItem(inv.createdAt.toString("dd MMM yyyy hh:mm")));
+    auto* createdItem = new QTableWidgetItem;
+    createdItem->setData(Qt::DisplayRole, inv.createdAt);
+    m_table->setItem(row, 6, createdItem);
 
     // Actions
     auto* actWidget = new QWidget;
@@ -486,8 +535,6 @@ void InvoicesWidget::setRow(int row, const Invoice& inv) {
             updated.userId = m_currentUser.id;
             if (!Database::instance().updateInvoice(updated)) {
                 QMessageBox::critical(this, "Error", Database::instance().lastError());
-            } else {
-                loadData();
             }
         }
     });
@@ -497,8 +544,6 @@ void InvoicesWidget::setRow(int row, const Invoice& inv) {
         if (ret == QMessageBox::Yes) {
             if (!Database::instance().deleteInvoice(iid)) {
                 QMessageBox::critical(this, "Error", Database::instance().lastError());
-            } else {
-                loadData();
             }
         }
     });
@@ -517,7 +562,6 @@ void InvoicesWidget::onAdd() {
         if (!Database::instance().createInvoice(inv)) {
             QMessageBox::critical(this, "Error", Database::instance().lastError());
         } else {
-            loadData();
             // Switch to detail view
             onViewDetails(inv.id);
         }
@@ -541,10 +585,7 @@ void InvoicesWidget::onViewDetails(int id) {
     }
 
     m_detailWidget = new InvoiceDetailWidget(inv, m_currentUser);
-    connect(m_detailWidget, &InvoiceDetailWidget::backRequested, this, [this] {
-        m_stack->setCurrentIndex(0);
-        loadData();
-    });
+    connect(m_detailWidget, &InvoiceDetailWidget::backRequested, this, [this] { m_stack->setCurrentIndex(0); });
     m_stack->addWidget(m_detailWidget);
     m_stack->setCurrentWidget(m_detailWidget);
 }
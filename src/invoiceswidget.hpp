@@ -48,6 +48,7 @@ class InvoiceDetailWidget : public QWidget {
     Q_OBJECT
   public:
     explicit InvoiceDetailWidget(const Invoice& inv, const User& user, QWidget* parent = nullptr);
+    ~InvoiceDetailWidget() override;
   signals:
     void backRequested();
   private slots:
@@ -60,6 +61,7 @@ class InvoiceDetailWidget : public QWidget {
     User m_user;
     QTableWidget* m_itemsTable;
     QLabel* m_summaryLabel;
+    int m_changeListenerId = 0;
     void setupUi();
 };
 
@@ -67,7 +69,7 @@ class InvoicesWidget : public QWidget {
     Q_OBJECT
   public:
     explicit InvoicesWidget(const User& user, QWidget* parent = nullptr);
-    void refresh();
+    ~InvoicesWidget() override;
   private slots:
     void onAdd();
     void onEdit();
@@ -81,7 +83,9 @@ class InvoicesWidget : public QWidget {
     QLineEdit* m_searchEdit;
     QStackedWidget* m_stack;
     InvoiceDetailWidget* m_detailWidget = nullptr;
+    int m_changeListenerId = 0;
     void setupUi();
     void loadData();
+    void updateRows(const QList<int>& invoiceIds);
     void setRow(int row, const Invoice& inv);
 };
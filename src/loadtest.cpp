@@ -0,0 +1,325 @@
+#include "loadtest.hpp"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "database.hpp"
+#include "writequeue.hpp"
+
+static constexpr int kSeedProducts = 20;
+static constexpr int kSeedQuantity = 1000000;  // never runs out, so a sale only fails on the database
+static const char* const kRoles[] = {"checkout", "stockin", "checkout", "report"};
+
+// Value at fraction `p` of `sorted`
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+}
+
+static qint64 totalStock(Database& db) {
+    QSqlQuery q(db.db());
+    if (!q.exec("SELECT COALESCE(SUM(quantity), 0) FROM products") || !q.next()) {
+        return -1;
+    }
+    return q.value(0).toLongLong();
+}
+
+static qint64 countTransactions(Database& db) {
+    QSqlQuery q(db.db());
+    if (!q.exec("SELECT COUNT(*) FROM transactions") || !q.next()) {
+        return -1;
+    }
+    return q.value(0).toLongLong();
+}
+
+static bool seedLoadTest(Database& db) {
+    for (int i = 1; i <= kSeedProducts; ++i) {
+        Product p;
+        p.genericName = QString("Load test item %1").arg(i);
+        p.quantity = kSeedQuantity;
+        p.costPrice = Money::fromCents(500 + i * 10);
+        p.sellingPrice = Money::fromCents(800 + i * 15);
+        p.barcode = QString("LT%1").arg(i, 6, 10, QChar('0'));
+        if (!db.createProduct(p)) {
+            return false;
+        }
+    }
+    Invoice inv;
+    inv.invoiceNumber = "LOAD-TEST";
+    inv.purchaseDate = db.shopToday();
+    inv.supplier = "Load test";
+    inv.userId = db.getUserByUsername("admin").id;
+    return db.createInvoice(inv);
+}
+
+// =================== Worker ===================
+
+// Runs `write` through the write queue, as the till does, and waits for its result
+static bool queueWrite(WriteQueue::Write write, QString& error) {
+    bool ok = false;
+    QEventLoop loop;
+    WriteQueue::instance().enqueue(std::move(write), [&](bool done, const QString& why) {
+        ok = done;
+        error = why;
+        loop.quit();
+    });
+    loop.exec();
+    return ok;
+}
+
+int runLoadWorker(const QString& role, const QString& databasePath, int operations, qint64 startAtMs) {
+    QTextStream err(stderr);
+    if (role != "checkout" && role != "stockin" && role != "report") {
+        err << "tella: unknown load worker role '" << role << "'\n";
+        return 2;
+    }
+
+    auto& db = Database::instance();
+    if (!db.open(databasePath)) {
+        err << "tella: load worker could not open " << databasePath << ": " << db.lastError() << "\n";
+        return 1;
+    }
+    const QList<Product> products = db.listProducts(QString(), kSeedProducts);
+    const QList<Invoice> invoices = db.listInvoices(1);
+    const User user = db.getUserByUsername("admin");
+    if (products.isEmpty() || invoices.isEmpty() || user.id == 0) {
+        err << "tella: " << databasePath << " is not a load-test database\n";
+        db.close();
+        return 1;
+    }
+
+    const qint64 delay = startAtMs - QDateTime::currentMSecsSinceEpoch();
+    if (delay > 0) {
+        QThread::msleep(static_cast<unsigned long>(delay));
+    }
+
+    auto* random = QRandomGenerator::global();
+    auto anyProduct = [&]() -> const Product& {
+        return products[random->bounded(static_cast<int>(products.size()))];
+    };
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(operations));
+    int ok = 0;
+    int failed = 0;
+    qint64 units = 0;  // sold by a checkout worker, stocked in by a stockin worker
+    QString firstError;
+    const QDate today = db.shopToday();
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    for (int i = 0; i < operations; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        bool done = true;
+        QString error;
+        int moved = 0;
+        if (role == "checkout") {
+            Transaction t;
+            t.userId = user.id;
+            const int lines = 1 + random->bounded(3);
+            for (int l = 0; l < lines; ++l) {
+                const Product& p = anyProduct();
+                TransactionItem item;
+                item.productId = p.id;
+                item.genericName = p.genericName;
+                item.quantity = 1 + random->bounded(3);
+                item.sellingPrice = p.sellingPrice;
+                item.costPrice = p.costPrice;
+                moved += item.quantity;
+                t.items.append(item);
+            }
+            done = queueWrite([&db, &t] { return db.createTransaction(t); }, error);
+        } else if (role == "stockin") {
+            StockInItem si;
+            si.productId = anyProduct().id;
+            si.invoiceId = invoices.first().id;
+            si.quantity = 1 + random->bounded(10);
+            si.costPrice = Money::fromCents(500);
+            si.expiryDate = today.addYears(1);
+            moved = si.quantity;
+            done = queueWrite([&db, &si] { return db.addStockIn(si); }, error);
+        } else if (i % 2 == 0) {
+            // Report readers never take the write lock; they are here for the load they put on the file
+            db.getDailySalesReports(today.addDays(-30), today);
+        } else {
+            db.getTopProducts(today.addDays(-30), today, ProductMetric::Income, 10);
+        }
+        latencies.push_back(static_cast<double>(timer.nsecsElapsed()) / 1e6);
+
+        if (done) {
+            ++ok;
+            units += moved;
+        } else {
+            ++failed;
+            if (firstError.isEmpty()) {
+                firstError = error;
+            }
+        }
+    }
+    const qint64 elapsedMs = elapsed.elapsed();
+    const Database::LockStats locks = db.lockStats();
+    db.close();
+
+    std::sort(latencies.begin(), latencies.end());
+    QJsonObject result{
+        {"role", role},
+        {"ok", ok},
+        {"failed", failed},
+        {"units", units},
+        {"elapsedMs", elapsedMs},
+        {"p50Ms", percentile(latencies, 0.50)},
+        {"p95Ms", percentile(latencies, 0.95)},
+        {"maxMs", latencies.empty() ? 0.0 : latencies.back()},
+        {"lockRetries", locks.retries},
+        {"lockWaitMs", locks.waitMs},
+        {"lockTimeouts", locks.timeouts},
+        {"error", firstError},
+    };
+    QTextStream out(stdout);
+    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n";
+    return 0;
+}
+
+// =================== Coordinator ===================
+
+int runLoadTest(const LoadTestOptions& options) {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const bool scratch = options.databasePath.isEmpty();
+    const QString path =
+        scratch ? QDir::temp().filePath(QString("tella-load-%1.db").arg(QCoreApplication::applicationPid()))
+                : options.databasePath;
+    if (QFile::exists(path)) {
+        err << "tella: " << QDir::toNativeSeparators(path) << " already exists; the load test needs a new file\n";
+        return 2;
+    }
+    auto removeScratch = [&] {
+        if (scratch) {
+            for (const char* suffix : {"", "-wal", "-shm"}) {
+                QFile::remove(path + suffix);
+            }
+        }
+    };
+
+    // ---- Seed ----
+    auto& db = Database::instance();
+    if (!db.open(path) || !seedLoadTest(db)) {
+        err << "tella: could not create the load-test database: " << db.lastError() << "\n";
+        db.close();
+        removeScratch();
+        return 1;
+    }
+    const qint64 seededUnits = totalStock(db);
+    db.close();
+
+    // ---- Run ----
+    // Started together once every worker has had time to open the file
+    const qint64 startAt = QDateTime::currentMSecsSinceEpoch() + 1000 + 50LL * options.processes;
+    std::vector<std::unique_ptr<QProcess>> workers;
+    for (int i = 0; i < options.processes; ++i) {
+        auto worker = std::make_unique<QProcess>();
+        worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        worker->start(QCoreApplication::applicationFilePath(),
+                      {"--load-worker", kRoles[i % 4], "--db", path, "--count", QString::number(options.operations),
+                       "--start", QString::number(startAt)});
+        workers.push_back(std::move(worker));
+    }
+
+    bool passed = true;
+    qint64 sold = 0;
+    qint64 stocked = 0;
+    qint64 committedSales = 0;
+    qint64 finishedAt = 0;
+    out << QString("%1  %2  %3  %4  %5  %6  %7  %8  %9  %10\n")
+               .arg("worker", -6)
+               .arg("role", -8)
+               .arg("ok", 6)
+               .arg("failed", 6)
+               .arg("ops/s", 8)
+               .arg("p50 ms", 7)
+               .arg("p95 ms", 7)
+               .arg("max ms", 8)
+               .arg("retries", 7)
+               .arg("waited ms", 9);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QProcess& worker = *workers[i];
+        const QString role = kRoles[i % 4];
+        worker.waitForFinished(-1);
+        finishedAt = std::max(finishedAt, QDateTime::currentMSecsSinceEpoch());
+        const QJsonObject r = QJsonDocument::fromJson(worker.readAllStandardOutput().trimmed()).object();
+        if (worker.exitStatus() != QProcess::NormalExit || worker.exitCode() != 0 || r.isEmpty()) {
+            out << QString("%1  %2  did not finish (%3)\n").arg(i + 1, -6).arg(role, -8).arg(worker.errorString());
+            passed = false;
+            continue;
+        }
+
+        const qint64 ok = r["ok"].toInteger();
+        const qint64 failed = r["failed"].toInteger();
+        const double seconds = std::max<qint64>(r["elapsedMs"].toInteger(), 1) / 1000.0;
+        out << QString("%1  %2  %3  %4  %5  %6  %7  %8  %9  %10\n")
+                   .arg(i + 1, -6)
+                   .arg(role, -8)
+                   .arg(ok, 6)
+                   .arg(failed, 6)
+                   .arg(static_cast<double>(ok) / seconds, 8, 'f', 1)
+                   .arg(r["p50Ms"].toDouble(), 7, 'f', 2)
+                   .arg(r["p95Ms"].toDouble(), 7, 'f', 2)
+                   .arg(r["maxMs"].toDouble(), 8, 'f', 2)
+                   .arg(r["lockRetries"].toInteger(), 7)
+                   .arg(r["lockWaitMs"].toInteger(), 9);
+        if (failed > 0) {
+            out << "        first error: " << r["error"].toString() << "\n";
+            passed = false;
+        }
+        if (role == "checkout") {
+            committedSales += ok;
+            sold += r["units"].toInteger();
+        } else if (role == "stockin") {
+            stocked += r["units"].toInteger();
+        }
+    }
+
+    // ---- Check ----
+    // Every sale a worker saw commit is in the file, and stock moved by exactly what committed
+    if (!db.open(path, true)) {
+        err << "tella: could not reopen the load-test database: " << db.lastError() << "\n";
+        removeScratch();
+        return 1;
+    }
+    const qint64 storedSales = countTransactions(db);
+    const qint64 expectedStock = seededUnits - sold + stocked;
+    const qint64 storedStock = totalStock(db);
+    db.close();
+
+    const double wallSeconds = std::max<qint64>(finishedAt - startAt, 1) / 1000.0;
+    out << QString("\nsales committed %1, in the database %2, lost %3\n")
+               .arg(committedSales)
+               .arg(storedSales)
+               .arg(committedSales - storedSales);
+    out << QString("stock units expected %1, in the database %2\n").arg(expectedStock).arg(storedStock);
+    out << QString("%1 processes in %2 s, %3 sales/s\n")
+               .arg(options.processes)
+               .arg(wallSeconds, 0, 'f', 2)
+               .arg(static_cast<double>(committedSales) / wallSeconds, 0, 'f', 1);
+    passed = passed && storedSales == committedSales && storedStock == expectedStock;
+    out << (passed ? "PASS\n" : "FAIL\n");
+    if (!scratch) {
+        out << "database kept at " << QDir::toNativeSeparators(path) << "\n";
+    }
+    out.flush();
+    removeScratch();
+    return passed ? 0 : 1;
+}
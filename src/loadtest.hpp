@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QString>
+
+// Multi-till load test: `tella --load-test N` creates a scratch database, seeds it with products and an invoice,
+// and starts N headless `tella --load-worker` processes against it at the same moment. Workers take turns at the
+// roles checkout, stockin, checkout, report, and each runs `--count` operations exactly as a till does, with
+// writes going through the write queue. At the end the test reports throughput, latency and write-lock waits per
+// role, and checks the file: every sale a worker saw commit must be in it, and product stock must equal the seed
+// plus stock-ins minus sales.
+struct LoadTestOptions {
+    int processes = 4;
+    int operations = 200;  // per process
+    QString databasePath;  // must not exist; a temporary file, removed afterwards, when empty
+};
+
+// Returns the process exit code: 0 when no operation failed and no sale or stock movement went missing.
+int runLoadTest(const LoadTestOptions& options);
+
+// One process of the load test. `role` is checkout, stockin or report; the operations start at `startAtMs`
+// (epoch milliseconds) so that all workers overlap. Prints its figures to stdout as one JSON object.
+int runLoadWorker(const QString& role, const QString& databasePath, int operations, qint64 startAtMs);
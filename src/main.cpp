@@ -2,13 +2,21 @@
 #include <QDir>
 #include <QFile>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QStandardPaths>
 
+#include "cli.hpp"
 #include "database.hpp"
 #include "loginwindow.hpp"
 #include "mainwindow.hpp"
+#include "writequeue.hpp"
 
 int main(int argc, char* argv[]) {
+    // Headless reports never construct a QApplication or any widget
+    if (isCliInvocation(argc, argv)) {
+        return runCli(argc, argv);
+    }
+
     qputenv("QT_LOGGING_RULES", "qt.qpa.wayland.textinput=false");
     QApplication app(argc, argv);
     app.setApplicationName("Tella POS");
@@ -29,8 +37,19 @@ int main(int argc, char* argv[]) {
     QDir().mkpath(dataDir);
     QString dbPath = dataDir + "/tella.db";
 
-    // Open database
-    if (!Database::instance().open(dbPath)) {
+    // Open database. Upgrading an older file can take a while on a long sales history; the dialog only
+    // appears when it does.
+    QProgressDialog migrating("Upgrading database…", QString(), 0, 100);
+    migrating.setWindowTitle("Tella POS");
+    migrating.setMinimumDuration(500);
+    migrating.setAutoClose(false);
+    bool opened = Database::instance().open(dbPath, false, [&migrating](const QString& step, int percent) {
+        migrating.setLabelText(step + "…");
+        migrating.setValue(percent);
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    });
+    migrating.reset();
+    if (!opened) {
         QMessageBox::critical(
             nullptr, "Database Error",
             QString("Failed to open database:\n%1\n\nPath: %2").arg(Database::instance().lastError(), dbPath));
@@ -46,6 +65,7 @@ int main(int argc, char* argv[]) {
     auto* mainWin = new MainWindow(loggedInUser);
     mainWin->showMaximized();
     app.exec();
+    WriteQueue::instance().flush();  // writes still waiting for their batch window
     delete mainWin;
     Database::instance().close();
     return 0;
@@ -0,0 +1,295 @@
+#include "maintenance.hpp"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include "database.hpp"
+
+QString MaintenanceReport::summary() const {
+    if (!ok) {
+        return QString("Maintenance failed: %1").arg(error);
+    }
+    return QString("Maintenance: %L1 stock rows before %2 compacted into %L3 monthly snapshots, "
+                   "%4 balance mismatches, %L5 sales archived, %L6 pages freed%7 (%8 ms)")
+        .arg(rowsCompacted)
+        .arg(cutoff.toString(Qt::ISODate))
+        .arg(snapshotsWritten)
+        .arg(balanceMismatches)
+        .arg(transactionsArchived)
+        .arg(pagesFreed)
+        .arg(vacuumDeferred ? ", full vacuum deferred until the till is quiet" : "")
+        .arg(elapsedMs);
+}
+
+MaintenanceJob::MaintenanceJob(QObject* parent) : QObject(parent) {}
+
+MaintenanceJob::~MaintenanceJob() {
+    // The worker posts its result back to this object, so it must not outlive it
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void MaintenanceJob::start() {
+    if (m_running || !Database::instance().isOpen()) {
+        return;
+    }
+    m_running = true;
+
+    int retentionDays = Database::instance().setting("stock_balance_retention_days", "365").toInt();
+    // Past years kept in the live file besides the current one; negative turns archiving off
+    int archiveYears = Database::instance().setting("transaction_archive_years", "1").toInt();
+    const QDate today = Database::instance().shopToday();
+    int archiveBeforeYear = archiveYears < 0 ? 0 : today.year() - archiveYears;
+    int vacuumIdleMinutes = Database::instance().setting("vacuum_idle_minutes", "30").toInt();
+
+    m_thread = QThread::create([this, today, retentionDays, archiveBeforeYear, vacuumIdleMinutes] {
+        MaintenanceReport report;
+        QSqlDatabase db = Database::instance().db();
+        if (db.isOpen()) {
+            report = run(db, today, retentionDays, archiveBeforeYear, vacuumIdleMinutes);
+        } else {
+            report.error = Database::instance().lastError();
+        }
+        db = QSqlDatabase();
+        Database::instance().releaseThreadConnection();
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, report] {
+                m_running = false;
+                m_thread = nullptr;  // deleted via QThread::finished
+                m_lastReport = report;
+                emit finished(report);
+            },
+            Qt::QueuedConnection);
+    });
+    connect(m_thread, &QThread::finished, m_thread, &QObject::deleteLater);
+    m_thread->start(QThread::LowPriority);
+}
+
+MaintenanceReport MaintenanceJob::run(QSqlDatabase db, const QDate& today, int retentionDays, int archiveBeforeYear,
+                                      int vacuumIdleMinutes) {
+    MaintenanceReport r;
+    QElapsedTimer timer;
+    timer.start();
+
+    // Keep whole months: everything before the first of the month containing the retention boundary is rolled up.
+    // stock_balances rows are filed under shop dates, so the boundary is one too.
+    QDate keepFrom = today.addDays(-retentionDays);
+    r.cutoff = QDate(keepFrom.year(), keepFrom.month(), 1);
+
+    auto fail = [&](const QSqlQuery& failed) {
+        r.error = failed.lastError().text();
+        r.elapsedMs = timer.elapsed();
+        return r;
+    };
+
+    QSqlQuery q(db);
+
+    // ---- Roll daily rows into monthly snapshots ----
+    // One month per write transaction, through Database so it takes the write lock up front and waits its turn
+    // with the tills; a first run over years of rows never holds the lock for more than a month's worth.
+    // Months that are already one snapshot row per product need no work.
+    q.prepare(R"(
+        SELECT substr(balance_date, 1, 8) || '01' AS month_start
+        FROM stock_balances
+        WHERE balance_date < ?
+        GROUP BY month_start
+        HAVING COUNT(*) > COUNT(DISTINCT product_id) OR MAX(balance_date <> substr(balance_date, 1, 8) || '01')
+        ORDER BY month_start
+    )");
+    q.addBindValue(r.cutoff.toString(Qt::ISODate));
+    if (!q.exec()) {
+        return fail(q);
+    }
+    QList<QDate> months;
+    while (q.next()) {
+        months << QDate::fromString(q.value(0).toString(), Qt::ISODate);
+    }
+    q.finish();
+
+    if (!q.exec("DROP TABLE IF EXISTS temp.stock_rollup") || !q.exec(R"(
+            CREATE TEMP TABLE stock_rollup (
+                product_id INTEGER PRIMARY KEY,
+                month_start TEXT NOT NULL,
+                last_date TEXT NOT NULL,
+                closing INTEGER NOT NULL,
+                qty_in INTEGER NOT NULL,
+                qty_out INTEGER NOT NULL,
+                qty_reversal INTEGER NOT NULL,
+                day_rows INTEGER NOT NULL
+            )
+        )")) {
+        return fail(q);
+    }
+
+    auto& database = Database::instance();
+    for (const QDate& month : months) {
+        const QString from = month.toString(Qt::ISODate);
+        const QString to = month.addMonths(1).toString(Qt::ISODate);
+        auto rollback = [&] {
+            r.error = q.lastError().text();
+            r.elapsedMs = timer.elapsed();
+            database.rollbackTransaction();
+            return r;
+        };
+        if (!database.beginTransaction()) {
+            r.error = database.lastError();
+            r.elapsedMs = timer.elapsed();
+            return r;
+        }
+
+        if (!q.exec("DELETE FROM temp.stock_rollup")) {
+            return rollback();
+        }
+        // `closing` is a bare column next to MAX(): SQLite takes it from the row holding the last date of the month
+        q.prepare(R"(
+            INSERT INTO temp.stock_rollup
+            SELECT product_id,
+                   ?,
+                   MAX(balance_date),
+                   opening_quantity + quantity_in - quantity_out + quantity_reversal,
+                   SUM(quantity_in),
+                   SUM(quantity_out),
+                   SUM(quantity_reversal),
+                   COUNT(*)
+            FROM stock_balances
+            WHERE balance_date >= ? AND balance_date < ?
+            GROUP BY product_id
+        )");
+        q.addBindValue(from);
+        q.addBindValue(from);
+        q.addBindValue(to);
+        if (!q.exec() || !q.exec("DELETE FROM temp.stock_rollup WHERE day_rows = 1 AND last_date = month_start")) {
+            return rollback();
+        }
+
+        q.prepare(R"(
+            DELETE FROM stock_balances
+            WHERE balance_date >= ? AND balance_date < ?
+              AND product_id IN (SELECT product_id FROM temp.stock_rollup)
+        )");
+        q.addBindValue(from);
+        q.addBindValue(to);
+        if (!q.exec()) {
+            return rollback();
+        }
+        r.rowsCompacted += q.numRowsAffected();
+
+        // The month keeps its movements and its closing balance; the opening is derived from them
+        if (!q.exec(R"(
+                INSERT INTO stock_balances
+                    (product_id, opening_quantity, quantity_in, quantity_out, quantity_reversal, balance_date)
+                SELECT product_id, closing - qty_in + qty_out - qty_reversal, qty_in, qty_out, qty_reversal, month_start
+                FROM temp.stock_rollup
+            )")) {
+            return rollback();
+        }
+        r.snapshotsWritten += q.numRowsAffected();
+
+        if (!database.commitTransaction()) {
+            r.error = database.lastError();
+            r.elapsedMs = timer.elapsed();
+            return r;
+        }
+    }
+    q.exec("DROP TABLE IF EXISTS temp.stock_rollup");
+
+    // ---- Verify the latest closing balance of every product ----
+    if (!q.exec(R"(
+            SELECT p.id, p.generic_name, p.quantity,
+                   b.opening_quantity + b.quantity_in - b.quantity_out + b.quantity_reversal AS closing
+            FROM products p
+            JOIN stock_balances b ON b.product_id = p.id
+             AND b.balance_date = (SELECT MAX(balance_date) FROM stock_balances WHERE product_id = p.id)
+            WHERE b.opening_quantity + b.quantity_in - b.quantity_out + b.quantity_reversal <> p.quantity
+        )")) {
+        return fail(q);
+    }
+    while (q.next()) {
+        r.balanceMismatches++;
+        r.mismatchDetails << QString("#%1 %2: stock card closes at %3, product quantity is %4")
+                                 .arg(q.value(0).toInt())
+                                 .arg(q.value(1).toString())
+                                 .arg(q.value(3).toInt())
+                                 .arg(q.value(2).toInt());
+    }
+
+    // ---- Move whole years of old sales to their archives ----
+    // Before the vacuum, so the pages they held are returned too
+    if (archiveBeforeYear > 0) {
+        q.prepare("SELECT DISTINCT CAST(substr(sale_date, 1, 4) AS INTEGER) FROM transactions WHERE sale_date < ?");
+        q.addBindValue(QDate(archiveBeforeYear, 1, 1).toString(Qt::ISODate));
+        if (!q.exec()) {
+            return fail(q);
+        }
+        QList<int> years;
+        while (q.next()) {
+            years << q.value(0).toInt();
+        }
+        q.finish();
+
+        for (int year : years) {
+            int moved = Database::instance().archiveYear(year);
+            if (moved < 0) {
+                r.error = QString("Archiving %1: %2").arg(year).arg(Database::instance().lastError());
+                r.elapsedMs = timer.elapsed();
+                return r;
+            }
+            r.yearsArchived << year;
+            r.transactionsArchived += moved;
+        }
+    }
+
+    // ---- Give freed pages back ----
+    // A full VACUUM and a truncating checkpoint both lock out every till while they run, longer than a checkout
+    // waits for the lock, so they wait until the change log (every sale, stock-in and product edit, from any till)
+    // has been quiet for a while
+    qint64 lastWriteMs = 0;
+    if (q.exec("SELECT created_at FROM change_log ORDER BY seq DESC LIMIT 1") && q.next()) {
+        lastWriteMs = q.value(0).toLongLong();
+    }
+    q.finish();
+    const qint64 idleMs = QDateTime::currentMSecsSinceEpoch() - lastWriteMs;
+    const bool tillIdle = vacuumIdleMinutes >= 0 && idleMs >= vacuumIdleMinutes * 60LL * 1000;
+
+    q.exec("PRAGMA auto_vacuum");
+    if (q.next() && q.value(0).toInt() != 2) {
+        // Databases created before auto_vacuum was enabled need one full VACUUM to switch modes
+        q.finish();
+        if (!tillIdle) {
+            r.vacuumDeferred = true;
+        } else {
+            q.exec("PRAGMA auto_vacuum=INCREMENTAL");
+            if (!q.exec("VACUUM")) {
+                qWarning() << "Maintenance: VACUUM failed:" << q.lastError().text();
+            }
+        }
+    }
+
+    qint64 freeBefore = 0;
+    q.exec("PRAGMA freelist_count");
+    if (q.next()) {
+        freeBefore = q.value(0).toLongLong();
+    }
+    q.exec("PRAGMA incremental_vacuum");
+    while (q.next()) {
+        // Each step frees one page
+    }
+    q.exec("PRAGMA freelist_count");
+    if (q.next()) {
+        r.pagesFreed = qMax<qint64>(0, freeBefore - q.value(0).toLongLong());
+    }
+
+    q.exec("PRAGMA optimize");
+    // A passive checkpoint copies what it can without waiting on anyone
+    q.exec(tillIdle ? "PRAGMA wal_checkpoint(TRUNCATE)" : "PRAGMA wal_checkpoint(PASSIVE)");
+
+    r.ok = true;
+    r.elapsedMs = timer.elapsed();
+    return r;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QDate>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QtSql/QSqlDatabase>
+
+class QThread;
+
+struct MaintenanceReport {
+    bool ok = false;
+    QString error;
+    QDate cutoff;               // daily rows before this date were rolled into monthly snapshots
+    int rowsCompacted = 0;      // daily rows removed
+    int snapshotsWritten = 0;   // monthly rows that replaced them
+    int balanceMismatches = 0;  // products whose last closing balance differs from products.quantity
+    QStringList mismatchDetails;
+    QList<int> yearsArchived;       // years whose sales were moved to their archive files
+    int transactionsArchived = 0;
+    qint64 pagesFreed = 0;
+    bool vacuumDeferred = false;  // the one-time switch to incremental vacuum waits for a quiet spell
+    qint64 elapsedMs = 0;
+
+    [[nodiscard]] QString summary() const;
+};
+
+// Housekeeping for the stock tables, run off the GUI thread on its own connection:
+//  - daily stock_balances rows older than the retention window are rolled into one row per product per month,
+//    one month per write transaction,
+//  - each product's latest closing balance is checked against products.quantity,
+//  - sales from before `archiveBeforeYear` are moved, a year at a time, to the archive files,
+//  - PRAGMA optimize and an incremental vacuum return the freed pages to the file system. A file from before
+//    incremental vacuum needs one full VACUUM to switch, which holds the write lock for the whole rewrite, so it
+//    only runs once nothing has been written for `vacuum_idle_minutes`. The WAL is truncated in the same quiet
+//    spell; otherwise the checkpoint is passive.
+class MaintenanceJob : public QObject {
+    Q_OBJECT
+  public:
+    explicit MaintenanceJob(QObject* parent = nullptr);
+    ~MaintenanceJob() override;
+
+    // Starts a run in the background; ignored while one is already running.
+    void start();
+    [[nodiscard]] bool isRunning() const { return m_running; }
+    [[nodiscard]] MaintenanceReport lastReport() const { return m_lastReport; }
+
+    // Runs synchronously on the calling thread using `db`, Database's connection for that thread; `today` is the
+    // shop's date.
+    static MaintenanceReport run(QSqlDatabase db, const QDate& today, int retentionDays, int archiveBeforeYear,
+                                 int vacuumIdleMinutes);
+
+  signals:
+    void finished(const MaintenanceReport& report);
+
+  private:
+    QThread* m_thread = nullptr;
+    bool m_running = false;
+    MaintenanceReport m_lastReport;
+};
@@ -1,5 +1,10 @@
 #include "mainwindow.hpp"
+#include "alertengine.hpp"
+#include "alertswidget.hpp"
+#include "backup.hpp"
+#include "database.hpp"
 #include "invoiceswidget.hpp"
+#include "maintenance.hpp"
 #include "poswidget.hpp"
 #include "productswidget.hpp"
 #include "reportswidget.hpp"
@@ -7,9 +12,12 @@
 #include "userswidget.hpp"
 
 #include <QApplication>
+#include <QDateTime>
+#include <QDebug>
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include <QScreen>
+#include <QTimer>
 #include <QVBoxLayout>
 
 MainWindow::MainWindow(const User& user, QWidget* parent) : QMainWindow(parent), m_currentUser(user) {
@@ -22,7 +30,34 @@ MainWindow::MainWindow(const User& user, QWidget* parent) : QMainWindow(parent),
         move(sg.center() - rect().center());
     }
 
+    m_alertEngine = new AlertEngine(this);
     setupUi();
+
+    // Stock table housekeeping: shortly after startup, then once a day for tills left running
+    m_maintenance = new MaintenanceJob(this);
+    connect(m_maintenance, &MaintenanceJob::finished, this, &MainWindow::onMaintenanceFinished);
+    QTimer::singleShot(60 * 1000, m_maintenance, &MaintenanceJob::start);
+    auto* maintenanceTimer = new QTimer(this);
+    maintenanceTimer->setInterval(24 * 60 * 60 * 1000);
+    connect(maintenanceTimer, &QTimer::timeout, m_maintenance, &MaintenanceJob::start);
+    maintenanceTimer->start();
+
+    // Online backups to `backup_directory`, every `backup_interval_minutes` while the till is open
+    m_backup = new BackupJob(this);
+    connect(m_backup, &BackupJob::finished, this, &MainWindow::onBackupFinished);
+    int backupMinutes = qMax(1, Database::instance().setting("backup_interval_minutes", "15").toInt());
+    auto* backupTimer = new QTimer(this);
+    backupTimer->setInterval(backupMinutes * 60 * 1000);
+    connect(backupTimer, &QTimer::timeout, m_backup, &BackupJob::start);
+    backupTimer->start();
+
+    // Writes by other tills on the same file and by delta imports reach the open screens through the change log,
+    // checked every `change_poll_ms`
+    int pollMs = qMax(250, Database::instance().setting("change_poll_ms", "2000").toInt());
+    auto* pollTimer = new QTimer(this);
+    pollTimer->setInterval(pollMs);
+    connect(pollTimer, &QTimer::timeout, this, [] { Database::instance().pollChanges(); });
+    pollTimer->start();
 }
 
 void MainWindow::setupUi() {
@@ -68,13 +103,27 @@ void MainWindow::setupUi() {
     addNavButton(sidebar, sideLayout, "🧾", "Transactions", 3);
     addNavButton(sidebar, sideLayout, "📊", "Reports", 4);
 
+    // Alerts button carries a count badge fed by the alert engine
+    auto* alertsBtn = addNavButton(sidebar, sideLayout, "⚠️", "Alerts", 5);
+    auto* badgeLayout = new QHBoxLayout(alertsBtn);
+    badgeLayout->setContentsMargins(0, 0, 12, 0);
+    badgeLayout->addStretch();
+    m_alertBadge = new QLabel;
+    m_alertBadge->setAlignment(Qt::AlignCenter);
+    m_alertBadge->setMinimumWidth(22);
+    m_alertBadge->setStyleSheet(
+        "background-color: #e53e3e; color: white; border-radius: 9px; "
+        "font-size: 11px; font-weight: 700; padding: 1px 6px;");
+    m_alertBadge->setAttribute(Qt::WA_TransparentForMouseEvents);
+    badgeLayout->addWidget(m_alertBadge);
+
     if (m_currentUser.isAdmin) {
         auto* adminLabel = new QLabel("ADMIN");
         adminLabel->setObjectName("sectionLabel");
         sideLayout->addWidget(adminLabel);
         // Add margin top to separate from above section
         adminLabel->setContentsMargins(0, 12, 0, 4);
-        addNavButton(sidebar, sideLayout, "👥", "Users", 5);
+        addNavButton(sidebar, sideLayout, "👥", "Users", 6);
     }
 
     sideLayout->addStretch();
@@ -116,6 +165,7 @@ void MainWindow::setupUi() {
     m_invoicesWidget = new InvoicesWidget(m_currentUser);
     m_transactionsWidget = new TransactionsWidget(m_currentUser);
     m_reportsWidget = new ReportsWidget(m_currentUser);
+    m_alertsWidget = new AlertsWidget(m_alertEngine);
     m_usersWidget = new UsersWidget(m_currentUser);
 
     m_stack->addWidget(m_posWidget);           // 0
@@ -123,8 +173,9 @@ void MainWindow::setupUi() {
     m_stack->addWidget(m_invoicesWidget);      // 2
     m_stack->addWidget(m_transactionsWidget);  // 3
     m_stack->addWidget(m_reportsWidget);       // 4
+    m_stack->addWidget(m_alertsWidget);        // 5
 
-    m_stack->addWidget(m_usersWidget);  // 5
+    m_stack->addWidget(m_usersWidget);  // 6
 
     mainLayout->addWidget(m_stack);
 
@@ -133,6 +184,8 @@ void MainWindow::setupUi() {
 
     // Connect signals
     connect(logoutBtn, &QPushButton::clicked, this, &MainWindow::onLogout);
+    connect(m_alertEngine, &AlertEngine::alertsChanged, this, &MainWindow::updateAlertBadge);
+    updateAlertBadge(m_alertEngine->count());
 
     // Activate POS by default
     if (!m_navBtns.isEmpty()) {
@@ -141,8 +194,8 @@ void MainWindow::setupUi() {
     switchPage(0);
 }
 
-void MainWindow::addNavButton(QWidget* /*w*/, QVBoxLayout* layout, const QString& icon, const QString& text,
-                              int index) {
+QPushButton* MainWindow::addNavButton(QWidget* /*w*/, QVBoxLayout* layout, const QString& icon, const QString& text,
+                                      int index) {
     auto* btn = new QPushButton(icon + "  " + text);
     btn->setCheckable(true);
     btn->setAutoExclusive(false);
@@ -156,6 +209,33 @@ void MainWindow::addNavButton(QWidget* /*w*/, QVBoxLayout* layout, const QString
     connect(btn, &QPushButton::clicked, this, [this, idx] { switchPage(idx); });
     layout->addWidget(btn);
     m_navBtns.append(btn);
+    return btn;
+}
+
+void MainWindow::updateAlertBadge(int count) {
+    m_alertBadge->setText(count > 99 ? "99+" : QString::number(count));
+    m_alertBadge->setVisible(count > 0);
+}
+
+void MainWindow::onMaintenanceFinished(const MaintenanceReport& report) {
+    qInfo().noquote() << report.summary();
+    for (const auto& detail : report.mismatchDetails) {
+        qWarning().noquote() << "Stock balance mismatch:" << detail;
+    }
+    Database::instance().setSetting("maintenance_last_report",
+                                    QDateTime::currentDateTime().toString(Qt::ISODate) + "  " + report.summary());
+    statusBar()->showMessage(report.summary(), 15000);
+}
+
+void MainWindow::onBackupFinished(const BackupReport& report) {
+    if (!report.ok) {
+        qWarning().noquote() << report.summary();
+        statusBar()->showMessage(report.summary(), 30000);
+    } else {
+        qInfo().noquote() << report.summary();
+    }
+    Database::instance().setSetting("backup_last_report",
+                                    QDateTime::currentDateTime().toString(Qt::ISODate) + "  " + report.summary());
 }
 
 void MainWindow::switchPage(int index) {
@@ -164,16 +244,12 @@ void MainWindow::switchPage(int index) {
         m_navBtns[i]->setChecked(i == index);
     }
 
-    // Refresh widgets when switched to
-    if (index == 1) {
-        m_productsWidget->refresh();
-    } else if (index == 2) {
-        m_invoicesWidget->refresh();
-    } else if (index == 3) {
-        m_transactionsWidget->refresh();
-    } else if (index == 4) {
-        m_reportsWidget->refresh();
-    } else if (index == 5) {
+    // Products, invoices and sales pages patch themselves from Database's change notifications and reports
+    // rebuild when shown after a change, so only the pages fed from elsewhere reload here: alerts from the
+    // engine's in-memory list, users because user accounts are not announced
+    if (index == 5) {
+        m_alertsWidget->refresh();
+    } else if (index == 6) {
         m_usersWidget->refresh();
     }
 }
@@ -14,7 +14,13 @@ class ProductsWidget;
 class InvoicesWidget;
 class TransactionsWidget;
 class ReportsWidget;
+class AlertsWidget;
 class UsersWidget;
+class AlertEngine;
+class MaintenanceJob;
+struct MaintenanceReport;
+class BackupJob;
+struct BackupReport;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -35,10 +41,20 @@ class MainWindow : public QMainWindow {
     InvoicesWidget* m_invoicesWidget;
     TransactionsWidget* m_transactionsWidget;
     ReportsWidget* m_reportsWidget;
+    AlertsWidget* m_alertsWidget;
     UsersWidget* m_usersWidget;
 
+    AlertEngine* m_alertEngine;
+    QLabel* m_alertBadge;
+    MaintenanceJob* m_maintenance;
+    BackupJob* m_backup;
+
     QLabel* m_userLabel;
 
     void setupUi();
-    void addNavButton(QWidget* sidebar, QVBoxLayout* layout, const QString& icon, const QString& text, int index);
+    QPushButton* addNavButton(QWidget* sidebar, QVBoxLayout* layout, const QString& icon, const QString& text,
+                              int index);
+    void updateAlertBadge(int count);
+    void onMaintenanceFinished(const MaintenanceReport& report);
+    void onBackupFinished(const BackupReport& report);
 };
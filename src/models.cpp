@@ -7,8 +7,8 @@ QJsonObject Product::toJson() const {
     obj["generic_name"] = genericName;
     obj["brand_name"] = brandName;
     obj["quantity"] = quantity;
-    obj["cost_price"] = costPrice;
-    obj["selling_price"] = sellingPrice;
+    obj["cost_price"] = costPrice.toDouble();
+    obj["selling_price"] = sellingPrice.toDouble();
     obj["barcode"] = barcode;
     QJsonArray dates;
     for (const auto& d : expiryDates) {
@@ -24,8 +24,8 @@ Product Product::fromJson(const QJsonObject& obj) {
     p.genericName = obj["generic_name"].toString();
     p.brandName = obj["brand_name"].toString();
     p.quantity = obj["quantity"].toInt();
-    p.costPrice = obj["cost_price"].toDouble();
-    p.sellingPrice = obj["selling_price"].toDouble();
+    p.costPrice = Money::fromDouble(obj["cost_price"].toDouble());
+    p.sellingPrice = Money::fromDouble(obj["selling_price"].toDouble());
     p.barcode = obj["barcode"].toString();
     QJsonArray dates = obj["expiry_dates"].toArray();
     for (const auto& d : dates) {
@@ -40,8 +40,8 @@ QJsonObject TransactionItem::toJson() const {
     obj["generic_name"] = genericName;
     obj["brand_name"] = brandName;
     obj["quantity"] = quantity;
-    obj["selling_price"] = sellingPrice;
-    obj["cost_price"] = costPrice;
+    obj["selling_price"] = sellingPrice.toDouble();
+    obj["cost_price"] = costPrice.toDouble();
     obj["barcode"] = barcode;
     return obj;
 }
@@ -52,8 +52,8 @@ TransactionItem TransactionItem::fromJson(const QJsonObject& obj) {
     item.genericName = obj["generic_name"].toString();
     item.brandName = obj["brand_name"].toString();
     item.quantity = obj["quantity"].toInt();
-    item.sellingPrice = obj["selling_price"].toDouble();
-    item.costPrice = obj["cost_price"].toDouble();
+    item.sellingPrice = Money::fromDouble(obj["selling_price"].toDouble());
+    item.costPrice = Money::fromDouble(obj["cost_price"].toDouble());
     item.barcode = obj["barcode"].toString();
     return item;
 }
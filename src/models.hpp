@@ -6,6 +6,51 @@
 #include <QJsonObject>
 #include <QList>
 #include <QString>
+#include <QtGlobal>
+
+// An amount of money as a whole number of cents (the minor unit), so sums, differences and quantities times
+// prices are exact integers. Converted to double only at the edges: display, charts and JSON.
+class Money {
+  public:
+    constexpr Money() = default;
+
+    static constexpr Money fromCents(qint64 cents) {
+        Money m;
+        m.m_cents = cents;
+        return m;
+    }
+    // Rounds to the nearest cent
+    static Money fromDouble(double amount) { return fromCents(qRound64(amount * 100.0)); }
+
+    [[nodiscard]] constexpr qint64 cents() const { return m_cents; }
+    [[nodiscard]] constexpr double toDouble() const { return static_cast<double>(m_cents) / 100.0; }
+    // One of `n` equal shares, rounded to the nearest cent (averages per unit)
+    [[nodiscard]] Money dividedBy(qint64 n) const { return fromCents(qRound64(static_cast<double>(m_cents) / n)); }
+
+    constexpr Money& operator+=(Money o) {
+        m_cents += o.m_cents;
+        return *this;
+    }
+    constexpr Money& operator-=(Money o) {
+        m_cents -= o.m_cents;
+        return *this;
+    }
+    friend constexpr Money operator+(Money a, Money b) { return fromCents(a.m_cents + b.m_cents); }
+    friend constexpr Money operator-(Money a, Money b) { return fromCents(a.m_cents - b.m_cents); }
+    friend constexpr Money operator-(Money a) { return fromCents(-a.m_cents); }
+    friend constexpr Money operator*(Money a, qint64 n) { return fromCents(a.m_cents * n); }
+    friend constexpr Money operator*(qint64 n, Money a) { return fromCents(a.m_cents * n); }
+
+    friend constexpr bool operator==(Money a, Money b) { return a.m_cents == b.m_cents; }
+    friend constexpr bool operator!=(Money a, Money b) { return a.m_cents != b.m_cents; }
+    friend constexpr bool operator<(Money a, Money b) { return a.m_cents < b.m_cents; }
+    friend constexpr bool operator>(Money a, Money b) { return a.m_cents > b.m_cents; }
+    friend constexpr bool operator<=(Money a, Money b) { return a.m_cents <= b.m_cents; }
+    friend constexpr bool operator>=(Money a, Money b) { return a.m_cents >= b.m_cents; }
+
+  private:
+    qint64 m_cents = 0;
+};
 
 struct User {
     int id = 0;
@@ -21,8 +66,8 @@ struct Product {
     QString genericName;
     QString brandName;
     int quantity = 0;
-    double costPrice = 0.0;
-    double sellingPrice = 0.0;
+    Money costPrice;
+    Money sellingPrice;
     QList<QDate> expiryDates;
     QString barcode;
     QDateTime createdAt;
@@ -44,11 +89,11 @@ struct TransactionItem {
     QString genericName;
     QString brandName;
     int quantity = 0;
-    double sellingPrice = 0.0;
-    double costPrice = 0.0;
+    Money sellingPrice;
+    Money costPrice;
     QString barcode;
 
-    [[nodiscard]] double subtotal() const { return quantity * sellingPrice; }
+    [[nodiscard]] Money subtotal() const { return sellingPrice * quantity; }
     [[nodiscard]] QJsonObject toJson() const;
     static TransactionItem fromJson(const QJsonObject& obj);
 };
@@ -57,10 +102,11 @@ struct Transaction {
     int id = 0;
     QList<TransactionItem> items;
     QDateTime createdAt;
+    QDate saleDate;  // date of createdAt in the shop's time zone
     int userId = 0;
 
-    [[nodiscard]] double total() const {
-        double t = 0;
+    [[nodiscard]] Money total() const {
+        Money t;
         for (const auto& i : items) {
             t += i.subtotal();
         }
@@ -72,9 +118,9 @@ struct Invoice {
     int id = 0;
     QString invoiceNumber;
     QDate purchaseDate;
-    double invoiceTotal = 0.0;
-    double amountPaid = 0.0;
-    double balance = 0.0;
+    Money invoiceTotal;
+    Money amountPaid;
+    Money balance;
     QString supplier;
     int userId = 0;
     QDateTime createdAt;
@@ -85,7 +131,7 @@ struct StockInItem {
     int productId = 0;
     int invoiceId = 0;
     int quantity = 0;
-    double costPrice = 0.0;
+    Money costPrice;
     QDate expiryDate;
     QString comment;
     QDateTime createdAt;
@@ -116,28 +162,66 @@ struct StockCard {
     int closingQuantity = 0;
 };
 
+struct StockAlert {
+    // Bit flags; a product can be low on stock and expiring at the same time.
+    enum Kind { LowStock = 0x1, OutOfStock = 0x2, Expiring = 0x4, Expired = 0x8 };
+
+    int productId = 0;
+    QString genericName;
+    QString brandName;
+    int quantity = 0;
+    int reorderLevel = 0;
+    QDate nextExpiry;
+    int kinds = 0;
+};
+
+// Bucket size of a product sales report
+enum class SalesPeriod { Daily, Monthly, Annual };
+
+// What a top-products ranking is ordered by
+enum class ProductMetric { Income, Profit, Quantity };
+
 struct ProductSale {
     QDate transactionDate;
     int productId = 0;
     QString productName;
-    double costPrice = 0.0;
-    double sellingPrice = 0.0;
+    Money costPrice;
+    Money sellingPrice;
     int quantitySold = 0;
-    double income = 0.0;
-    double profit = 0.0;
+    Money income;
+    Money profit;
 };
 
 struct SalesReport {
     QDate transactionDate;
-    double totalIncome = 0.0;
+    Money totalIncome;
 };
 
 struct MonthlySalesReport {
     QDate month;
-    double totalIncome = 0.0;
+    Money totalIncome;
 };
 
 struct AnnualSalesReport {
     QDate year;
-    double totalIncome = 0.0;
+    Money totalIncome;
+};
+
+// One line change of a held basket. The journal is append-only: the newest entry per product wins and a
+// quantity of 0 means the line was removed. `line` is the till's own serialisation of the line.
+struct BasketJournalEntry {
+    int basketId = 0;
+    int productId = 0;
+    int quantity = 0;
+    QJsonObject line;
+};
+
+// An in-progress (active) or parked POS basket, folded from its journal
+struct HeldBasket {
+    int id = 0;
+    int userId = 0;
+    QString label;
+    bool active = false;
+    QDateTime updatedAt;
+    QList<QJsonObject> lines;  // in the order they were first added, "quantity" already current
 };
@@ -1,27 +1,55 @@
 #include "poswidget.hpp"
-#include <QComboBox>
-#include <QDateEdit>
-#include <QDoubleSpinBox>
+#include <QCheckBox>
+#include <QDebug>
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QHeaderView>
-#include <QKeyEvent>
+#include <QInputDialog>
 #include <QLocale>
-#include <QMessageBox>
-#include <QPlainTextEdit>
+#include <QMenu>
+#include <QPointer>
 #include <QScrollArea>
 #include <QShortcut>
-#include <QSpinBox>
 #include <QSplitter>
-#include <QTextEdit>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <algorithm>
+#include <memory>
 #include "database.hpp"
+#include "receipt.hpp"
+#include "writequeue.hpp"
+
+static constexpr int kQuickPickCount = 30;
+static constexpr int kQuickPickColumns = 6;
 
 POSWidget::POSWidget(User user, QWidget* parent) : QWidget(parent), m_currentUser(std::move(user)) {
     setupUi();
     loadProducts();
+    loadQuickPicks();
+    restoreHeldBaskets();
+
+    // Sales reorder the popularity index, any stock change can empty a pick and product edits can change
+    // barcodes, so refresh all three; this till's sales and another's alike. Only the changed products are
+    // re-read.
+    m_changeListenerId = Database::instance().addChangeListener([this](const Database::DataChange& change) {
+        if (change.unknown) {
+            m_barcodes.rebuild();
+            loadProducts(m_searchEdit->text());
+            loadQuickPicks();
+            return;
+        }
+        if (change.products.isEmpty()) {
+            return;
+        }
+        m_barcodes.refresh(change.products);
+        updateProductRows(change.products);
+        updateQuickPicks(change.products);
+    });
+}
+
+POSWidget::~POSWidget() {
+    Database::instance().removeChangeListener(m_changeListenerId);
+    m_journal->flush();  // while the basket model is still alive
 }
 
 void POSWidget::setupUi() {
@@ -58,6 +86,37 @@ void POSWidget::setupUi() {
     leftLayout->setContentsMargins(0, 0, 0, 0);
     leftLayout->setSpacing(8);
 
+    // Quick picks
+    auto* quickPickBox = new QGroupBox("⭐  Quick Picks");
+    auto* quickPickScroll = new QScrollArea;
+    quickPickScroll->setWidgetResizable(true);
+    quickPickScroll->setFrameShape(QFrame::NoFrame);
+    quickPickScroll->setMaximumHeight(190);
+    auto* quickPickContent = new QWidget;
+    m_quickPickGrid = new QGridLayout(quickPickContent);
+    m_quickPickGrid->setContentsMargins(0, 0, 0, 0);
+    m_quickPickGrid->setSpacing(6);
+    for (int i = 0; i < kQuickPickCount; ++i) {
+        auto* btn = new QPushButton;
+        btn->setMinimumHeight(52);
+        btn->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+        btn->setFocusPolicy(Qt::NoFocus);  // keep scanner input on the product table
+        btn->setStyleSheet(
+            "QPushButton { background-color: #ebf4ff; color: #1e3a5f; border: 1px solid #bee3f8; "
+            "border-radius: 6px; font-size: 12px; font-weight: 600; padding: 4px; }"
+            "QPushButton:hover { background-color: #dbeafe; }"
+            "QPushButton:disabled { background-color: #f7fafc; color: #a0aec0; border-color: #e2e8f0; }");
+        btn->hide();
+        connect(btn, &QPushButton::clicked, this, [this, i] { onQuickPick(i); });
+        m_quickPickGrid->addWidget(btn, i / kQuickPickColumns, i % kQuickPickColumns);
+        m_quickPickButtons.append(btn);
+    }
+    quickPickScroll->setWidget(quickPickContent);
+    auto* quickPickLayout = new QVBoxLayout(quickPickBox);
+    quickPickLayout->setContentsMargins(8, 8, 8, 8);
+    quickPickLayout->addWidget(quickPickScroll);
+    leftLayout->addWidget(quickPickBox);
+
     auto* searchRow = new QHBoxLayout;
     auto* searchLabel = new QLabel("Search Product:");
     searchLabel->setStyleSheet("font-weight: 600; color: #4a5568;");
@@ -106,9 +165,11 @@ void POSWidget::setupUi() {
     receiptTitle->setStyleSheet("font-size: 16px; font-weight: 700; color: #1e3a5f;");
     rightLayout->addWidget(receiptTitle);
 
-    m_queueTable = new QTableWidget;
-    m_queueTable->setColumnCount(6);
-    m_queueTable->setHorizontalHeaderLabels({"Product", "Brand", "Price", "Qty", "Subtotal", "✕"});
+    m_basket = new BasketModel(this);
+    m_queueTable = new QTableView;
+    m_queueTable->setModel(m_basket);
+    m_queueTable->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed |
+                                  QAbstractItemView::AnyKeyPressed);
     m_queueTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_queueTable->setAlternatingRowColors(true);
     m_queueTable->horizontalHeader()->setStretchLastSection(false);
@@ -121,6 +182,7 @@ void POSWidget::setupUi() {
     m_queueTable->verticalHeader()->setVisible(false);
     m_queueTable->setShowGrid(false);
     rightLayout->addWidget(m_queueTable);
+    m_journal = new BasketJournal(m_basket, m_currentUser.id, this);
 
     // Total
     auto* totalWidget = new QWidget;
@@ -143,11 +205,40 @@ void POSWidget::setupUi() {
     m_saveBtn = new QPushButton("💾  Save Transaction");
     m_saveBtn->setObjectName("successBtn");
     m_saveBtn->setFixedHeight(38);
+    m_printCheck = new QCheckBox("Print receipt");
+    m_printCheck->setChecked(Database::instance().setting("pos_print_receipts", "0") == "1");
+    m_printCheck->setFocusPolicy(Qt::NoFocus);
+    m_parkBtn = new QPushButton("⏸  Park");
+    m_parkBtn->setObjectName("secondaryBtn");
+    m_parkBtn->setFixedHeight(38);
+    m_parkBtn->setToolTip("Put this basket aside and serve another customer");
+    m_resumeMenu = new QMenu(this);
+    m_resumeBtn = new QPushButton("▶  Resume");
+    m_resumeBtn->setObjectName("secondaryBtn");
+    m_resumeBtn->setFixedHeight(38);
+    m_resumeBtn->setMenu(m_resumeMenu);
     btnRow->addWidget(m_clearBtn);
+    btnRow->addWidget(m_parkBtn);
+    btnRow->addWidget(m_resumeBtn);
     btnRow->addStretch();
+    btnRow->addWidget(m_printCheck);
     btnRow->addWidget(m_saveBtn);
     rightLayout->addLayout(btnRow);
 
+    // Toast, floated over the bottom of the page
+    m_toast = new QLabel(this);
+    m_toast->setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_toast->setAlignment(Qt::AlignCenter);
+    m_toast->hide();
+    m_toastTimer = new QTimer(this);
+    m_toastTimer->setSingleShot(true);
+    connect(m_toastTimer, &QTimer::timeout, m_toast, &QLabel::hide);
+
+    m_receiptPrinter = new ReceiptPrinter(this);
+    connect(m_receiptPrinter, &ReceiptPrinter::failed, this, [this](int id, const QString& message) {
+        showToast(QString("Receipt #%1 not printed: %2").arg(id).arg(message), true);
+    });
+
     splitter->addWidget(leftWidget);
     splitter->addWidget(rightWidget);
     splitter->setStretchFactor(0, 3);
@@ -159,7 +250,23 @@ void POSWidget::setupUi() {
     connect(m_productsTable, &QTableWidget::cellDoubleClicked, this, &POSWidget::onProductDoubleClicked);
     connect(m_saveBtn, &QPushButton::clicked, this, &POSWidget::saveTransaction);
     connect(m_clearBtn, &QPushButton::clicked, this, &POSWidget::clearQueue);
-    connect(m_queueTable, &QTableWidget::cellChanged, this, &POSWidget::updateQueueSubtotal);
+    connect(m_printCheck, &QCheckBox::toggled, this, [](bool on) {
+        Database::instance().setSetting("pos_print_receipts", on ? "1" : "0");
+    });
+    connect(m_parkBtn, &QPushButton::clicked, this, &POSWidget::parkBasket);
+    connect(m_resumeMenu, &QMenu::aboutToShow, this, &POSWidget::populateResumeMenu);
+    connect(m_basket, &BasketModel::totalChanged, this, &POSWidget::updateTotal);
+    connect(m_basket, &BasketModel::quantityClamped, this, [this](int, int maxQuantity) {
+        showToast(QString("Maximum available quantity is %1").arg(maxQuantity), true);
+    });
+    connect(m_queueTable, &QTableView::clicked, this, [this](const QModelIndex& index) {
+        if (index.column() == BasketModel::RemoveColumn) {
+            removeFromQueue(index.row());
+        }
+    });
+    auto* deleteShortcut = new QShortcut(QKeySequence::Delete, m_queueTable);
+    connect(deleteShortcut, &QShortcut::activated, this,
+            [this] { removeFromQueue(m_queueTable->currentIndex().row()); });
 
     // Enter key on product table
     auto* enterShortcut = new QShortcut(QKeySequence(Qt::Key_Return), m_productsTable);
@@ -170,14 +277,22 @@ void POSWidget::setupUi() {
         }
     });
 
-    m_barcodeTimer = new QTimer(this);
-    m_barcodeTimer->setSingleShot(true);
-    m_barcodeTimer->setInterval(100);  // 100ms gap = end of scan burst
-    connect(m_barcodeTimer, &QTimer::timeout, this, &POSWidget::onBarcodeEntered);
     connect(m_barcodeEdit, &QLineEdit::returnPressed, this, &POSWidget::onBarcodeEntered);
 
-    // Install event filter to capture barcode scanner input globally
-    m_productsTable->installEventFilter(this);
+    // Scanner input is picked up application-wide while the POS is on screen, whatever has focus
+    m_scanner = new BarcodeScanner(this);
+    connect(m_scanner, &BarcodeScanner::scanned, this, &POSWidget::onScanned);
+    m_barcodes.rebuild();
+}
+
+void POSWidget::showEvent(QShowEvent* event) {
+    QWidget::showEvent(event);
+    m_scanner->setActive(true);
+}
+
+void POSWidget::hideEvent(QHideEvent* event) {
+    QWidget::hideEvent(event);
+    m_scanner->setActive(false);
 }
 
 void POSWidget::loadProducts(const QString& filter) {
@@ -186,95 +301,191 @@ void POSWidget::loadProducts(const QString& filter) {
     m_productsTable->setRowCount(static_cast<int>(m_currentProducts.size()));
 
     for (int i = 0; i < m_currentProducts.size(); ++i) {
-        const Product& p = m_currentProducts[i];
-
-        auto* idItem = new QTableWidgetItem(QString::number(p.id));
-        idItem->setTextAlignment(Qt::AlignCenter);
-        m_productsTable->setItem(i, 0, idItem);
-        m_productsTable->setItem(i, 1, new QTableWidgetItem(p.genericName));
-        m_productsTable->setItem(i, 2, new QTableWidgetItem(p.brandName));
-
-        auto* priceItem = new QTableWidgetItem(QString::number(p.sellingPrice, 'f', 2));
-        priceItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        m_productsTable->setItem(i, 3, priceItem);
-
-        auto* qtyItem = new QTableWidgetItem(QString::number(p.quantity));
-        qtyItem->setTextAlignment(Qt::AlignCenter);
-        if (p.quantity == 0) {
-            qtyItem->setForeground(Qt::red);
-        } else if (p.quantity < 10) {
-            qtyItem->setForeground(QColor("#d97706"));
-        }
-        m_productsTable->setItem(i, 4, qtyItem);
+        setProductRow(i, m_currentProducts[i]);
+    }
+}
 
-        // Expiry dates
-        QStringList dates;
-        for (const auto& d : p.expiryDates) {
-            dates << d.toString("MMM yyyy");
-        }
-        m_productsTable->setItem(i, 5, new QTableWidgetItem(dates.join(", ")));
+void POSWidget::setProductRow(int row, const Product& p) {
+    auto* idItem = new QTableWidgetItem(QString::number(p.id));
+    idItem->setTextAlignment(Qt::AlignCenter);
+    m_productsTable->setItem(row, 0, idItem);
+    m_productsTable->setItem(row, 1, new QTableWidgetItem(p.genericName));
+    m_productsTable->setItem(row, 2, new QTableWidgetItem(p.brandName));
+
+    auto* priceItem = new QTableWidgetItem(QString::number(p.sellingPrice.toDouble(), 'f', 2));
+    priceItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    m_productsTable->setItem(row, 3, priceItem);
+
+    auto* qtyItem = new QTableWidgetItem(QString::number(p.quantity));
+    qtyItem->setTextAlignment(Qt::AlignCenter);
+    if (p.quantity == 0) {
+        qtyItem->setForeground(Qt::red);
+    } else if (p.quantity < 10) {
+        qtyItem->setForeground(QColor("#d97706"));
+    }
+    m_productsTable->setItem(row, 4, qtyItem);
+
+    // Expiry dates
+    QStringList dates;
+    for (const auto& d : p.expiryDates) {
+        dates << d.toString("MMM yyyy");
+    }
+    m_productsTable->setItem(row, 5, new QTableWidgetItem(dates.join(", ")));
 
-        if (p.quantity == 0) {
-            for (int c = 0; c < 6; ++c) {
-                if (m_productsTable->item(i, c)) {
-                    m_productsTable->item(i, c)->setBackground(QColor("#fff5f5"));
-                }
+    if (p.quantity == 0) {
+        for (int c = 0; c < 6; ++c) {
+            if (m_productsTable->item(row, c)) {
+                m_productsTable->item(row, c)->setBackground(QColor("#fff5f5"));
             }
         }
     }
 }
 
-void POSWidget::onSearchChanged(const QString& text) { loadProducts(text); }
+void POSWidget::updateProductRows(const QList<int>& productIds) {
+    // Only the rows of the changed products are re-read and repainted; the rest of the table stays as it is.
+    // Prices come along, so what goes into the basket is never a stale price.
+    for (int i = static_cast<int>(m_currentProducts.size()) - 1; i >= 0; --i) {
+        if (!productIds.contains(m_currentProducts[i].id)) {
+            continue;
+        }
+        const Product p = Database::instance().getProductById(m_currentProducts[i].id);
+        if (p.id == 0) {
+            m_currentProducts.removeAt(i);
+            m_productsTable->removeRow(i);
+            continue;
+        }
+        m_currentProducts[i] = p;
+        setProductRow(i, p);
+    }
+}
 
-bool POSWidget::eventFilter(QObject* obj, QEvent* event) {
-    if (event->type() == QEvent::KeyPress) {
-        auto* ke = static_cast<QKeyEvent*>(event);
+void POSWidget::showToast(const QString& text, bool error) {
+    m_toast->setStyleSheet(QString("QLabel { background-color: %1; color: white; border-radius: 8px; "
+                                   "padding: 10px 18px; font-size: 14px; font-weight: 600; }")
+                               .arg(error ? "#c53030" : "#276749"));
+    m_toast->setText(text);
+    m_toast->adjustSize();
+    m_toast->move((width() - m_toast->width()) / 2, height() - m_toast->height() - 24);
+    m_toast->raise();
+    m_toast->show();
+    m_toastTimer->start(error ? 5000 : 3000);
+}
 
-        // Let ALL text-input widgets handle their own keys
-        if (qobject_cast<QLineEdit*>(obj) || qobject_cast<QTextEdit*>(obj) || qobject_cast<QPlainTextEdit*>(obj) ||
-            qobject_cast<QSpinBox*>(obj) || qobject_cast<QDoubleSpinBox*>(obj) || qobject_cast<QComboBox*>(obj) ||
-            qobject_cast<QDateEdit*>(obj)) {
-            return QWidget::eventFilter(obj, event);
-        }
+void POSWidget::loadQuickPicks() {
+    // One indexed query; the buttons are reused, only their labels and state change
+    m_quickPicks = Database::instance().getMostCommonProducts(kQuickPickCount);
 
-        QString ch = ke->text();
+    QList<int> ids;
+    for (const auto& p : m_quickPicks) {
+        ids.append(p.id);
+    }
+    m_quickPickScores = Database::instance().getPopularityScores(ids);
+
+    for (int i = 0; i < m_quickPickButtons.size(); ++i) {
+        setQuickPickButton(i);
+    }
+}
 
-        if (ke->key() == Qt::Key_Return || ke->key() == Qt::Key_Enter) {
-            if (!m_barcodeBuffer.isEmpty()) {
-                m_barcodeEdit->setText(m_barcodeBuffer);
-                m_barcodeBuffer.clear();
-                m_barcodeTimer->stop();
-                onBarcodeEntered();
-                return true;
+void POSWidget::updateQuickPicks(const QList<int>& productIds) {
+    // A sale only raises scores, so the grid changes only if a changed pick moves up past its neighbours or a
+    // changed product outscores the last pick. Both are decided from the changed products' scores alone;
+    // anything else (a cancelled sale, a deleted pick, a grid still filling up) reads the index again.
+    const QHash<int, double> scores = Database::instance().getPopularityScores(productIds);
+    const bool full = m_quickPicks.size() == kQuickPickCount && m_quickPickScores.size() == m_quickPicks.size();
+    double lowest = 0;
+    for (auto it = m_quickPickScores.cbegin(); it != m_quickPickScores.cend(); ++it) {
+        lowest = it == m_quickPickScores.cbegin() ? it.value() : std::min(lowest, it.value());
+    }
+
+    QList<int> changedPicks;
+    for (int id : productIds) {
+        if (m_quickPickScores.contains(id)) {
+            if (!scores.contains(id) || scores[id] < m_quickPickScores[id]) {
+                loadQuickPicks();
+                return;
             }
-            return false;
+            changedPicks.append(id);
+        } else if (scores.contains(id) && (!full || scores[id] > lowest)) {
+            loadQuickPicks();
+            return;
         }
+    }
+    if (changedPicks.isEmpty()) {
+        return;
+    }
 
-        if (!ch.isEmpty() && ch[0].isPrint()) {
-            m_barcodeBuffer += ch;
-            m_barcodeTimer->start();
-            return true;
+    // Re-read the changed picks, re-rank in place and relabel only the buttons whose product moved or changed
+    const QList<Product> before = m_quickPicks;
+    for (auto& p : m_quickPicks) {
+        if (changedPicks.contains(p.id)) {
+            const Product fresh = Database::instance().getProductById(p.id);
+            if (fresh.id == 0) {
+                loadQuickPicks();
+                return;
+            }
+            p = fresh;
+            m_quickPickScores[p.id] = scores[p.id];
+        }
+    }
+    std::stable_sort(m_quickPicks.begin(), m_quickPicks.end(), [this](const Product& a, const Product& b) {
+        return m_quickPickScores[a.id] > m_quickPickScores[b.id];
+    });
+    for (int i = 0; i < m_quickPicks.size(); ++i) {
+        if (m_quickPicks[i].id != before[i].id || changedPicks.contains(m_quickPicks[i].id)) {
+            setQuickPickButton(i);
         }
     }
-    return QWidget::eventFilter(obj, event);
 }
 
-void POSWidget::onBarcodeEntered() {
-    QString barcode = m_barcodeEdit->text().trimmed();
-    if (barcode.isEmpty()) {
+void POSWidget::setQuickPickButton(int index) {
+    QPushButton* btn = m_quickPickButtons[index];
+    if (index >= m_quickPicks.size()) {
+        btn->hide();
+        return;
+    }
+    const Product& p = m_quickPicks[index];
+    QString name = btn->fontMetrics().elidedText(p.genericName, Qt::ElideRight, 120);
+    btn->setText(QString("%1\n%2").arg(name, formatCurrency(p.sellingPrice)));
+    btn->setToolTip(QString("%1 (%2)\n%3 in stock").arg(p.genericName, p.brandName).arg(p.quantity));
+    btn->setEnabled(p.quantity > 0);
+    btn->show();
+}
+
+void POSWidget::onQuickPick(int index) {
+    if (index < 0 || index >= m_quickPicks.size()) {
         return;
     }
+    addProductToQueue(m_quickPicks[index]);
+}
 
-    m_barcodeBuffer.clear();  // safety clear
-    Product p = Database::instance().getProductByBarcode(barcode);
+void POSWidget::onSearchChanged(const QString& text) { loadProducts(text); }
+
+void POSWidget::onBarcodeEntered() {
+    QString barcode = m_barcodeEdit->text().trimmed();
     m_barcodeEdit->clear();
+    if (!barcode.isEmpty()) {
+        onScanned(barcode);
+    }
+}
 
-    if (p.id == 0) {
-        QMessageBox::warning(this, "Not Found", "No product found with barcode: " + barcode);
+void POSWidget::onScanned(const QString& barcode) {
+    int id = m_barcodes.productId(barcode);
+    if (id == 0) {
+        showToast("No product found with barcode: " + barcode, true);
         return;
     }
+
+    // Repeat scans of a line already in the basket need nothing from the database
+    int row = m_basket->rowOf(id);
+    if (row >= 0) {
+        m_basket->setQuantity(row, m_basket->lines()[row].quantity + 1);
+        m_queueTable->scrollTo(m_basket->index(row, 0));
+        return;
+    }
+
+    Product p = Database::instance().getProductById(id);
     if (p.quantity == 0) {
-        QMessageBox::warning(this, "Out of Stock", QString("'%1' is out of stock!").arg(p.genericName));
+        showToast(QString("'%1' is out of stock!").arg(p.genericName), true);
         return;
     }
     addProductToQueue(p);
@@ -286,206 +497,203 @@ void POSWidget::onProductDoubleClicked(int row, int /*unused*/) {
     }
     const Product& p = m_currentProducts[row];
     if (p.quantity == 0) {
-        QMessageBox::warning(this, "Out of Stock", QString("'%1' is out of stock!").arg(p.genericName));
+        showToast(QString("'%1' is out of stock!").arg(p.genericName), true);
         return;
     }
     addProductToQueue(p);
 }
 
 void POSWidget::addProductToQueue(const Product& product) {
-    // Check if already in queue
-    for (int i = 0; i < m_queueTable->rowCount(); ++i) {
-        QTableWidgetItem* idItem = m_queueTable->item(i, 0);
-        if (!idItem) {
-            continue;
-        }
-        if (idItem->data(Qt::UserRole).toInt() == product.id) {
-            // Increment quantity
-            auto* qtyItem = m_queueTable->item(i, 3);
-            if (!qtyItem) {
-                return;
-            }
-            int currentQty = qtyItem->text().toInt();
-            if (currentQty >= product.quantity) {
-                QMessageBox::warning(this, "Insufficient Stock",
-                                     QString("Maximum available quantity is %1").arg(product.quantity));
-                return;
-            }
-            qtyItem->setText(QString::number(currentQty + 1));
-            return;
-        }
+    if (m_basket->add(product) == BasketModel::AddResult::AtLimit) {
+        showToast(QString("Maximum available quantity is %1").arg(product.quantity), true);
+        return;
     }
+    int row = m_basket->rowOf(product.id);
+    m_queueTable->scrollTo(m_basket->index(row, 0));
+}
 
-    // Add new row
-    int row = m_queueTable->rowCount();
-    m_queueTable->insertRow(row);
+void POSWidget::removeFromQueue(int row) { m_basket->removeLine(row); }
 
-    auto* nameItem = new QTableWidgetItem(product.genericName);
-    nameItem->setData(Qt::UserRole, product.id);
-    nameItem->setFlags(nameItem->flags() & ~static_cast<Qt::ItemFlags>(Qt::ItemIsEditable));
-    m_queueTable->setItem(row, 0, nameItem);
+void POSWidget::updateTotal() { m_totalLabel->setText(formatCurrency(m_basket->total())); }
 
-    auto* brandItem = new QTableWidgetItem(product.brandName);
-    brandItem->setFlags(brandItem->flags() & ~static_cast<Qt::ItemFlags>(Qt::ItemIsEditable));
-    m_queueTable->setItem(row, 1, brandItem);
+void POSWidget::clearQueue() {
+    if (m_basket->isEmpty()) {
+        return;
+    }
+    m_basket->clear();
+    showToast("Receipt cleared");
+}
 
-    auto* priceItem = new QTableWidgetItem(QString::number(product.sellingPrice, 'f', 2));
-    priceItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-    priceItem->setData(Qt::UserRole + 1, product.sellingPrice);
-    priceItem->setFlags(priceItem->flags() & ~static_cast<Qt::ItemFlags>(Qt::ItemIsEditable));
-    m_queueTable->setItem(row, 2, priceItem);
+QList<BasketLine> POSWidget::heldLines(const HeldBasket& basket) {
+    QList<BasketLine> lines;
+    QList<int> ids;
+    for (const auto& obj : basket.lines) {
+        lines << BasketLine::fromJson(obj);
+        ids << lines.last().productId;
+    }
 
-    auto* qtyItem = new QTableWidgetItem("1");
-    qtyItem->setTextAlignment(Qt::AlignCenter);
-    qtyItem->setData(Qt::UserRole + 2, product.quantity);  // store max qty
-    m_queueTable->setItem(row, 3, qtyItem);
-
-    auto* subtotalItem = new QTableWidgetItem(QString::number(product.sellingPrice, 'f', 2));
-    subtotalItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-    subtotalItem->setFlags(subtotalItem->flags() & ~static_cast<Qt::ItemFlags>(Qt::ItemIsEditable));
-    m_queueTable->setItem(row, 4, subtotalItem);
-
-    // Remove button
-    auto* removeBtn = new QPushButton("✕");
-    removeBtn->setObjectName("dangerBtn");
-    removeBtn->setFixedSize(28, 28);
-    removeBtn->setStyleSheet(
-        "QPushButton { background-color: #fc8181; color: white; border: none; "
-        "border-radius: 3px; font-size: 12px; font-weight: bold; padding: 0; }"
-        "QPushButton:hover { background-color: #e53e3e; }");
-    int r = row;
-    connect(removeBtn, &QPushButton::clicked, this, [this, r] { removeFromQueue(r); });
-    m_queueTable->setCellWidget(row, 5, removeBtn);
-
-    updateTotal();
+    // Stock may have moved while the basket was held; deleted products are dropped
+    QHash<int, int> quantities = Database::instance().getProductQuantities(ids);
+    QList<BasketLine> current;
+    for (auto line : lines) {
+        auto it = quantities.constFind(line.productId);
+        if (it == quantities.cend() || it.value() <= 0) {
+            continue;
+        }
+        line.maxQuantity = it.value();
+        line.quantity = std::min(line.quantity, line.maxQuantity);
+        current << line;
+    }
+    return current;
 }
 
-void POSWidget::removeFromQueue(int row) {
-    if (row < 0 || row >= m_queueTable->rowCount()) {
-        return;
+void POSWidget::restoreHeldBaskets() {
+    // Baskets still marked active for this cashier were on the till when the app last stopped. The newest
+    // goes back on the till; any others (a crash while a sale was being written) are parked for review.
+    auto& db = Database::instance();
+    QList<HeldBasket> open;
+    for (const auto& b : db.getHeldBaskets()) {
+        if (b.active && b.userId == m_currentUser.id) {
+            open << b;
+        }
     }
-    m_queueTable->removeRow(row);
-    // Reconnect remove buttons with updated row indices
-    for (int i = 0; i < m_queueTable->rowCount(); ++i) {
-        auto* btn = qobject_cast<QPushButton*>(m_queueTable->cellWidget(i, 5));
-        if (btn) {
-            btn->disconnect();
-            int r = i;
-            connect(btn, &QPushButton::clicked, this, [this, r] { removeFromQueue(r); });
+
+    for (int i = 0; i < open.size(); ++i) {
+        const HeldBasket& b = open[i];
+        if (b.lines.isEmpty()) {
+            db.deleteHeldBasket(b.id);
+        } else if (i < open.size() - 1) {
+            db.setHeldBasketActive(b.id, false, "Recovered");
+        } else {
+            m_journal->resume(b.id, heldLines(b));
         }
     }
-    updateTotal();
 }
 
-void POSWidget::updateQueueSubtotal(int row, int col) {
-    if (col != 3) {
-        return;  // Only quantity column
-    }
-    auto* qtyItem = m_queueTable->item(row, 3);
-    auto* priceItem = m_queueTable->item(row, 2);
-    auto* subtotalItem = m_queueTable->item(row, 4);
-    if (!qtyItem || !priceItem || !subtotalItem) {
+void POSWidget::parkBasket() {
+    if (m_basket->isEmpty()) {
+        showToast("Nothing to park.", true);
         return;
     }
 
-    int qty = qtyItem->text().toInt();
-    int maxQty = qtyItem->data(Qt::UserRole + 2).toInt();
-    qty = std::max(qty, 1);
-
-    if (qty > maxQty) {
-        qty = maxQty;
-        QMessageBox::warning(this, "Insufficient Stock", QString("Maximum available quantity is %1").arg(maxQty));
+    bool ok = false;
+    QString label = QInputDialog::getText(this, "Park Basket", "Customer / note:", QLineEdit::Normal,
+                                          QTime::currentTime().toString("HH:mm"), &ok);
+    if (!ok) {
+        return;
     }
-
-    // Block signals to avoid recursion
-    m_queueTable->blockSignals(true);
-    qtyItem->setText(QString::number(qty));
-    double price = priceItem->data(Qt::UserRole + 1).toDouble();
-    subtotalItem->setText(QString::number(price * qty, 'f', 2));
-    m_queueTable->blockSignals(false);
-
-    updateTotal();
+    if (!m_journal->park(label.trimmed())) {
+        showToast("Failed to park basket: " + Database::instance().lastError(), true);
+        return;
+    }
+    showToast("Basket parked");
 }
 
-double POSWidget::computeTotal() const {
-    double total = 0.0;
-    for (int i = 0; i < m_queueTable->rowCount(); ++i) {
-        auto* sub = m_queueTable->item(i, 4);
-        if (sub) {
-            total += sub->text().toDouble();
+void POSWidget::populateResumeMenu() {
+    m_resumeMenu->clear();
+    for (const auto& b : Database::instance().getHeldBaskets()) {
+        if (b.active || b.lines.isEmpty()) {
+            continue;
+        }
+        Money total;
+        for (const auto& obj : b.lines) {
+            total += BasketLine::fromJson(obj).subtotal();
         }
+        QString text = QString("%1 — %2 item(s), %3 (%4)")
+                           .arg(b.label.isEmpty() ? QString("#%1").arg(b.id) : b.label)
+                           .arg(b.lines.size())
+                           .arg(formatCurrency(total), b.updatedAt.toString("HH:mm"));
+        int id = b.id;
+        m_resumeMenu->addAction(text, this, [this, id] { resumeBasket(id); });
+    }
+    if (m_resumeMenu->isEmpty()) {
+        m_resumeMenu->addAction("No parked baskets")->setEnabled(false);
     }
-    return total;
 }
 
-void POSWidget::updateTotal() { m_totalLabel->setText(formatCurrency(computeTotal())); }
+void POSWidget::resumeBasket(int basketId) {
+    // Read again: another till may have resumed it since the menu was built
+    HeldBasket basket;
+    for (const auto& b : Database::instance().getHeldBaskets()) {
+        if (b.id == basketId) {
+            basket = b;
+        }
+    }
+    if (basket.id == 0 || basket.active) {
+        showToast("That basket is no longer parked.", true);
+        return;
+    }
 
-void POSWidget::clearQueue() {
-    if (m_queueTable->rowCount() == 0) {
+    if (!m_basket->isEmpty() && !m_journal->park(QTime::currentTime().toString("HH:mm"))) {
+        showToast("Failed to park the current basket: " + Database::instance().lastError(), true);
         return;
     }
-    auto ret = QMessageBox::question(this, "Clear Receipt", "Clear all items from the receipt?",
-                                     QMessageBox::Yes | QMessageBox::No);
-    if (ret == QMessageBox::Yes) {
-        m_queueTable->setRowCount(0);
-        updateTotal();
+    if (!m_journal->resume(basket.id, heldLines(basket))) {
+        showToast("Failed to resume basket: " + Database::instance().lastError(), true);
+        return;
     }
+    showToast(QString("Resumed %1").arg(basket.label.isEmpty() ? QString("#%1").arg(basket.id) : basket.label));
 }
 
 void POSWidget::saveTransaction() {
-    if (m_queueTable->rowCount() == 0) {
-        QMessageBox::warning(this, "Empty Receipt", "No items in the sales receipt.");
+    if (m_basket->isEmpty()) {
+        showToast("No items in the sales receipt.", true);
         return;
     }
 
+    // Lines carry the price, cost and barcode captured when they were added, so no lookups are needed here
+    QList<BasketLine> lines = m_basket->lines();
     Transaction t;
     t.userId = m_currentUser.id;
     t.createdAt = QDateTime::currentDateTime();
+    t.items.reserve(lines.size());
+    for (const auto& line : lines) {
+        t.items.append(line.toTransactionItem());
+    }
 
-    for (int i = 0; i < m_queueTable->rowCount(); ++i) {
-        auto* nameItem = m_queueTable->item(i, 0);
-        auto* brandItem = m_queueTable->item(i, 1);
-        auto* priceItem = m_queueTable->item(i, 2);
-        auto* qtyItem = m_queueTable->item(i, 3);
-        if (!nameItem || !qtyItem || !priceItem) {
-            continue;
-        }
-
-        int qty = qtyItem->text().toInt();
-        if (qty <= 0) {
-            continue;
-        }
-
-        TransactionItem item;
-        item.productId = nameItem->data(Qt::UserRole).toInt();
-        item.genericName = nameItem->text();
-        item.brandName = brandItem ? brandItem->text() : QString();
-        item.sellingPrice = priceItem->data(Qt::UserRole + 1).toDouble();
-        item.quantity = qty;
-
-        // Get cost price from DB
-        Product p = Database::instance().getProductById(item.productId);
-        item.costPrice = p.costPrice;
-        item.barcode = p.barcode;
+    // The till is handed back empty right away; the write goes through the write queue with whatever else is
+    // being written at the moment. The journaled basket is dropped in the same transaction as the sale, so a
+    // crash in between still finds it on restart.
+    int heldBasketId = m_journal->detach();
+    m_basket->clear();
+    commitSale(t, lines, heldBasketId);
+}
 
-        t.items.append(item);
-    }
+void POSWidget::commitSale(Transaction t, const QList<BasketLine>& lines, int heldBasketId) {
+    auto sale = std::make_shared<Transaction>(std::move(t));
+    QPointer<POSWidget> self(this);
+    WriteQueue::instance().enqueue(
+        [sale, heldBasketId] {
+            auto& db = Database::instance();
+            return db.createTransaction(*sale) && (heldBasketId == 0 || db.deleteHeldBasket(heldBasketId));
+        },
+        [self, sale, lines, heldBasketId](bool ok, const QString& error) {
+            if (!self) {
+                return;  // the held basket, if any, is restored at the next login
+            }
+            self->saleCommitted(*sale, lines, heldBasketId, ok, error);
+        });
+}
 
-    if (t.items.isEmpty()) {
-        QMessageBox::warning(this, "Error", "No valid items to save.");
+void POSWidget::saleCommitted(const Transaction& t, const QList<BasketLine>& lines, int heldBasketId, bool ok,
+                              const QString& error) {
+    if (!ok) {
+        // Put the basket back in front of the cashier so nothing has to be rescanned; it is journaled
+        // again as part of the current basket
+        m_basket->setLines(lines + m_basket->lines());
+        if (heldBasketId != 0 && !Database::instance().deleteHeldBasket(heldBasketId)) {
+            qWarning() << "Could not drop held basket" << heldBasketId << ":" << Database::instance().lastError();
+        }
+        showToast("Failed to save transaction: " + error, true);
         return;
     }
 
-    if (!Database::instance().createTransaction(t)) {
-        QMessageBox::critical(this, "Error", "Failed to save transaction:\n" + Database::instance().lastError());
-        return;
+    Money total;
+    for (const auto& line : lines) {
+        total += line.subtotal();
+    }
+    showToast(QString("Sale #%1 saved — %2").arg(t.id).arg(formatCurrency(total)));
+    if (m_printCheck->isChecked()) {
+        m_receiptPrinter->enqueue(t);
     }
-
-    double total = computeTotal();
-    m_queueTable->setRowCount(0);
-    updateTotal();
-    loadProducts(m_searchEdit->text());
-
-    QMessageBox::information(this, "Success",
-                             QString("Transaction saved successfully!\nTotal: %1").arg(formatCurrency(total)));
 }
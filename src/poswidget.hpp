@@ -1,27 +1,41 @@
 #pragma once
 
+#include <QGridLayout>
+#include <QHash>
 #include <QLabel>
 #include <QLineEdit>
 #include <QList>
 #include <QPushButton>
+#include <QTableView>
 #include <QTableWidget>
 #include <QWidget>
+#include "barcodescanner.hpp"
+#include "basketjournal.hpp"
+#include "basketmodel.hpp"
 #include "models.hpp"
 
+class QCheckBox;
+class QMenu;
+class ReceiptPrinter;
+
 class POSWidget : public QWidget {
     Q_OBJECT
   public:
     explicit POSWidget(User user, QWidget* parent = nullptr);
+    ~POSWidget() override;
 
   private slots:
     void onBarcodeEntered();
+    void onScanned(const QString& barcode);
     void onSearchChanged(const QString& text);
     void addProductToQueue(const Product& product);
     void removeFromQueue(int row);
     void saveTransaction();
     void clearQueue();
     void onProductDoubleClicked(int row, int col);
-    void updateQueueSubtotal(int row, int col);
+    void onQuickPick(int index);
+    void parkBasket();
+    void resumeBasket(int basketId);
 
   private:
     User m_currentUser;
@@ -31,23 +45,54 @@ class POSWidget : public QWidget {
     QLineEdit* m_searchEdit;
     QLineEdit* m_barcodeEdit;
 
+    // Quick picks: a fixed pool of buttons relabelled from the popularity index after every sale
+    QGridLayout* m_quickPickGrid;
+    QList<QPushButton*> m_quickPickButtons;
+    QList<Product> m_quickPicks;
+    QHash<int, double> m_quickPickScores;  // product id -> popularity score, for every pick that has one
+    int m_changeListenerId = 0;
+
     // Right panel - receipt/queue
-    QTableWidget* m_queueTable;
+    QTableView* m_queueTable;
+    BasketModel* m_basket;
     QLabel* m_totalLabel;
     QPushButton* m_saveBtn;
     QPushButton* m_clearBtn;
+    QCheckBox* m_printCheck;
+
+    // Parking: the basket is journaled as it changes, so parked and crashed baskets come back intact
+    BasketJournal* m_journal;
+    QPushButton* m_parkBtn;
+    QPushButton* m_resumeBtn;
+    QMenu* m_resumeMenu;
+
+    // Non-modal feedback that fades by itself, so the till never waits on a dialog
+    QLabel* m_toast;
+    QTimer* m_toastTimer;
+    ReceiptPrinter* m_receiptPrinter;
 
     QList<Product> m_currentProducts;
-    QList<TransactionItem> m_queueItems;
 
-    QTimer* m_barcodeTimer;
-    QString m_barcodeBuffer;
+    BarcodeScanner* m_scanner;
+    BarcodeIndex m_barcodes;
 
-    bool eventFilter(QObject* obj, QEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
     void setupUi();
     void loadProducts(const QString& filter = QString());
+    void loadQuickPicks();
+    void updateQuickPicks(const QList<int>& productIds);
+    void setQuickPickButton(int index);
+    void setProductRow(int row, const Product& p);
+    void updateProductRows(const QList<int>& productIds);
+    void restoreHeldBaskets();
+    void populateResumeMenu();
+    QList<BasketLine> heldLines(const HeldBasket& basket);
+    void commitSale(Transaction t, const QList<BasketLine>& lines, int heldBasketId);
+    void saleCommitted(const Transaction& t, const QList<BasketLine>& lines, int heldBasketId, bool ok,
+                       const QString& error);
+    void showToast(const QString& text, bool error = false);
     void updateTotal();
-    [[nodiscard]] double computeTotal() const;
 
-    static QString formatCurrency(double val) { return QString("UGX %L1").arg(val, 0, 'f', 2); }
+    static QString formatCurrency(Money val) { return QString("UGX %L1").arg(val.toDouble(), 0, 'f', 2); }
 };
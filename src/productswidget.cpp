@@ -7,9 +7,11 @@
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QMessageBox>
+#include <QPointer>
 #include <QTextStream>
 #include <QVBoxLayout>
 #include "database.hpp"
+#include "writequeue.hpp"
 
 // =================== Product Dialog ===================
 
@@ -45,14 +47,14 @@ ProductDialog::ProductDialog(QWidget* parent, const Product& product) : QDialog(
     m_costPrice = new QDoubleSpinBox;
     m_costPrice->setRange(0, 9999999);
     m_costPrice->setDecimals(2);
-    m_costPrice->setValue(product.costPrice);
+    m_costPrice->setValue(product.costPrice.toDouble());
     m_costPrice->setPrefix("UGX ");
     form->addRow("Cost Price:", m_costPrice);
 
     m_sellingPrice = new QDoubleSpinBox;
     m_sellingPrice->setRange(0, 9999999);
     m_sellingPrice->setDecimals(2);
-    m_sellingPrice->setValue(product.sellingPrice);
+    m_sellingPrice->setValue(product.sellingPrice.toDouble());
     m_sellingPrice->setPrefix("UGX ");
     form->addRow("Selling Price:", m_sellingPrice);
 
@@ -96,8 +98,8 @@ Product ProductDialog::getProduct() const {
     p.genericName = m_genericName->text().trimmed();
     p.brandName = m_brandName->text().trimmed();
     p.quantity = m_quantity->value();
-    p.costPrice = m_costPrice->value();
-    p.sellingPrice = m_sellingPrice->value();
+    p.costPrice = Money::fromDouble(m_costPrice->value());
+    p.sellingPrice = Money::fromDouble(m_sellingPrice->value());
     p.barcode = m_barcode->text().trimmed();
 
     for (const QString& ds : m_expiryDates->text().split(",", Qt::SkipEmptyParts)) {
@@ -114,8 +116,17 @@ Product ProductDialog::getProduct() const {
 ProductsWidget::ProductsWidget(const User& user, QWidget* parent) : QWidget(parent), m_currentUser(user) {
     setupUi();
     refresh();
+    m_changeListenerId = Database::instance().addChangeListener([this](const Database::DataChange& change) {
+        if (change.unknown) {
+            refresh();
+        } else if (!change.products.isEmpty()) {
+            updateRows(change.products);
+        }
+    });
 }
 
+ProductsWidget::~ProductsWidget() { Database::instance().removeChangeListener(m_changeListenerId); }
+
 void ProductsWidget::setupUi() {
     auto* root = new QVBoxLayout(this);
     root->setContentsMargins(16, 16, 16, 16);
@@ -229,6 +240,35 @@ void ProductsWidget::loadPage() {
     m_countLabel->setText(QString("Total: %1 products").arg(m_totalCount));
 }
 
+// Repaints the rows of `productIds` on this page. A product that is gone, or one that is new and may belong on
+// this page, reloads it instead, since the rows after it move.
+void ProductsWidget::updateRows(const QList<int>& productIds) {
+    QHash<int, int> rows;
+    for (int row = 0; row < m_table->rowCount(); ++row) {
+        if (auto* item = m_table->item(row, 0)) {
+            rows.insert(item->data(Qt::UserRole).toInt(), row);
+        }
+    }
+    bool elsewhere = false;
+    for (int id : productIds) {
+        auto it = rows.constFind(id);
+        if (it == rows.cend()) {
+            elsewhere = true;
+            continue;
+        }
+        const Product p = Database::instance().getProductById(id);
+        if (p.id == 0) {
+            refresh();
+            return;
+        }
+        setRow(it.value(), p);
+    }
+    // Stock moving on another page changes nothing here; a product added or deleted changes the count
+    if (elsewhere && Database::instance().countProducts() != m_totalCount) {
+        refresh();
+    }
+}
+
 void ProductsWidget::setRow(int row, const Product& p) {
     auto center = [](const QString& s) {
         auto* item = new QTableWidgetItem(s);
@@ -254,8 +294,8 @@ void ProductsWidget::setRow(int row, const Product& p) {
     }
     m_table->setItem(row, 3, qtyItem);
 
-    m_table->setItem(row, 4, new QTableWidgetItem(QString::number(p.costPrice, 'f', 2)));
-    m_table->setItem(row, 5, new QTableWidgetItem(QString::number(p.sellingPrice, 'f', 2)));
+    m_table->setItem(row, 4, new QTableWidgetItem(QString::number(p.costPrice.toDouble(), 'f', 2)));
+    m_table->setItem(row, 5, new QTableWidgetItem(QString::number(p.sellingPrice.toDouble(), 'f', 2)));
     m_table->setItem(row, 6, new QTableWidgetItem(p.barcode));
 
     QStringList dates;
@@ -296,12 +336,7 @@ void ProductsWidget::setRow(int row, const Product& p) {
         Product p = Database::instance().getProductById(pid);
         ProductDialog dlg(this, p);
         if (dlg.exec() == QDialog::Accepted) {
-            Product updated = dlg.getProduct();
-            if (!Database::instance().updateProduct(updated)) {
-                QMessageBox::critical(this, "Error", Database::instance().lastError());
-            } else {
-                refresh();
-            }
+            saveProduct(dlg.getProduct());
         }
     });
     connect(delBtn, &QPushButton::clicked, this, [this, pid] {
@@ -310,8 +345,6 @@ void ProductsWidget::setRow(int row, const Product& p) {
         if (ret == QMessageBox::Yes) {
             if (!Database::instance().deleteProduct(pid)) {
                 QMessageBox::critical(this, "Error", Database::instance().lastError());
-            } else {
-                refresh();
             }
         }
     });
@@ -336,12 +369,7 @@ int ProductsWidget::selectedId() const {
 void ProductsWidget::onAdd() {
     ProductDialog dlg(this);
     if (dlg.exec() == QDialog::Accepted) {
-        Product p = dlg.getProduct();
-        if (!Database::instance().createProduct(p)) {
-            QMessageBox::critical(this, "Error", Database::instance().lastError());
-        } else {
-            refresh();
-        }
+        saveProduct(dlg.getProduct());
     }
 }
 
@@ -354,15 +382,25 @@ void ProductsWidget::onEdit() {
     Product p = Database::instance().getProductById(id);
     ProductDialog dlg(this, p);
     if (dlg.exec() == QDialog::Accepted) {
-        Product updated = dlg.getProduct();
-        if (!Database::instance().updateProduct(updated)) {
-            QMessageBox::critical(this, "Error", Database::instance().lastError());
-        } else {
-            refresh();
-        }
+        saveProduct(dlg.getProduct());
     }
 }
 
+// Creates or updates `p` through the write queue, so an edit made while sales are coming in commits with them.
+// The table follows from the change notification.
+void ProductsWidget::saveProduct(const Product& p) {
+    QPointer<ProductsWidget> self(this);
+    WriteQueue::instance().enqueue(
+        [p] {
+            return p.id > 0 ? Database::instance().updateProduct(p) : Database::instance().createProduct(p);
+        },
+        [self](bool ok, const QString& error) {
+            if (self && !ok) {
+                QMessageBox::critical(self, "Error", error);
+            }
+        });
+}
+
 void ProductsWidget::onDelete() {
     int id = selectedId();
     if (id < 0) {
@@ -374,8 +412,6 @@ void ProductsWidget::onDelete() {
     if (ret == QMessageBox::Yes) {
         if (!Database::instance().deleteProduct(id)) {
             QMessageBox::critical(this, "Error", Database::instance().lastError());
-        } else {
-            refresh();
         }
     }
 }
@@ -423,8 +459,8 @@ void ProductsWidget::onImport() {
                 p.expiryDates.append(d);
             }
         }
-        p.costPrice = parts[4].trimmed().replace(",", "").toDouble();
-        p.sellingPrice = parts[5].trimmed().replace(",", "").toDouble();
+        p.costPrice = Money::fromDouble(parts[4].trimmed().replace(",", "").toDouble());
+        p.sellingPrice = Money::fromDouble(parts[5].trimmed().replace(",", "").toDouble());
         p.barcode = parts[6].trimmed();
         products.append(p);
     }
@@ -440,7 +476,6 @@ void ProductsWidget::onImport() {
     } else {
         QMessageBox::information(this, "Import Success",
                                  QString("Successfully imported %1 products.").arg(products.size()));
-        refresh();
     }
 }
 
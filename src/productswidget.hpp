@@ -33,6 +33,7 @@ class ProductsWidget : public QWidget {
     Q_OBJECT
   public:
     explicit ProductsWidget(const User& user, QWidget* parent = nullptr);
+    ~ProductsWidget() override;
     void refresh();
 
   private slots:
@@ -57,9 +58,12 @@ class ProductsWidget : public QWidget {
     int m_pageSize = 50;
     int m_totalCount = 0;
     QString m_searchFilter;
+    int m_changeListenerId = 0;
 
     void setupUi();
     void loadPage();
+    void updateRows(const QList<int>& productIds);
     void setRow(int row, const Product& p);
+    void saveProduct(const Product& p);
     [[nodiscard]] int selectedId() const;
 };
@@ -0,0 +1,296 @@
+#include "receipt.hpp"
+#include <QFile>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QImage>
+#include <QPainter>
+#include <QPrinter>
+#include <QThread>
+#include <QTimer>
+#include <QtMath>
+#include <algorithm>
+#include "database.hpp"
+#include "escpos.hpp"
+
+// Resolution receipts for a system printer are painted at; plenty for thermal paper
+static constexpr qreal kReceiptImageDpi = 300.0;
+
+QPageLayout receiptPageLayout() {
+    // Default to receipt paper: 80mm wide (most common thermal receipt printer)
+    // 80mm = ~226 points (1 pt = 1/72 inch, 80mm / 25.4 * 72 ≈ 227)
+    // Height is set long enough; printer will cut at end of content.
+    return QPageLayout(QPageSize(QSizeF(80, 297), QPageSize::Millimeter), QPageLayout::Portrait,
+                       QMarginsF(4, 4, 4, 4), QPageLayout::Millimeter);
+}
+
+void setupReceiptPrinter(QPrinter& printer) {
+    printer.setPageLayout(receiptPageLayout());
+    printer.setFullPage(false);
+    printer.setColorMode(QPrinter::GrayScale);
+}
+
+qreal paintReceipt(QPainter& p, const QRectF& pageRect, qreal dpi, const Transaction& t) {
+    // ---- Coordinate system ----
+    // Work in device dots across the usable width of the page.
+    const qreal W = pageRect.width();
+    const qreal mm = dpi / 25.4;  // 1mm in dots
+
+    // Fonts scaled for receipt printer
+    QFont fTitle("Courier New", -1, QFont::Bold);
+    fTitle.setPixelSize(qRound(4.0 * mm));  // ~4mm tall
+
+    QFont fHeader("Courier New", -1, QFont::Bold);
+    fHeader.setPixelSize(qRound(3.2 * mm));
+
+    QFont fNormal("Courier New");
+    fNormal.setPixelSize(qRound(3.0 * mm));
+
+    QFont fSmall("Courier New");
+    fSmall.setPixelSize(qRound(2.5 * mm));
+
+    QFont fTotal("Courier New", -1, QFont::Bold);
+    fTotal.setPixelSize(qRound(4.5 * mm));
+
+    const qreal lineH = 3.6 * mm;    // normal line height
+    const qreal lineHS = 2.9 * mm;   // small line height
+    const qreal dotLine = 0.3 * mm;  // divider thickness
+
+    qreal y = 0;
+
+    auto drawHRule = [&](bool bold = false) {
+        p.setPen(QPen(Qt::black, bold ? dotLine * 2 : dotLine));
+        p.drawLine(QPointF(0, y), QPointF(W, y));
+        y += 1.5 * mm;
+    };
+
+    auto drawCentered = [&](const QString& text, const QFont& font, qreal h) {
+        p.setFont(font);
+        p.setPen(Qt::black);
+        p.drawText(QRectF(0, y, W, h), Qt::AlignHCenter | Qt::AlignVCenter, text);
+        y += h;
+    };
+
+    auto drawRow = [&](const QString& left, const QString& right, const QFont& font, qreal h) {
+        p.setFont(font);
+        p.setPen(Qt::black);
+        p.drawText(QRectF(0, y, W * 0.65, h), Qt::AlignLeft | Qt::AlignVCenter, left);
+        p.drawText(QRectF(0, y, W, h), Qt::AlignRight | Qt::AlignVCenter, right);
+        y += h;
+    };
+
+    // ---- Header ----
+    y += 2 * mm;
+    drawCentered("Tella POS", fTitle, 5 * mm);
+    drawCentered("Sales Receipt", fNormal, lineH);
+    y += 1.5 * mm;
+    drawHRule(true);
+
+    // ---- Meta ----
+    drawRow("Date:", t.createdAt.toString("dd/MM/yyyy hh:mm"), fSmall, lineHS);
+    drawRow("Ref #:", QString::number(t.id), fSmall, lineHS);
+    y += 1 * mm;
+    drawHRule();
+
+    // ---- Column headers ----
+    p.setFont(fHeader);
+    p.setPen(Qt::black);
+    p.drawText(QRectF(0, y, W * 0.55, lineH), Qt::AlignLeft | Qt::AlignVCenter, "Item");
+    p.drawText(QRectF(W * 0.55, y, W * 0.13, lineH), Qt::AlignRight | Qt::AlignVCenter, "Qty");
+    p.drawText(QRectF(W * 0.68, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter, "Price");
+    p.drawText(QRectF(W * 0.84, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter, "Sub");
+    y += lineH;
+    drawHRule();
+
+    // ---- Items ----
+    Money grandTotal;
+    for (const auto& item : t.items) {
+        const Money sub = item.subtotal();
+        grandTotal += sub;
+
+        // Product name — may need to wrap on narrow paper
+        QString name = item.genericName;
+        if (!item.brandName.isEmpty()) {
+            name += " (" + item.brandName + ")";
+        }
+
+        // Measure name width; wrap if too wide
+        QFontMetricsF fm(fNormal);
+        const qreal maxNameW = W * 0.54;
+        if (fm.horizontalAdvance(name) > maxNameW) {
+            // Try generic name alone first
+            if (fm.horizontalAdvance(item.genericName) <= maxNameW) {
+                name = item.genericName;
+            } else {
+                // Elide
+                name = fm.elidedText(item.genericName, Qt::ElideRight, static_cast<int>(maxNameW));
+            }
+        }
+
+        p.setFont(fNormal);
+        p.setPen(Qt::black);
+        p.drawText(QRectF(0, y, W * 0.55, lineH), Qt::AlignLeft | Qt::AlignVCenter, name);
+        p.drawText(QRectF(W * 0.55, y, W * 0.13, lineH), Qt::AlignRight | Qt::AlignVCenter,
+                   QString::number(item.quantity));
+        p.drawText(QRectF(W * 0.68, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter,
+                   QString::number(item.sellingPrice.toDouble(), 'f', 0));
+        p.drawText(QRectF(W * 0.84, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter,
+                   QString::number(sub.toDouble(), 'f', 0));
+        y += lineH;
+    }
+
+    // ---- Total ----
+    y += 1 * mm;
+    drawHRule(true);
+    drawRow("TOTAL (UGX)", QString::number(grandTotal.toDouble(), 'f', 2), fTotal, 5.5 * mm);
+    drawHRule(true);
+
+    // ---- Footer ----
+    y += 2 * mm;
+    drawCentered("Thank you for your purchase!", fSmall, lineHS);
+    drawCentered("Tella POS — Serving you better", fSmall, lineHS);
+    y += 3 * mm;
+    return y;
+}
+
+QImage receiptImage(const Transaction& t, int widthDots, qreal dpi) {
+    // Paint onto a page long enough for the items, then keep what was used
+    const int pageHeight = qCeil((60.0 + 3.6 * static_cast<qreal>(t.items.size())) * dpi / 25.4);
+    QImage page(widthDots, pageHeight, QImage::Format_Grayscale8);
+    page.fill(Qt::white);
+    QPainter p(&page);
+    const int height = std::min(qCeil(paintReceipt(p, QRectF(0, 0, widthDots, pageHeight), dpi, t)), pageHeight);
+    p.end();
+    return page.copy(0, 0, widthDots, height);
+}
+
+QByteArray receiptEscPos(const Transaction& t, bool raster) {
+    if (!raster) {
+        return escPosReceipt(t);
+    }
+
+    // Painted at the printer's own resolution
+    const QImage page = receiptImage(t, kReceiptDots, 203.0);
+    const int height = page.height();
+
+    const int widthBytes = kReceiptDots / 8;
+    QByteArray bits(static_cast<qsizetype>(widthBytes) * height, '\0');
+    for (int y = 0; y < height; ++y) {
+        const uchar* line = page.constScanLine(y);
+        char* out = bits.data() + static_cast<qsizetype>(y) * widthBytes;
+        for (int x = 0; x < kReceiptDots; ++x) {
+            if (line[x] < 128) {
+                out[x / 8] = static_cast<char>(out[x / 8] | (0x80 >> (x % 8)));
+            }
+        }
+    }
+    return escPosRaster(bits, widthBytes, height);
+}
+
+// =================== ReceiptPrinter ===================
+
+ReceiptPrinter::ReceiptPrinter(QObject* parent) : QObject(parent) {}
+
+ReceiptPrinter::~ReceiptPrinter() {
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool ReceiptPrinter::usesDevice() { return !Database::instance().setting("receipt_device").isEmpty(); }
+
+void ReceiptPrinter::enqueue(const Transaction& t) {
+    m_queue.enqueue(t);
+    schedule();
+}
+
+void ReceiptPrinter::schedule() {
+    if (m_scheduled || m_thread || m_queue.isEmpty()) {
+        return;
+    }
+    m_scheduled = true;
+    QTimer::singleShot(0, this, &ReceiptPrinter::printNext);
+}
+
+void ReceiptPrinter::printNext() {
+    m_scheduled = false;
+    if (m_queue.isEmpty()) {
+        return;
+    }
+    Transaction t = m_queue.dequeue();
+
+    QString device = Database::instance().setting("receipt_device");
+    if (!device.isEmpty()) {
+        writeToDevice(t, device, Database::instance().setting("receipt_raster", "0") == "1");
+        return;
+    }
+
+    printToPrinter(t);
+}
+
+void ReceiptPrinter::printToPrinter(const Transaction& t) {
+    // Laying out the text is the slow part, so it happens on the worker; the till only waits for the page to be
+    // handed over
+    m_thread = QThread::create([this, t] {
+        const qreal widthMm = receiptPageLayout().paintRect(QPageLayout::Millimeter).width();
+        QImage page = receiptImage(t, qRound(widthMm * kReceiptImageDpi / 25.4), kReceiptImageDpi);
+
+        int id = t.id;
+        QMetaObject::invokeMethod(
+            this,
+            [this, id, page] {
+                m_thread = nullptr;  // deleted via QThread::finished
+                printPage(id, page);
+                schedule();
+            },
+            Qt::QueuedConnection);
+    });
+    connect(m_thread, &QThread::finished, m_thread, &QObject::deleteLater);
+    m_thread->start(QThread::LowPriority);
+}
+
+void ReceiptPrinter::printPage(int transactionId, const QImage& page) {
+    QPrinter printer(QPrinter::HighResolution);
+    setupReceiptPrinter(printer);
+    QString name = Database::instance().setting("receipt_printer");
+    if (!name.isEmpty()) {
+        printer.setPrinterName(name);
+    }
+
+    QPainter p;
+    if (!printer.isValid() || !p.begin(&printer)) {
+        emit failed(transactionId, QString("Could not open printer %1").arg(printer.printerName()));
+        return;
+    }
+    // Scaled from the image's resolution to the printer's, from the top left of the printable area
+    const qreal scale = printer.resolution() / kReceiptImageDpi;
+    p.drawImage(QRectF(0, 0, page.width() * scale, page.height() * scale), page);
+    p.end();
+}
+
+void ReceiptPrinter::writeToDevice(const Transaction& t, const QString& device, bool raster) {
+    m_thread = QThread::create([this, t, device, raster] {
+        QByteArray bytes = receiptEscPos(t, raster);
+        QString error;
+        QFile out(device);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            error = QString("Could not open %1: %2").arg(device, out.errorString());
+        } else if (out.write(bytes) != bytes.size() || !out.flush()) {
+            error = QString("Could not write to %1: %2").arg(device, out.errorString());
+        }
+
+        int id = t.id;
+        QMetaObject::invokeMethod(
+            this,
+            [this, id, error] {
+                m_thread = nullptr;  // deleted via QThread::finished
+                if (!error.isEmpty()) {
+                    emit failed(id, error);
+                }
+                schedule();
+            },
+            Qt::QueuedConnection);
+    });
+    connect(m_thread, &QThread::finished, m_thread, &QObject::deleteLater);
+    m_thread->start(QThread::LowPriority);
+}
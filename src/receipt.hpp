@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QObject>
+#include <QPageLayout>
+#include <QQueue>
+#include <QRectF>
+#include "models.hpp"
+
+class QPainter;
+class QPrinter;
+class QThread;
+
+// 80 mm thermal receipt paper; a value, so it can be used off the GUI thread.
+QPageLayout receiptPageLayout();
+// Sets up a QPrinter for 80 mm thermal receipt paper.
+void setupReceiptPrinter(QPrinter& printer);
+
+// Lays out a receipt on an active painter. `pageRect` is the printable area and `dpi` the resolution, both in
+// device dots. Returns the height used.
+qreal paintReceipt(QPainter& p, const QRectF& pageRect, qreal dpi, const Transaction& t);
+
+// The receipt painted onto a white grayscale image `widthDots` wide at `dpi`, cut to the height used.
+// Safe on worker threads.
+QImage receiptImage(const Transaction& t, int widthDots, qreal dpi);
+
+// ESC/POS bytes for `t`: printer text, or with `raster` the painted receipt as a 203 dpi bitmap.
+// Safe on worker threads.
+QByteArray receiptEscPos(const Transaction& t, bool raster);
+
+// Prints receipts without a dialog, in order, so a sale never waits for the previous receipt.
+//
+// With a `receipt_device` setting (a raw printer device such as /dev/usb/lp0, or any file) receipts are
+// rendered to ESC/POS on a worker thread and appended to it; `receipt_raster` = "1" sends them as bitmaps.
+// Without one they are painted to an image on a worker thread, and only the finished page is handed to the
+// `receipt_printer` system printer (or the default) on the GUI thread.
+class ReceiptPrinter : public QObject {
+    Q_OBJECT
+  public:
+    explicit ReceiptPrinter(QObject* parent = nullptr);
+    ~ReceiptPrinter() override;
+
+    void enqueue(const Transaction& t);
+    [[nodiscard]] int pending() const { return static_cast<int>(m_queue.size()) + (m_thread ? 1 : 0); }
+
+    // True when receipts go to an ESC/POS device instead of a system printer.
+    static bool usesDevice();
+
+  signals:
+    void failed(int transactionId, const QString& message);
+
+  private:
+    QQueue<Transaction> m_queue;
+    bool m_scheduled = false;
+    QThread* m_thread = nullptr;  // writing a receipt to the device
+
+    void schedule();
+    void printNext();
+    void writeToDevice(const Transaction& t, const QString& device, bool raster);
+    void printToPrinter(const Transaction& t);
+    void printPage(int transactionId, const QImage& page);
+};
@@ -1,7 +1,11 @@
 #include "reportswidget.hpp"
+#include <QCheckBox>
 #include <QDateTime>
 #include <QDialog>
 #include <QDialogButtonBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QFont>
 #include <QGroupBox>
 #include <QHBoxLayout>
@@ -11,6 +15,7 @@
 #include <QPainter>
 #include <QPrintDialog>
 #include <QPrinter>
+#include <QProgressDialog>
 #include <QScrollArea>
 #include <QVBoxLayout>
 #include <QtCharts/QBarCategoryAxis>
@@ -21,10 +26,38 @@
 #include <QtCharts/QHorizontalBarSeries>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QPieSeries>
+#include <QtCharts/QStackedBarSeries>
 #include <QtCharts/QValueAxis>
+#include <algorithm>
+#include "chartdata.hpp"
 #include "database.hpp"
+#include "exporters.hpp"
+#include "salesstore.hpp"
 
-static QString fmtCurrency(double v) { return QString("UGX %L1").arg(v, 0, 'f', 2); }
+static QString fmtCurrency(Money v) { return QString("UGX %L1").arg(v.toDouble(), 0, 'f', 2); }
+
+// Sales figures come from the in-memory column store when `analytics_engine` is "columnar", else from SQL.
+// Both give the same rows.
+static bool useSalesStore() {
+    return Database::instance().setting("analytics_engine") == "columnar" && SalesStore::instance().ensureLoaded();
+}
+
+static QList<ProductSale> dailyProductSales(const QDate& date) {
+    return useSalesStore() ? SalesStore::instance().productSales(SalesPeriod::Daily, date, date)
+                           : Database::instance().getDailyProductSales(date);
+}
+
+static QList<ProductSale> monthlyProductSales(int year, int month) {
+    QDate date(year, month, 1);
+    return useSalesStore() ? SalesStore::instance().productSales(SalesPeriod::Monthly, date, date)
+                           : Database::instance().getMonthlyProductSales(year, month);
+}
+
+static QList<ProductSale> annualProductSales(int year) {
+    QDate date(year, 1, 1);
+    return useSalesStore() ? SalesStore::instance().productSales(SalesPeriod::Annual, date, date)
+                           : Database::instance().getAnnualProductSales(year);
+}
 
 static QWidget* makeStatCard(const QString& title, QLabel*& valueOut, const QString& bg, const QString& fg) {
     auto* card = new QWidget;
@@ -66,7 +99,7 @@ static void showSalesDetailDialog(QWidget* parent, const QString& title, const Q
     root->addWidget(heading);
 
     // Summary strip
-    double totalIncome = 0, totalProfit = 0;
+    Money totalIncome, totalProfit;
     int totalQty = 0;
     for (const auto& s : sales) {
         totalIncome += s.income;
@@ -140,7 +173,7 @@ static void showSalesDetailDialog(QWidget* parent, const QString& title, const Q
 
         tbl->setItem(i, 4, makeRight(fmtCurrency(s.income), QColor("#2b6cb0")));
 
-        auto* profItem = makeRight(fmtCurrency(s.profit), s.profit >= 0 ? QColor("#2f855a") : QColor("#e53e3e"));
+        auto* profItem = makeRight(fmtCurrency(s.profit), s.profit >= Money() ? QColor("#2f855a") : QColor("#e53e3e"));
         profItem->setFont(QFont("", -1, QFont::Bold));
         tbl->setItem(i, 5, profItem);
     }
@@ -164,6 +197,87 @@ static void showSalesDetailDialog(QWidget* parent, const QString& title, const Q
     dlg->exec();
 }
 
+// =================== Export ===================
+// Asks for a file name, then runs the export in the background behind a cancellable progress dialog.
+static void runExport(QWidget* parent, ExportJob::Request request, const QString& suggestedName) {
+    QString filter;
+    QString path = QFileDialog::getSaveFileName(parent, "Export", QDir::homePath() + "/" + suggestedName + ".xlsx",
+                                                "Excel Workbook (*.xlsx);;CSV Files (*.csv)", &filter);
+    if (path.isEmpty()) {
+        return;
+    }
+    if (QFileInfo(path).suffix().isEmpty()) {
+        path += filter.startsWith("CSV") ? ".csv" : ".xlsx";
+    }
+    request.path = path;
+
+    auto* job = new ExportJob(parent);
+    auto* progress = new QProgressDialog("Exporting " + QFileInfo(path).fileName() + "…", "Cancel", 0, 100, parent);
+    progress->setWindowTitle("Export");
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+
+    QObject::connect(job, &ExportJob::progress, progress, &QProgressDialog::setValue);
+    QObject::connect(progress, &QProgressDialog::canceled, job, &ExportJob::cancel);
+    QObject::connect(job, &ExportJob::finished, parent, [parent, job, progress](bool ok, const QString& message) {
+        progress->deleteLater();
+        job->deleteLater();
+        if (ok) {
+            QMessageBox::information(parent, "Export", message);
+        } else {
+            QMessageBox::warning(parent, "Export", message);
+        }
+    });
+    job->start(request);
+}
+
+// ── Chart helpers ─────────────────────────────────────────────────
+// Charts are created once with their series and axes; refreshes go through the helpers below so
+// nothing is reallocated and each series emits a single change.
+
+static QChart* makeChart(const QString& title, int titleSize) {
+    auto* chart = new QChart;
+    chart->setTitle(title);
+    chart->setTitleFont(QFont("Segoe UI", titleSize, QFont::Bold));
+    chart->setBackgroundBrush(Qt::white);
+    chart->setMargins(QMargins(8, 8, 8, 8));
+    return chart;
+}
+
+static QValueAxis* makeValueAxis(int fontSize) {
+    auto* axis = new QValueAxis;
+    axis->setLabelFormat("%.0f");
+    axis->setLabelsFont(QFont("Segoe UI", fontSize));
+    return axis;
+}
+
+static void replaceBarValues(QBarSet* set, const QList<qreal>& values) {
+    if (set->count() == values.size()) {
+        for (int i = 0; i < values.size(); ++i) {
+            set->replace(i, values[i]);
+        }
+        return;
+    }
+    if (set->count() > 0) {
+        set->remove(0, set->count());
+    }
+    set->append(values);
+}
+
+// Series data is replaced wholesale, so the axes do not follow it and are fitted here.
+static void fitValueAxis(QValueAxis* axis, double minValue, double maxValue) {
+    minValue = qMin(0.0, minValue);
+    maxValue = qMax(maxValue, minValue + 1.0);
+    axis->setRange(minValue, maxValue);
+    axis->applyNiceNumbers();
+}
+
+static double msecsAt(const QDate& d) {
+    return static_cast<double>(QDateTime(d, QTime(0, 0), QTimeZone::utc()).toMSecsSinceEpoch());
+}
+
 // =================== DashboardTab ===================
 
 DashboardTab::DashboardTab(QWidget* parent) : QWidget(parent) { setupUi(); }
@@ -191,13 +305,39 @@ void DashboardTab::setupUi() {
     auto* chartsRow = new QHBoxLayout;
     chartsRow->setSpacing(12);
 
-    m_weeklyChart = new QChartView;
-    m_weeklyChart->setMinimumHeight(240);
-    m_weeklyChart->setRenderHint(QPainter::Antialiasing);
+    auto makeBarChartView = [](QChartView*& view, const QColor& color, const QStringList& categories, QBarSet*& set,
+                               QValueAxis*& axisY) {
+        auto* chart = makeChart(QString(), 10);
+        set = new QBarSet("Income");
+        set->setColor(color);
+        set->append(QList<qreal>(categories.size(), 0.0));
+        auto* series = new QBarSeries;
+        series->append(set);
+        chart->addSeries(series);
+        auto* axisX = new QBarCategoryAxis;
+        axisX->append(categories);
+        axisX->setLabelsFont(QFont("Segoe UI", 8));
+        chart->addAxis(axisX, Qt::AlignBottom);
+        series->attachAxis(axisX);
+        axisY = makeValueAxis(8);
+        chart->addAxis(axisY, Qt::AlignLeft);
+        series->attachAxis(axisY);
+        chart->legend()->setVisible(false);
+        setChartAnimated(chart, static_cast<int>(categories.size()));
 
-    m_monthlyChart = new QChartView;
-    m_monthlyChart->setMinimumHeight(240);
-    m_monthlyChart->setRenderHint(QPainter::Antialiasing);
+        view = new QChartView(chart);
+        view->setMinimumHeight(240);
+        view->setRenderHint(QPainter::Antialiasing);
+    };
+
+    makeBarChartView(m_weeklyChart, QColor("#3a7bd5"), {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"}, m_weeklySet,
+                     m_weeklyAxisY);
+    m_weeklyChart->chart()->setTitle("This Week's Sales");
+    makeBarChartView(m_monthlyChart,
+                     QColor("#2f855a"),
+                     {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"},
+                     m_monthlySet,
+                     m_monthlyAxisY);
 
     chartsRow->addWidget(m_weeklyChart);
     chartsRow->addWidget(m_monthlyChart);
@@ -242,17 +382,21 @@ void DashboardTab::setupUi() {
 }
 
 void DashboardTab::loadData() {  // NOLINT
-    QDate today = QDate::currentDate();
+    QDate today = Database::instance().shopToday();
     QDate weekStart = today.addDays(-today.dayOfWeek() + 1);
     QDate monthStart = QDate(today.year(), today.month(), 1);
     QDate yearStart = QDate(today.year(), 1, 1);
 
-    QList<SalesReport> daily = Database::instance().getDailySalesReports();
-    QList<MonthlySalesReport> monthly = Database::instance().getMonthlySalesReports();
-    QList<AnnualSalesReport> annual = Database::instance().getAnnualSalesReports();
+    const bool columnar = useSalesStore();
+    QList<SalesReport> daily =
+        columnar ? SalesStore::instance().dailyTotals() : Database::instance().getDailySalesReports();
+    QList<MonthlySalesReport> monthly =
+        columnar ? SalesStore::instance().monthlyTotals() : Database::instance().getMonthlySalesReports();
+    QList<AnnualSalesReport> annual =
+        columnar ? SalesStore::instance().annualTotals() : Database::instance().getAnnualSalesReports();
 
     // Aggregate
-    double incToday = 0, incWeek = 0, incMonth = 0, incYear = 0;
+    Money incToday, incWeek, incMonth, incYear;
     for (const auto& r : daily) {
         QDate d = r.transactionDate;
         if (d == today) {
@@ -275,86 +419,31 @@ void DashboardTab::loadData() {  // NOLINT
     m_yearLabel->setText(fmtCurrency(incYear));
 
     // Weekly chart (Mon-Sun)
-    QList<QString> dayLabels = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
-    QList<double> dayValues(7, 0.0);
+    QList<qreal> dayValues(7, 0.0);
     for (const auto& r : daily) {
         if (r.transactionDate >= weekStart && r.transactionDate <= today) {
             int idx = r.transactionDate.dayOfWeek() - 1;
             if (idx >= 0 && idx < 7) {
-                dayValues[idx] += r.totalIncome;
+                dayValues[idx] += r.totalIncome.toDouble();
             }
         }
     }
-
-    {
-        auto* chart = new QChart;
-        chart->setTitle("This Week's Sales");
-        chart->setAnimationOptions(QChart::SeriesAnimations);
-        chart->setBackgroundBrush(Qt::white);
-        chart->setTitleFont(QFont("Segoe UI", 10, QFont::Bold));
-        auto* set = new QBarSet("Income");
-        set->setColor(QColor("#3a7bd5"));
-        for (double v : dayValues) {
-            *set << v;
-        }
-        auto* series = new QBarSeries;
-        series->append(set);
-        chart->addSeries(series);
-        auto* axisX = new QBarCategoryAxis;
-        axisX->append(dayLabels);
-        axisX->setLabelsFont(QFont("Segoe UI", 8));
-        chart->addAxis(axisX, Qt::AlignBottom);
-        series->attachAxis(axisX);
-        auto* axisY = new QValueAxis;
-        axisY->setLabelFormat("%.0f");
-        axisY->setLabelsFont(QFont("Segoe UI", 8));
-        chart->addAxis(axisY, Qt::AlignLeft);
-        series->attachAxis(axisY);
-        chart->legend()->setVisible(false);
-        m_weeklyChart->setChart(chart);
-        m_weeklyChart->setRenderHint(QPainter::Antialiasing);
-    }
+    replaceBarValues(m_weeklySet, dayValues);
+    fitValueAxis(m_weeklyAxisY, 0.0, *std::max_element(dayValues.cbegin(), dayValues.cend()));
 
     // Monthly chart (Jan-Dec current year)
-    QList<QString> monthLabels = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-    QList<double> monthValues(12, 0.0);
+    QList<qreal> monthValues(12, 0.0);
     for (const auto& r : monthly) {
         if (r.month.year() == today.year()) {
             int idx = r.month.month() - 1;
             if (idx >= 0 && idx < 12) {
-                monthValues[idx] += r.totalIncome;
+                monthValues[idx] += r.totalIncome.toDouble();
             }
         }
     }
-
-    {
-        auto* chart = new QChart;
-        chart->setTitle(QString("Monthly Sales (%1)").arg(today.year()));
-        chart->setAnimationOptions(QChart::SeriesAnimations);
-        chart->setBackgroundBrush(Qt::white);
-        chart->setTitleFont(QFont("Segoe UI", 10, QFont::Bold));
-        auto* set = new QBarSet("Income");
-        set->setColor(QColor("#2f855a"));
-        for (double v : monthValues) {
-            *set << v;
-        }
-        auto* series = new QBarSeries;
-        series->append(set);
-        chart->addSeries(series);
-        auto* axisX = new QBarCategoryAxis;
-        axisX->append(monthLabels);
-        axisX->setLabelsFont(QFont("Segoe UI", 8));
-        chart->addAxis(axisX, Qt::AlignBottom);
-        series->attachAxis(axisX);
-        auto* axisY = new QValueAxis;
-        axisY->setLabelFormat("%.0f");
-        axisY->setLabelsFont(QFont("Segoe UI", 8));
-        chart->addAxis(axisY, Qt::AlignLeft);
-        series->attachAxis(axisY);
-        chart->legend()->setVisible(false);
-        m_monthlyChart->setChart(chart);
-        m_monthlyChart->setRenderHint(QPainter::Antialiasing);
-    }
+    m_monthlyChart->chart()->setTitle(QString("Monthly Sales (%1)").arg(today.year()));
+    replaceBarValues(m_monthlySet, monthValues);
+    fitValueAxis(m_monthlyAxisY, 0.0, *std::max_element(monthValues.cbegin(), monthValues.cend()));
 
     // ---- Daily table ----
     m_dailyTable->setRowCount(0);
@@ -379,7 +468,7 @@ void DashboardTab::loadData() {  // NOLINT
             "border-radius: 3px; font-size: 11px; padding: 0 6px; }");
         QDate d = r.transactionDate;
         connect(viewBtn, &QPushButton::clicked, this, [d, this] {
-            auto sales = Database::instance().getDailyProductSales(d);
+            auto sales = dailyProductSales(d);
             showSalesDetailDialog(this, QString("Daily Sales — %1").arg(d.toString("dddd, dd MMM yyyy")), sales);
         });
         m_dailyTable->setCellWidget(row, 2, viewBtn);
@@ -408,7 +497,7 @@ void DashboardTab::loadData() {  // NOLINT
         int yr = r.month.year();
         int mo = r.month.month();
         connect(viewBtn, &QPushButton::clicked, this, [this, yr, mo] {
-            auto sales = Database::instance().getMonthlyProductSales(yr, mo);
+            auto sales = monthlyProductSales(yr, mo);
             showSalesDetailDialog(this, QString("Monthly Sales — %1/%2").arg(mo, 2, 10, QChar('0')).arg(yr), sales);
         });
         m_monthlyTable->setCellWidget(row, 2, viewBtn);
@@ -435,7 +524,7 @@ void DashboardTab::loadData() {  // NOLINT
             "border-radius: 3px; font-size: 11px; padding: 0 6px; }");
         int yr = r.year.year();
         connect(viewBtn, &QPushButton::clicked, this, [this, yr] {
-            auto sales = Database::instance().getAnnualProductSales(yr);
+            auto sales = annualProductSales(yr);
             showSalesDetailDialog(this, QString("Annual Sales — %1").arg(yr), sales);
         });
         m_annualTable->setCellWidget(row, 2, viewBtn);
@@ -486,6 +575,10 @@ void SalesReportTab::setupUi() {
     genBtn->setObjectName("successBtn");
     genBtn->setFixedHeight(34);
 
+    auto* exportBtn = new QPushButton("📤  Export");
+    exportBtn->setObjectName("secondaryBtn");
+    exportBtn->setFixedHeight(34);
+
     ctrlRow->addWidget(makeLabel("Period:"));
     ctrlRow->addWidget(m_periodCombo);
     ctrlRow->addWidget(makeLabel("From:"));
@@ -493,6 +586,7 @@ void SalesReportTab::setupUi() {
     ctrlRow->addWidget(makeLabel("To:"));
     ctrlRow->addWidget(m_dateTo);
     ctrlRow->addStretch();
+    ctrlRow->addWidget(exportBtn);
     ctrlRow->addWidget(genBtn);
     root->addLayout(ctrlRow);
 
@@ -511,22 +605,75 @@ void SalesReportTab::setupUi() {
     auto* chartsRow = new QHBoxLayout;
     chartsRow->setSpacing(10);
 
-    auto makeChartView = [](QChartView*& cv) -> QChartView* {
-        cv = new QChartView;
+    auto makeChartView = [](QChartView*& cv, QChart* chart) -> QChartView* {
+        cv = new QChartView(chart);
         cv->setRenderHint(QPainter::Antialiasing);
         cv->setMinimumHeight(220);
         cv->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-        // placeholder empty chart
-        auto* c = new QChart;
-        c->setBackgroundBrush(Qt::white);
-        c->setMargins(QMargins(8, 8, 8, 8));
-        cv->setChart(c);
         return cv;
     };
 
-    chartsRow->addWidget(makeChartView(m_incomeChartView), 2);
-    chartsRow->addWidget(makeChartView(m_profitChartView), 2);
-    chartsRow->addWidget(makeChartView(m_topProductsChartView), 2);
+    // Income & profit trend: one point per day, downsampled to the view width on refresh
+    auto* trendChart = makeChart("Income & Profit Trend", 9);
+    m_incomeSeries = new QLineSeries;
+    m_incomeSeries->setName("Income");
+    m_incomeSeries->setPen(QPen(QColor("#3a7bd5"), 2.5));
+    m_profitSeries = new QLineSeries;
+    m_profitSeries->setName("Profit");
+    m_profitSeries->setPen(QPen(QColor("#2f855a"), 2.5));
+    trendChart->addSeries(m_incomeSeries);
+    trendChart->addSeries(m_profitSeries);
+    m_trendAxisX = new QDateTimeAxis;
+    m_trendAxisX->setFormat("dd MMM");
+    m_trendAxisX->setLabelsFont(QFont("Segoe UI", 7));
+    trendChart->addAxis(m_trendAxisX, Qt::AlignBottom);
+    m_trendAxisY = makeValueAxis(7);
+    trendChart->addAxis(m_trendAxisY, Qt::AlignLeft);
+    for (auto* series : {m_incomeSeries, m_profitSeries}) {
+        series->attachAxis(m_trendAxisX);
+        series->attachAxis(m_trendAxisY);
+    }
+    trendChart->legend()->setAlignment(Qt::AlignBottom);
+    trendChart->legend()->setFont(QFont("Segoe UI", 8));
+
+    // Profit by day, or by month for longer ranges; losses are stacked in red
+    auto* profitChart = makeChart("Profit by Period", 9);
+    m_profitSet = new QBarSet("Profit");
+    m_profitSet->setColor(QColor("#2f855a"));
+    m_lossSet = new QBarSet("Loss");
+    m_lossSet->setColor(QColor("#e53e3e"));
+    auto* profitBars = new QStackedBarSeries;
+    profitBars->append(m_profitSet);
+    profitBars->append(m_lossSet);
+    profitChart->addSeries(profitBars);
+    m_profitAxisX = new QBarCategoryAxis;
+    m_profitAxisX->setLabelsFont(QFont("Segoe UI", 7));
+    profitChart->addAxis(m_profitAxisX, Qt::AlignBottom);
+    profitBars->attachAxis(m_profitAxisX);
+    m_profitAxisY = makeValueAxis(7);
+    profitChart->addAxis(m_profitAxisY, Qt::AlignLeft);
+    profitBars->attachAxis(m_profitAxisY);
+    profitChart->legend()->setVisible(false);
+
+    // Top 7 products by income (horizontal bar)
+    auto* topChart = makeChart("Top Products", 9);
+    m_topSet = new QBarSet("Income");
+    m_topSet->setColor(QColor("#553c9a"));
+    auto* topBars = new QHorizontalBarSeries;
+    topBars->append(m_topSet);
+    topChart->addSeries(topBars);
+    m_topAxisY = new QBarCategoryAxis;  // categories on Y for horizontal
+    m_topAxisY->setLabelsFont(QFont("Segoe UI", 7));
+    topChart->addAxis(m_topAxisY, Qt::AlignLeft);
+    topBars->attachAxis(m_topAxisY);
+    m_topAxisX = makeValueAxis(7);
+    topChart->addAxis(m_topAxisX, Qt::AlignBottom);
+    topBars->attachAxis(m_topAxisX);
+    topChart->legend()->setVisible(false);
+
+    chartsRow->addWidget(makeChartView(m_incomeChartView, trendChart), 2);
+    chartsRow->addWidget(makeChartView(m_profitChartView, profitChart), 2);
+    chartsRow->addWidget(makeChartView(m_topProductsChartView, topChart), 2);
     root->addLayout(chartsRow);
 
     // ── Summary label ──────────────────────────────────────────────
@@ -555,272 +702,161 @@ void SalesReportTab::setupUi() {
     root->addWidget(m_table);
 
     connect(genBtn, &QPushButton::clicked, this, &SalesReportTab::onGenerate);
+    connect(exportBtn, &QPushButton::clicked, this, &SalesReportTab::onExport);
 }
 
-void SalesReportTab::updateCharts(const QList<ProductSale>& sales) {
+void SalesReportTab::onExport() {
+    ExportJob::Request request;
+    request.source = ExportJob::Source::ProductSales;
+    QString period = m_periodCombo->currentText();
+    request.period = period == "Daily"     ? SalesPeriod::Daily
+                     : period == "Monthly" ? SalesPeriod::Monthly
+                                           : SalesPeriod::Annual;
+    request.fromDate = m_dateFrom->date();
+    request.toDate = m_dateTo->date();
+    runExport(this,
+              request,
+              QString("sales-%1-%2_%3")
+                  .arg(period.toLower(), request.fromDate.toString(Qt::ISODate), request.toDate.toString(Qt::ISODate)));
+}
+
+void SalesReportTab::updateCharts(const QList<ProductSale>& sales, const QDate& from, const QDate& to) {
     // ── Aggregate by date for income + profit trend ────────────────
-    QMap<QDate, double> incomeByDate;
-    QMap<QDate, double> profitByDate;
-    QMap<QString, double> incomeByProduct;
+    QMap<QDate, Money> incomeByDate;
+    QMap<QDate, Money> profitByDate;
 
-    double totalIncome = 0, totalProfit = 0;
+    Money totalIncome, totalProfit;
     int totalUnits = 0;
 
     for (const auto& s : sales) {
         incomeByDate[s.transactionDate] += s.income;
         profitByDate[s.transactionDate] += s.profit;
-        incomeByProduct[s.productName] += s.income;
         totalIncome += s.income;
         totalProfit += s.profit;
         totalUnits += s.quantitySold;
     }
 
     // ── Stat cards ─────────────────────────────────────────────────
-    double margin = totalIncome > 0 ? (totalProfit / totalIncome * 100.0) : 0.0;
-    double avgLine = sales.isEmpty() ? 0.0 : totalIncome / static_cast<double>(sales.size());
+    double margin = totalIncome > Money() ? (totalProfit.toDouble() / totalIncome.toDouble() * 100.0) : 0.0;
+    double avgLine = sales.isEmpty() ? 0.0 : totalIncome.toDouble() / static_cast<double>(sales.size());
 
     auto fmt = [](double v) { return QString("UGX %L1").arg(v, 0, 'f', 0); };
 
-    m_statIncome->setText(fmt(totalIncome));
-    m_statProfit->setText(fmt(totalProfit));
+    m_statIncome->setText(fmt(totalIncome.toDouble()));
+    m_statProfit->setText(fmt(totalProfit.toDouble()));
     m_statMargin->setText(QString("%1%").arg(margin, 0, 'f', 1));
     m_statUnits->setText(QString::number(totalUnits));
     m_statLines->setText(QString::number(sales.size()));
     m_statAvgOrder->setText(fmt(avgLine));
 
+    // Hold repaints until every chart has its new data, so the refresh lands in one frame
+    const QList<QChartView*> views = {m_incomeChartView, m_profitChartView, m_topProductsChartView};
+    for (auto* view : views) {
+        view->setUpdatesEnabled(false);
+    }
+
     // ── Chart 1: Income trend line ─────────────────────────────────
     {
-        auto* incomeSeries = new QLineSeries;
-        incomeSeries->setName("Income");
-        incomeSeries->setPen(QPen(QColor("#3a7bd5"), 2.5));
-
-        auto* profitSeries = new QLineSeries;
-        profitSeries->setName("Profit");
-        profitSeries->setPen(QPen(QColor("#2f855a"), 2.5));
-
-        // Use sequential x-axis if many dates; datetime axis otherwise
         QList<QDate> dates = incomeByDate.keys();
+        QList<QPointF> incomePoints;
+        QList<QPointF> profitPoints;
+        incomePoints.reserve(dates.size() + 1);
+        profitPoints.reserve(dates.size() + 1);
+        double minY = 0;
+        double maxY = 0;
+        for (const QDate& d : dates) {
+            double income = incomeByDate.value(d).toDouble();
+            double profit = profitByDate.value(d).toDouble();
+            incomePoints.append(QPointF(msecsAt(d), income));
+            profitPoints.append(QPointF(msecsAt(d), profit));
+            minY = qMin(minY, qMin(income, profit));
+            maxY = qMax(maxY, qMax(income, profit));
+        }
 
-        if (dates.size() <= 60) {
-            // DateTime axis
-            for (const QDate& d : dates) {
-                qint64 ms = QDateTime(d, QTime(0, 0), QTimeZone::utc()).toMSecsSinceEpoch();
-                incomeSeries->append((double)ms, incomeByDate[d]);
-                profitSeries->append((double)ms, profitByDate.value(d, 0));
-            }
+        // A single day is stretched to the next so the line has a visible length
+        QDate lastX = dates.isEmpty() ? QDate::currentDate() : dates.last();
+        QDate firstX = dates.isEmpty() ? lastX.addDays(-1) : dates.first();
+        if (dates.size() == 1) {
+            lastX = firstX.addDays(1);
+            incomePoints.append(QPointF(msecsAt(lastX), incomePoints[0].y()));
+            profitPoints.append(QPointF(msecsAt(lastX), profitPoints[0].y()));
+        }
 
-            // Add an extra point at the end to make the last date's value visible on the right edge
-            // Otherwise, if the last date is today and has sales, the line will end right at the edge and look cut off
-            if (dates.size() == 1) {
-                qint64 ms2 = QDateTime(dates[0].addDays(1), QTime(0, 0), QTimeZone::utc()).toMSecsSinceEpoch();
-                incomeSeries->append((double)ms2, incomeByDate[dates[0]]);
-                profitSeries->append((double)ms2, profitByDate.value(dates[0], 0));
-            }
+        int budget = chartPointBudget(m_incomeChartView);
+        incomePoints = downsampleLttb(incomePoints, budget);
+        profitPoints = downsampleLttb(profitPoints, budget);
 
-            auto* chart = new QChart;
-            chart->setTitle("Income & Profit Trend");
-            chart->setTitleFont(QFont("Segoe UI", 9, QFont::Bold));
-            chart->setBackgroundBrush(Qt::white);
-            chart->setAnimationOptions(QChart::SeriesAnimations);
-            chart->setMargins(QMargins(8, 8, 8, 8));
-            chart->addSeries(incomeSeries);
-            chart->addSeries(profitSeries);
-
-            auto* axisX = new QDateTimeAxis;
-            axisX->setFormat(dates.size() > 30 ? "MMM yy" : "dd MMM");
-            axisX->setLabelsFont(QFont("Segoe UI", 7));
-            axisX->setTickCount(qMin(static_cast<int>(dates.size()), 8));
-            chart->addAxis(axisX, Qt::AlignBottom);
-            incomeSeries->attachAxis(axisX);
-            profitSeries->attachAxis(axisX);
-
-            auto* axisY = new QValueAxis;
-            axisY->setLabelFormat("%.0f");
-            axisY->setMin(0);  // prevent negative-only range on single point
-            axisY->setLabelsFont(QFont("Segoe UI", 7));
-            chart->addAxis(axisY, Qt::AlignLeft);
-            incomeSeries->attachAxis(axisY);
-            profitSeries->attachAxis(axisY);
-
-            chart->legend()->setAlignment(Qt::AlignBottom);
-            chart->legend()->setFont(QFont("Segoe UI", 8));
-            m_incomeChartView->setChart(chart);
+        setChartAnimated(m_incomeChartView->chart(), static_cast<int>(incomePoints.size()));
+        m_incomeSeries->replace(incomePoints);
+        m_profitSeries->replace(profitPoints);
 
-        } else {
-            // Too many points — aggregate by month, use bar chart
-            QMap<QString, double> byMonth;
-            for (const QDate& d : dates) {
-                QString key = d.toString("yyyy-MM");
-                byMonth[key] += incomeByDate[d];
-            }
-            auto* set = new QBarSet("Income");
-            set->setColor(QColor("#3a7bd5"));
-            QStringList cats;
-            for (auto it = byMonth.begin(); it != byMonth.end(); ++it) {
-                cats << it.key();
-                *set << it.value();
-            }
-            auto* series = new QBarSeries;
-            series->append(set);
-
-            auto* chart = new QChart;
-            chart->setTitle("Income by Month");
-            chart->setTitleFont(QFont("Segoe UI", 9, QFont::Bold));
-            chart->setBackgroundBrush(Qt::white);
-            chart->setMargins(QMargins(8, 8, 8, 8));
-            chart->addSeries(series);
-
-            auto* axisX = new QBarCategoryAxis;
-            axisX->append(cats);
-            axisX->setLabelsFont(QFont("Segoe UI", 7));
-            chart->addAxis(axisX, Qt::AlignBottom);
-            series->attachAxis(axisX);
-
-            auto* axisY = new QValueAxis;
-            axisY->setLabelFormat("%.0f");
-            axisY->setLabelsFont(QFont("Segoe UI", 7));
-            chart->addAxis(axisY, Qt::AlignLeft);
-            series->attachAxis(axisY);
-
-            chart->legend()->setVisible(false);
-            m_incomeChartView->setChart(chart);
-        }
+        m_trendAxisX->setFormat(firstX.daysTo(lastX) > 60 ? "MMM yy" : "dd MMM");
+        m_trendAxisX->setTickCount(qBound(2, static_cast<int>(dates.size()), 8));
+        m_trendAxisX->setRange(QDateTime(firstX, QTime(0, 0), QTimeZone::utc()),
+                               QDateTime(lastX, QTime(0, 0), QTimeZone::utc()));
+        fitValueAxis(m_trendAxisY, minY, maxY);
     }
 
-    // ── Chart 2: Daily profit bars ─────────────────────────────────
+    // ── Chart 2: Profit bars, daily up to a month and monthly beyond ──
     {
-        auto* chart = new QChart;
-        chart->setTitle("Profit by Period");
-        chart->setTitleFont(QFont("Segoe UI", 9, QFont::Bold));
-        chart->setBackgroundBrush(Qt::white);
-        chart->setAnimationOptions(QChart::SeriesAnimations);
-        chart->setMargins(QMargins(8, 8, 8, 8));
-
-        QList<QDate> dates = profitByDate.keys();
-        bool useMonths = dates.size() > 31;
-
-        if (useMonths) {
-            QMap<QString, double> byMonth;
-            for (const QDate& d : dates) {
-                byMonth[d.toString("MMM yy")] += profitByDate[d];
-            }
-            auto* posSet = new QBarSet("Profit");
-            posSet->setColor(QColor("#2f855a"));
-            auto* negSet = new QBarSet("Loss");
-            negSet->setColor(QColor("#e53e3e"));
-            QStringList cats;
-            for (auto it = byMonth.begin(); it != byMonth.end(); ++it) {
-                cats << it.key();
-                double v = it.value();
-                *posSet << (v >= 0 ? v : 0);
-                *negSet << (v < 0 ? -v : 0);
-            }
-            auto* series = new QBarSeries;
-            series->append(posSet);
-            if (negSet->at(0) > 0) series->append(negSet);
-            chart->addSeries(series);
-
-            auto* axisX = new QBarCategoryAxis;
-            axisX->append(cats);
-            axisX->setLabelsFont(QFont("Segoe UI", 7));
-            chart->addAxis(axisX, Qt::AlignBottom);
-            series->attachAxis(axisX);
-
-            auto* axisY = new QValueAxis;
-            axisY->setLabelFormat("%.0f");
-            axisY->setLabelsFont(QFont("Segoe UI", 7));
-            chart->addAxis(axisY, Qt::AlignLeft);
-            series->attachAxis(axisY);
-        } else {
-            auto* profitSeries = new QLineSeries;
-            profitSeries->setName("Profit");
-            profitSeries->setPen(QPen(QColor("#2f855a"), 2.5));
-
-            for (const QDate& d : dates) {
-                qint64 ms = QDateTime(d, QTime(0, 0), QTimeZone::utc()).toMSecsSinceEpoch();
-                profitSeries->append((double)ms, profitByDate[d]);
-            }
+        bool useMonths = profitByDate.size() > 31;
 
-            if (dates.size() == 1) {
-                qint64 ms2 = QDateTime(dates[0].addDays(1), QTime(0, 0), QTimeZone::utc()).toMSecsSinceEpoch();
-                profitSeries->append((double)ms2, profitByDate[dates[0]]);
-            }
+        QMap<QDate, Money> byPeriod;
+        for (auto it = profitByDate.cbegin(); it != profitByDate.cend(); ++it) {
+            QDate key = useMonths ? QDate(it.key().year(), it.key().month(), 1) : it.key();
+            byPeriod[key] += it.value();
+        }
 
-            chart->addSeries(profitSeries);
-
-            auto* axisX = new QDateTimeAxis;
-            axisX->setTickCount(qMax(2, qMin(static_cast<int>(dates.size()) + 1, 8)));
-            axisX->setFormat("dd MMM");
-            axisX->setLabelsFont(QFont("Segoe UI", 7));
-            axisX->setTickCount(qMin(static_cast<int>(dates.size()), 8));
-            chart->addAxis(axisX, Qt::AlignBottom);
-            profitSeries->attachAxis(axisX);
-
-            auto* axisY = new QValueAxis;
-            axisY->setLabelFormat("%.0f");
-            axisY->setLabelsFont(QFont("Segoe UI", 7));
-            chart->addAxis(axisY, Qt::AlignLeft);
-            profitSeries->attachAxis(axisY);
+        QStringList cats;
+        QList<qreal> profits;
+        QList<qreal> losses;
+        double maxY = 0;
+        for (auto it = byPeriod.cbegin(); it != byPeriod.cend(); ++it) {
+            cats << it.key().toString(useMonths ? "MMM yy" : "dd MMM");
+            double v = it.value().toDouble();
+            profits << (v >= 0 ? v : 0);
+            losses << (v < 0 ? -v : 0);
+            maxY = qMax(maxY, qAbs(v));
         }
 
-        chart->legend()->setVisible(false);
-        m_profitChartView->setChart(chart);
+        setChartAnimated(m_profitChartView->chart(), static_cast<int>(cats.size()));
+        m_profitAxisX->clear();
+        m_profitAxisX->append(cats);
+        replaceBarValues(m_profitSet, profits);
+        replaceBarValues(m_lossSet, losses);
+        fitValueAxis(m_profitAxisY, 0.0, maxY);
     }
 
     // ── Chart 3: Top 7 products by income (horizontal bar) ────────
     {
-        // Sort by income descending, take top 7
-        QList<QPair<QString, double>> sorted;
-        for (auto it = incomeByProduct.begin(); it != incomeByProduct.end(); ++it) {
-            sorted.append({it.key(), it.value()});
-        }
+        // Ranked and cut to 7 by the database, keyed by product id
+        QList<ProductSale> top = useSalesStore()
+                                     ? SalesStore::instance().topProducts(from, to, ProductMetric::Income, 7)
+                                     : Database::instance().getTopProducts(from, to, ProductMetric::Income, 7);
 
-        std::sort(sorted.begin(), sorted.end(),                                       // NOLINT
-                  [](const auto& a, const auto& b) { return a.second > b.second; });  // NOLINT
-        if (sorted.size() > 7) {
-            sorted = sorted.mid(0, 7);
-        }
-
-        auto* set = new QBarSet("Income");
-        set->setColor(QColor("#553c9a"));
         QStringList cats;
+        QList<qreal> values;
 
         // Reverse so highest is at top of horizontal chart
-        for (int i = static_cast<int>(sorted.size() - 1); i >= 0; --i) {
-            QString name = sorted[i].first;
+        for (int i = static_cast<int>(top.size() - 1); i >= 0; --i) {
+            QString name = top[i].productName;
             // shorten long names
             if (name.length() > 22) {
                 name = name.left(19) + "…";
             }
             cats << name;
-            *set << sorted[i].second;
+            values << top[i].income.toDouble();
         }
 
-        auto* series = new QHorizontalBarSeries;
-        series->append(set);
-
-        auto* chart = new QChart;
-        chart->setTitle("Top Products");
-        chart->setTitleFont(QFont("Segoe UI", 9, QFont::Bold));
-        chart->setBackgroundBrush(Qt::white);
-        chart->setAnimationOptions(QChart::SeriesAnimations);
-        chart->setMargins(QMargins(8, 8, 8, 8));
-        chart->addSeries(series);
-
-        auto* axisY = new QBarCategoryAxis;  // categories on Y for horizontal
-        axisY->append(cats);
-        axisY->setLabelsFont(QFont("Segoe UI", 7));
-        chart->addAxis(axisY, Qt::AlignLeft);
-        series->attachAxis(axisY);
-
-        auto* axisX = new QValueAxis;
-        axisX->setLabelFormat("%.0f");
-        axisX->setLabelsFont(QFont("Segoe UI", 7));
-        chart->addAxis(axisX, Qt::AlignBottom);
-        series->attachAxis(axisX);
+        m_topAxisY->clear();
+        m_topAxisY->append(cats);
+        replaceBarValues(m_topSet, values);
+        fitValueAxis(m_topAxisX, 0.0, top.isEmpty() ? 0.0 : top.first().income.toDouble());
+        setChartAnimated(m_topProductsChartView->chart(), static_cast<int>(cats.size()));
+    }
 
-        chart->legend()->setVisible(false);
-        m_topProductsChartView->setChart(chart);
+    for (auto* view : views) {
+        view->setUpdatesEnabled(true);
     }
 }
 
@@ -830,7 +866,13 @@ void SalesReportTab::onGenerate() {
     QDate from = m_dateFrom->date();
     QDate to = m_dateTo->date();
 
-    if (period == "Daily") {
+    if (useSalesStore()) {
+        // One scan over the range instead of one query per period
+        SalesPeriod salesPeriod = period == "Daily"     ? SalesPeriod::Daily
+                                  : period == "Monthly" ? SalesPeriod::Monthly
+                                                        : SalesPeriod::Annual;
+        sales = SalesStore::instance().productSales(salesPeriod, from, to);
+    } else if (period == "Daily") {
         for (QDate d = from; d <= to; d = d.addDays(1)) {
             sales += Database::instance().getDailyProductSales(d);
         }
@@ -849,12 +891,16 @@ void SalesReportTab::onGenerate() {
     }
 
     // ── Update charts & stat cards ─────────────────────────────────
-    updateCharts(sales);
+    SalesPeriod salesPeriod = period == "Daily"     ? SalesPeriod::Daily
+                              : period == "Monthly" ? SalesPeriod::Monthly
+                                                    : SalesPeriod::Annual;
+    Database::expandToPeriod(salesPeriod, from, to);
+    updateCharts(sales, from, to);
 
     // ── Populate table ─────────────────────────────────────────────
     m_table->setRowCount(0);
     m_table->setRowCount(static_cast<int>(sales.size()));
-    double totalIncome = 0, totalProfit = 0;
+    Money totalIncome, totalProfit;
 
     for (int i = 0; i < sales.size(); ++i) {
         const auto& s = sales[i];
@@ -865,8 +911,8 @@ void SalesReportTab::onGenerate() {
         qtyItem->setTextAlignment(Qt::AlignCenter);
         m_table->setItem(i, 2, qtyItem);
 
-        auto makeRight = [](double v, const QString& color = "") -> QTableWidgetItem* {
-            auto* item = new QTableWidgetItem(QString("UGX %1").arg(v, 0, 'f', 2));
+        auto makeRight = [](Money v, const QString& color = "") -> QTableWidgetItem* {
+            auto* item = new QTableWidgetItem(QString("UGX %1").arg(v.toDouble(), 0, 'f', 2));
             item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
             if (!color.isEmpty()) item->setForeground(QColor(color));
             return item;
@@ -878,7 +924,7 @@ void SalesReportTab::onGenerate() {
         auto* incItem = makeRight(s.income, "#2b6cb0");
         m_table->setItem(i, 5, incItem);
 
-        auto* profItem = makeRight(s.profit, s.profit >= 0 ? "#2f855a" : "#e53e3e");
+        auto* profItem = makeRight(s.profit, s.profit >= Money() ? "#2f855a" : "#e53e3e");
         profItem->setFont(QFont("", -1, QFont::Bold));
         m_table->setItem(i, 6, profItem);
 
@@ -887,13 +933,127 @@ void SalesReportTab::onGenerate() {
     }
 
     m_totalLabel->setText(QString("Income: UGX %L1   |   Profit: UGX %L2   |   Items: %3")
-                              .arg(totalIncome, 0, 'f', 2)
-                              .arg(totalProfit, 0, 'f', 2)
+                              .arg(totalIncome.toDouble(), 0, 'f', 2)
+                              .arg(totalProfit.toDouble(), 0, 'f', 2)
                               .arg(sales.size()));
 }
 
 void SalesReportTab::refresh() { onGenerate(); }
 
+// =================== StockCardModel ===================
+
+static constexpr int kStockCardPageSize = 500;
+
+StockCardModel::StockCardModel(QObject* parent) : QAbstractTableModel(parent) { m_cursor.atEnd = true; }
+
+void StockCardModel::loadAll(const QDate& fromDate, const QDate& toDate) {
+    beginResetModel();
+    m_rows.clear();
+    m_cursor = StockCardCursor();
+    m_cursor.fromDate = fromDate;
+    m_cursor.toDate = toDate;
+    m_rows = Database::instance().fetchStockCard(m_cursor, kStockCardPageSize);
+    endResetModel();
+}
+
+void StockCardModel::loadProduct(int productId, const QDate& fromDate, const QDate& toDate) {
+    beginResetModel();
+    m_cursor = StockCardCursor();
+    m_cursor.atEnd = true;
+    m_rows = Database::instance().getProductStockCard(productId, fromDate, toDate);
+    endResetModel();
+}
+
+int StockCardModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+}
+
+int StockCardModel::columnCount(const QModelIndex& parent) const { return parent.isValid() ? 0 : 9; }
+
+QVariant StockCardModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    static const QStringList headers = {"Date", "Product", "Brand", "Opening", "In",
+                                        "Out",  "Reversal", "Closing", "Status"};
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < headers.size()) {
+        return headers[section];
+    }
+    return {};
+}
+
+QVariant StockCardModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return {};
+    }
+    const StockCard& sc = m_rows[index.row()];
+    const int col = index.column();
+
+    if (role == Qt::DisplayRole) {
+        switch (col) {
+            case 0:
+                return sc.date.toString("dd MMM yyyy");
+            case 1:
+                return sc.genericName;
+            case 2:
+                return sc.brandName;
+            case 3:
+                return sc.openingQuantity;
+            case 4:
+                return sc.quantityIn;
+            case 5:
+                return sc.quantityOut;
+            case 6:
+                return sc.quantityReversal;
+            case 7:
+                return sc.closingQuantity;
+            case 8:
+                if (sc.closingQuantity == 0) {
+                    return QString("⚠️ Empty");
+                }
+                return sc.closingQuantity < 10 ? QString("⚡ Low") : QString("✓ OK");
+            default:
+                return {};
+        }
+    }
+
+    if (role == Qt::TextAlignmentRole && col >= 3) {
+        return int(Qt::AlignCenter);
+    }
+
+    if (role == Qt::ForegroundRole) {
+        switch (col) {
+            case 4:
+                return sc.quantityIn > 0 ? QVariant(QColor("#2f855a")) : QVariant();
+            case 5:
+                return QColor("#e53e3e");
+            case 6:
+                return sc.quantityReversal > 0 ? QVariant(QColor("#2b6cb0")) : QVariant();
+            case 7:
+                if (sc.closingQuantity == 0) {
+                    return QColor("#e53e3e");
+                }
+                return sc.closingQuantity < 10 ? QVariant(QColor("#d97706")) : QVariant();
+            default:
+                return {};
+        }
+    }
+    return {};
+}
+
+bool StockCardModel::canFetchMore(const QModelIndex& parent) const { return !parent.isValid() && !m_cursor.atEnd; }
+
+void StockCardModel::fetchMore(const QModelIndex& parent) {
+    if (parent.isValid()) {
+        return;
+    }
+    QList<StockCard> page = Database::instance().fetchStockCard(m_cursor, kStockCardPageSize);
+    if (page.isEmpty()) {
+        return;
+    }
+    const int first = static_cast<int>(m_rows.size());
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(page.size()) - 1);
+    m_rows.append(page);
+    endInsertRows();
+}
+
 // =================== StockCardTab ===================
 
 StockCardTab::StockCardTab(QWidget* parent) : QWidget(parent) { setupUi(); }
@@ -907,7 +1067,8 @@ void StockCardTab::setupUi() {
     title->setStyleSheet("font-size: 15px; font-weight: 700; color: #1e3a5f;");
     root->addWidget(title);
 
-    auto* desc = new QLabel("Daily opening balance, stock in, stock out, and closing balance.");
+    auto* desc = new QLabel("Daily opening balance, stock in, stock out, and closing balance. "
+                            "Pick a product to see every day in the range, including days without movement.");
     desc->setStyleSheet("color: #718096; font-size: 12px;");
     root->addWidget(desc);
 
@@ -926,22 +1087,37 @@ void StockCardTab::setupUi() {
     m_dateTo->setCalendarPopup(true);
     m_dateTo->setDisplayFormat("yyyy-MM-dd");
 
+    auto* productLabel = new QLabel("Product:");
+    productLabel->setStyleSheet("font-weight: 600; color: #4a5568;");
+    m_productSearch = new QLineEdit;
+    m_productSearch->setPlaceholderText("All products");
+    m_productSearch->setFixedWidth(200);
+    m_productLabel = new QLabel;
+    m_productLabel->setStyleSheet("color: #718096; font-size: 12px;");
+
     auto* genBtn = new QPushButton("Generate Stock Card");
     genBtn->setObjectName("successBtn");
     genBtn->setFixedHeight(34);
 
+    auto* exportBtn = new QPushButton("📤  Export");
+    exportBtn->setObjectName("secondaryBtn");
+    exportBtn->setFixedHeight(34);
+
     ctrlRow->addWidget(fromLabel);
     ctrlRow->addWidget(m_dateFrom);
     ctrlRow->addWidget(toLabel);
     ctrlRow->addWidget(m_dateTo);
+    ctrlRow->addWidget(productLabel);
+    ctrlRow->addWidget(m_productSearch);
+    ctrlRow->addWidget(m_productLabel);
     ctrlRow->addStretch();
+    ctrlRow->addWidget(exportBtn);
     ctrlRow->addWidget(genBtn);
     root->addLayout(ctrlRow);
 
-    m_table = new QTableWidget;
-    m_table->setColumnCount(9);
-    m_table->setHorizontalHeaderLabels(
-        {"Date", "Product", "Brand", "Opening", "In", "Out", "Reversal", "Closing", "Status"});
+    m_model = new StockCardModel(this);
+    m_table = new QTableView;
+    m_table->setModel(m_model);
     m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_table->setAlternatingRowColors(true);
     m_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
@@ -954,62 +1130,53 @@ void StockCardTab::setupUi() {
     m_table->setColumnWidth(7, 70);  // Closing
     m_table->setColumnWidth(8, 80);  // Status
     m_table->verticalHeader()->setVisible(false);
+    m_table->verticalHeader()->setDefaultSectionSize(28);
     m_table->setShowGrid(false);
     root->addWidget(m_table);
 
-    connect(genBtn, &QPushButton::clicked, this, &StockCardTab::onGenerate);
-}
-
-void StockCardTab::onGenerate() {
-    QList<StockCard> cards = Database::instance().getStockCard(m_dateFrom->date(), m_dateTo->date());
-    m_table->setRowCount(0);
-    m_table->setRowCount(static_cast<int>(cards.size()));
-
-    for (int i = 0; i < cards.size(); ++i) {
-        const auto& sc = cards[i];
-        m_table->setItem(i, 0, new QTableWidgetItem(sc.date.toString("dd MMM yyyy")));
-        m_table->setItem(i, 1, new QTableWidgetItem(sc.genericName));
-        m_table->setItem(i, 2, new QTableWidgetItem(sc.brandName));
-
-        auto center = [](int v, const QString& color = "") -> QTableWidgetItem* {
-            auto* item = new QTableWidgetItem(QString::number(v));
-            item->setTextAlignment(Qt::AlignCenter);
-            if (!color.isEmpty()) {
-                item->setForeground(QColor(color));
-            }
-            return item;
-        };
-
-        m_table->setItem(i, 3, center(sc.openingQuantity));
-
-        auto* inItem = center(sc.quantityIn, sc.quantityIn > 0 ? "#2f855a" : "");
-        m_table->setItem(i, 4, inItem);
-
-        m_table->setItem(i, 5, center(sc.quantityOut, "#e53e3e"));
-
-        auto* revItem = center(sc.quantityReversal, sc.quantityReversal > 0 ? "#2b6cb0" : "");
-        m_table->setItem(i, 6, revItem);
-
-        auto* closItem = center(sc.closingQuantity);
-        if (sc.closingQuantity == 0) {
-            closItem->setForeground(QColor("#e53e3e"));
-        } else if (sc.closingQuantity < 10) {
-            closItem->setForeground(QColor("#d97706"));
+    connect(m_productSearch, &QLineEdit::textChanged, this, [this](const QString& text) {
+        m_selectedProductId = 0;
+        if (text.trimmed().isEmpty()) {
+            m_productLabel->clear();
+            return;
         }
-        m_table->setItem(i, 7, closItem);
-
-        QString status;
-        if (sc.closingQuantity == 0) {
-            status = "⚠️ Empty";
-        } else if (sc.closingQuantity < 10) {
-            status = "⚡ Low";
+        auto products = Database::instance().searchProducts(text, 1);
+        if (!products.isEmpty()) {
+            m_selectedProductId = products[0].id;
+            m_productLabel->setText(QString("✓ %1").arg(products[0].displayName()));
+            m_productLabel->setStyleSheet("color: #2f855a; font-size: 12px; font-weight: 500;");
         } else {
-            status = "✓ OK";
+            m_productLabel->setText("No product found");
+            m_productLabel->setStyleSheet("color: #e53e3e; font-size: 12px;");
         }
+    });
+    connect(genBtn, &QPushButton::clicked, this, &StockCardTab::onGenerate);
+    connect(exportBtn, &QPushButton::clicked, this, &StockCardTab::onExport);
+}
+
+void StockCardTab::onExport() {
+    if (m_selectedProductId == 0 && !m_productSearch->text().trimmed().isEmpty()) {
+        QMessageBox::warning(this, "Stock Card", "No product matches the search text.");
+        return;
+    }
+    ExportJob::Request request;
+    request.source = ExportJob::Source::StockCard;
+    request.productId = m_selectedProductId;
+    request.fromDate = m_dateFrom->date();
+    request.toDate = m_dateTo->date();
+    runExport(this,
+              request,
+              QString("stock-card-%1_%2")
+                  .arg(request.fromDate.toString(Qt::ISODate), request.toDate.toString(Qt::ISODate)));
+}
 
-        auto* statusItem = new QTableWidgetItem(status);
-        statusItem->setTextAlignment(Qt::AlignCenter);
-        m_table->setItem(i, 8, statusItem);
+void StockCardTab::onGenerate() {
+    if (m_selectedProductId != 0) {
+        m_model->loadProduct(m_selectedProductId, m_dateFrom->date(), m_dateTo->date());
+    } else if (m_productSearch->text().trimmed().isEmpty()) {
+        m_model->loadAll(m_dateFrom->date(), m_dateTo->date());
+    } else {
+        QMessageBox::warning(this, "Stock Card", "No product matches the search text.");
     }
 }
 
@@ -1017,16 +1184,44 @@ void StockCardTab::refresh() {}
 
 // =================== ReportsWidget ===================
 
-ReportsWidget::ReportsWidget(const User& user, QWidget* parent) : QWidget(parent), m_currentUser(user) { setupUi(); }
+ReportsWidget::ReportsWidget(const User& user, QWidget* parent) : QWidget(parent), m_currentUser(user) {
+    setupUi();
+    // Reports are aggregates over many rows, so a change only marks them out of date; they are rebuilt when next
+    // shown rather than after every sale
+    m_changeListenerId =
+        Database::instance().addChangeListener([this](const Database::DataChange& /*change*/) { m_stale = true; });
+}
+
+ReportsWidget::~ReportsWidget() { Database::instance().removeChangeListener(m_changeListenerId); }
+
+void ReportsWidget::showEvent(QShowEvent* event) {
+    QWidget::showEvent(event);
+    if (m_stale) {
+        refresh();
+    }
+}
 
 void ReportsWidget::setupUi() {
     auto* root = new QVBoxLayout(this);
     root->setContentsMargins(16, 16, 16, 16);
     root->setSpacing(12);
 
+    auto* titleRow = new QHBoxLayout;
     auto* title = new QLabel("📊  Reports & Analytics");
     title->setObjectName("pageTitle");
-    root->addWidget(title);
+    titleRow->addWidget(title);
+    titleRow->addStretch();
+
+    // Sales imported from other branches are their takings, not this shop's; counted only on request
+    auto* allBranches = new QCheckBox("All branches");
+    allBranches->setToolTip("Include the sales imported from other branches' delta bundles");
+    allBranches->setChecked(Database::instance().reportAllBranches());
+    connect(allBranches, &QCheckBox::toggled, this, [this](bool checked) {
+        Database::instance().setReportAllBranches(checked);
+        refresh();
+    });
+    titleRow->addWidget(allBranches);
+    root->addLayout(titleRow);
 
     m_tabs = new QTabWidget;
 
@@ -1042,6 +1237,7 @@ void ReportsWidget::setupUi() {
 }
 
 void ReportsWidget::refresh() {
+    m_stale = false;
     m_dashTab->refresh();
     m_salesTab->refresh();
     m_stockTab->refresh();
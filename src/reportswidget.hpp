@@ -1,21 +1,26 @@
 #pragma once
 
+#include <QAbstractTableModel>
 #include <QComboBox>
 #include <QDateEdit>
 #include <QLabel>
+#include <QLineEdit>
 #include <QPushButton>
 #include <QSpinBox>
 #include <QStackedWidget>
 #include <QTabWidget>
+#include <QTableView>
 #include <QTableWidget>
 #include <QWidget>
 #include <QtCharts/QBarCategoryAxis>
 #include <QtCharts/QBarSeries>
+#include <QtCharts/QBarSet>
 #include <QtCharts/QChartView>
 #include <QtCharts/QDateTimeAxis>
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QPieSeries>
 #include <QtCharts/QValueAxis>
+#include "database.hpp"
 #include "models.hpp"
 
 class DashboardTab : public QWidget {
@@ -34,6 +39,10 @@ class DashboardTab : public QWidget {
     QTableWidget* m_annualTable;
     QChartView* m_weeklyChart;
     QChartView* m_monthlyChart;
+    QBarSet* m_weeklySet;
+    QBarSet* m_monthlySet;
+    QValueAxis* m_weeklyAxisY;
+    QValueAxis* m_monthlyAxisY;
 
     void setupUi();
     void loadData();
@@ -47,6 +56,7 @@ class SalesReportTab : public QWidget {
     void refresh();
   private slots:
     void onGenerate();
+    void onExport();
 
   private:
     QComboBox* m_periodCombo;
@@ -60,6 +70,19 @@ class SalesReportTab : public QWidget {
     QChartView* m_profitChartView;
     QChartView* m_topProductsChartView;
 
+    // Built once in setupUi(); a refresh only replaces their data
+    QLineSeries* m_incomeSeries;
+    QLineSeries* m_profitSeries;
+    QDateTimeAxis* m_trendAxisX;
+    QValueAxis* m_trendAxisY;
+    QBarSet* m_profitSet;
+    QBarSet* m_lossSet;
+    QBarCategoryAxis* m_profitAxisX;
+    QValueAxis* m_profitAxisY;
+    QBarSet* m_topSet;
+    QBarCategoryAxis* m_topAxisY;
+    QValueAxis* m_topAxisX;
+
     // stat card labels
     QLabel* m_statIncome;
     QLabel* m_statProfit;
@@ -69,8 +92,30 @@ class SalesReportTab : public QWidget {
     QLabel* m_statAvgOrder;
 
     void setupUi();
-    void updateCharts(const QList<ProductSale>& sales);
+    void updateCharts(const QList<ProductSale>& sales, const QDate& from, const QDate& to);
+};
+// Rows of the stock card. The all-products card is pulled from the database a page at a time
+// as the view scrolls (canFetchMore/fetchMore); a single-product card is small and loaded whole.
+class StockCardModel : public QAbstractTableModel {
+    Q_OBJECT
+  public:
+    explicit StockCardModel(QObject* parent = nullptr);
+
+    void loadAll(const QDate& fromDate, const QDate& toDate);
+    void loadProduct(int productId, const QDate& fromDate, const QDate& toDate);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+  private:
+    QList<StockCard> m_rows;
+    StockCardCursor m_cursor;
 };
+
 class StockCardTab : public QWidget {
     Q_OBJECT
   public:
@@ -78,11 +123,16 @@ class StockCardTab : public QWidget {
     void refresh();
   private slots:
     void onGenerate();
+    void onExport();
 
   private:
     QDateEdit* m_dateFrom;
     QDateEdit* m_dateTo;
-    QTableWidget* m_table;
+    QLineEdit* m_productSearch;
+    QLabel* m_productLabel;
+    int m_selectedProductId = 0;
+    QTableView* m_table;
+    StockCardModel* m_model;
     void setupUi();
 };
 
@@ -90,6 +140,7 @@ class ReportsWidget : public QWidget {
     Q_OBJECT
   public:
     explicit ReportsWidget(const User& user, QWidget* parent = nullptr);
+    ~ReportsWidget() override;
     void refresh();
 
   private:
@@ -98,5 +149,8 @@ class ReportsWidget : public QWidget {
     DashboardTab* m_dashTab;
     SalesReportTab* m_salesTab;
     StockCardTab* m_stockTab;
+    int m_changeListenerId = 0;
+    bool m_stale = true;  // nothing loaded yet, or data changed since
+    void showEvent(QShowEvent* event) override;
     void setupUi();
 };
@@ -0,0 +1,427 @@
+#include "salesstore.hpp"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include <algorithm>
+#include <thread>
+#include "database.hpp"
+
+// Below this many rows a scan stays on the calling thread; starting threads would cost more than it saves
+static constexpr size_t kParallelRows = 1 << 16;
+
+// Runs `scan(begin, end, part)` over one slice of [begin, end) per core and returns the per-slice results for
+// the caller to merge. Each slice writes only its own part.
+template <typename Part, typename Scan>
+static std::vector<Part> scanSlices(size_t begin, size_t end, const Part& init, Scan scan) {
+    const size_t rows = end - begin;
+    const size_t workers = rows < kParallelRows ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Part> parts(workers, init);
+    if (workers == 1) {
+        scan(begin, end, parts[0]);
+        return parts;
+    }
+
+    const size_t step = (rows + workers - 1) / workers;
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        size_t b = begin + w * step;
+        size_t e = std::min(end, b + step);
+        if (b >= e) {
+            break;
+        }
+        threads.emplace_back([&scan, &parts, w, b, e] { scan(b, e, parts[w]); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return parts;
+}
+
+// Period bucket of a Julian day, as the first day of its period
+static qint32 bucketOf(SalesPeriod period, qint32 day) {
+    if (period == SalesPeriod::Daily) {
+        return day;
+    }
+    QDate d = QDate::fromJulianDay(day);
+    return static_cast<qint32>(
+        (period == SalesPeriod::Monthly ? QDate(d.year(), d.month(), 1) : QDate(d.year(), 1, 1)).toJulianDay());
+}
+
+namespace {
+struct GroupKey {
+    qint32 bucket = 0;
+    qint32 productId = 0;
+    qint32 nameId = 0;
+    bool operator==(const GroupKey& o) const {
+        return bucket == o.bucket && productId == o.productId && nameId == o.nameId;
+    }
+};
+
+size_t qHash(const GroupKey& k, size_t seed = 0) { return qHashMulti(seed, k.bucket, k.productId, k.nameId); }
+
+struct GroupSum {
+    qint64 quantity = 0;
+    qint64 costCents = 0;  // quantity * cost
+    qint64 incomeCents = 0;
+    size_t lastRow = 0;  // latest line, whose prices are reported like SQLite's bare columns
+    qint32 nameId = -1;  // greatest receipt name (top products)
+};
+
+void mergeInto(GroupSum& into, const GroupSum& from) {
+    into.quantity += from.quantity;
+    into.costCents += from.costCents;
+    into.incomeCents += from.incomeCents;
+    into.lastRow = std::max(into.lastRow, from.lastRow);
+}
+}  // namespace
+
+SalesStore& SalesStore::instance() {
+    static SalesStore store;
+    return store;
+}
+
+void SalesStore::clear() {
+    m_day.clear();
+    m_productId.clear();
+    m_nameId.clear();
+    m_quantity.clear();
+    m_priceCents.clear();
+    m_costCents.clear();
+    m_names.clear();
+    m_nameIds.clear();
+    m_rowsByTransaction.clear();
+}
+
+void SalesStore::invalidate() {
+    clear();
+    m_loaded = false;
+}
+
+qint32 SalesStore::nameId(const QString& name) {
+    auto it = m_nameIds.constFind(name);
+    if (it != m_nameIds.cend()) {
+        return it.value();
+    }
+    auto id = static_cast<qint32>(m_names.size());
+    m_names << name;
+    m_nameIds.insert(name, id);
+    return id;
+}
+
+void SalesStore::appendLine(qint32 day, const TransactionItem& item) {
+    m_day.push_back(day);
+    m_productId.push_back(item.productId);
+    m_nameId.push_back(nameId(item.genericName));
+    m_quantity.push_back(item.quantity);
+    m_priceCents.push_back(item.sellingPrice.cents());
+    m_costCents.push_back(item.costPrice.cents());
+}
+
+bool SalesStore::ensureLoaded() {
+    if (m_loaded) {
+        return true;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    clear();
+
+    // Sale-date order, so each date range is one contiguous slice. julianday() of a date lands on midnight,
+    // half a day before QDate's Julian day number. Archived years are included.
+    const QString source = Database::instance().transactionsSource();
+    QSqlQuery q(Database::instance().db());
+    q.setForwardOnly(true);
+    if (!q.exec(QString(R"(
+        SELECT t.id,
+               CAST(julianday(t.sale_date) + 0.5 AS INTEGER),
+               CAST(json_extract(item.value, '$.id') AS INTEGER),
+               json_extract(item.value, '$.generic_name'),
+               CAST(json_extract(item.value, '$.quantity') AS INTEGER),
+               CAST(round(json_extract(item.value, '$.selling_price') * 100) AS INTEGER),
+               CAST(round(json_extract(item.value, '$.cost_price') * 100) AS INTEGER)
+        FROM %1 t, json_each(t.items) AS item
+        ORDER BY t.sale_date, t.id
+    )")
+                    .arg(source))) {
+        qWarning() << "SalesStore load failed:" << q.lastError().text();
+        clear();
+        return false;
+    }
+
+    int currentId = 0;
+    while (q.next()) {
+        int id = q.value(0).toInt();
+        if (id != currentId) {
+            currentId = id;
+            m_rowsByTransaction.insert(id, {static_cast<qsizetype>(m_day.size()), 0});
+        }
+        TransactionItem item;
+        item.productId = q.value(2).toInt();
+        item.genericName = q.value(3).toString();
+        item.quantity = q.value(4).toInt();
+        item.sellingPrice = Money::fromCents(q.value(5).toLongLong());
+        item.costPrice = Money::fromCents(q.value(6).toLongLong());
+        appendLine(q.value(1).toInt(), item);
+        m_rowsByTransaction[id].second++;
+    }
+
+    m_loaded = true;
+    qInfo() << "SalesStore loaded" << m_day.size() << "lines in" << timer.elapsed() << "ms";
+    return true;
+}
+
+void SalesStore::append(const Transaction& t) {
+    if (!m_loaded) {
+        return;
+    }
+    // A clock (or shop time zone) that went backwards would break the date order, so the store reloads instead
+    auto day = static_cast<qint32>(t.saleDate.toJulianDay());
+    if (!m_day.empty() && day < m_day.back()) {
+        invalidate();
+        return;
+    }
+    m_rowsByTransaction.insert(t.id, {static_cast<qsizetype>(m_day.size()), t.items.size()});
+    for (const auto& item : t.items) {
+        appendLine(day, item);
+    }
+}
+
+void SalesStore::removeTransaction(int transactionId) {
+    if (!m_loaded) {
+        return;
+    }
+    auto rows = m_rowsByTransaction.take(transactionId);
+    for (qsizetype i = rows.first; i < rows.first + rows.second; ++i) {
+        m_productId[static_cast<size_t>(i)] = 0;
+    }
+}
+
+QPair<size_t, size_t> SalesStore::rowRange(qint32 fromDay, qint32 toDay) const {
+    auto begin = std::lower_bound(m_day.cbegin(), m_day.cend(), fromDay);
+    auto end = std::upper_bound(begin, m_day.cend(), toDay);
+    return {static_cast<size_t>(begin - m_day.cbegin()), static_cast<size_t>(end - m_day.cbegin())};
+}
+
+void SalesStore::sumByDay(qint32 fromDay, qint32 toDay, std::vector<qint64>& cents, std::vector<qint64>& lines) const {
+    const size_t days = static_cast<size_t>(toDay - fromDay + 1);
+    auto [begin, end] = rowRange(fromDay, toDay);
+
+    using Part = std::pair<std::vector<qint64>, std::vector<qint64>>;
+    auto parts = scanSlices(begin, end, Part(std::vector<qint64>(days, 0), std::vector<qint64>(days, 0)),
+                            [this, fromDay](size_t b, size_t e, Part& part) {
+                                qint64* sums = part.first.data();
+                                qint64* counts = part.second.data();
+                                for (size_t i = b; i < e; ++i) {
+                                    const qint64 live = m_productId[i] != 0;
+                                    const size_t d = static_cast<size_t>(m_day[i] - fromDay);
+                                    sums[d] += live * m_quantity[i] * m_priceCents[i];
+                                    counts[d] += live;
+                                }
+                            });
+
+    cents.assign(days, 0);
+    lines.assign(days, 0);
+    for (const auto& part : parts) {
+        for (size_t d = 0; d < days; ++d) {
+            cents[d] += part.first[d];
+            lines[d] += part.second[d];
+        }
+    }
+}
+
+QList<SalesReport> SalesStore::dailyTotals() {
+    QList<SalesReport> list;
+    if (!ensureLoaded() || m_day.empty()) {
+        return list;
+    }
+    std::vector<qint64> cents;
+    std::vector<qint64> lines;
+    sumByDay(m_day.front(), m_day.back(), cents, lines);
+    for (size_t d = cents.size(); d-- > 0;) {
+        if (lines[d] > 0) {
+            list.append(
+                SalesReport{QDate::fromJulianDay(m_day.front() + static_cast<qint64>(d)), Money::fromCents(cents[d])});
+        }
+    }
+    return list;
+}
+
+QList<MonthlySalesReport> SalesStore::monthlyTotals() {
+    QList<MonthlySalesReport> list;
+    if (!ensureLoaded() || m_day.empty()) {
+        return list;
+    }
+    std::vector<qint64> cents;
+    std::vector<qint64> lines;
+    sumByDay(m_day.front(), m_day.back(), cents, lines);
+
+    // Days are folded newest first, so each month is complete when the next (older) one starts
+    for (size_t d = cents.size(); d-- > 0;) {
+        if (lines[d] == 0) {
+            continue;
+        }
+        QDate day = QDate::fromJulianDay(m_day.front() + static_cast<qint64>(d));
+        QDate month(day.year(), day.month(), 1);
+        if (list.isEmpty() || list.last().month != month) {
+            list.append(MonthlySalesReport{month, Money()});
+        }
+        list.last().totalIncome += Money::fromCents(cents[d]);
+    }
+    return list;
+}
+
+QList<AnnualSalesReport> SalesStore::annualTotals() {
+    QList<AnnualSalesReport> list;
+    if (!ensureLoaded() || m_day.empty()) {
+        return list;
+    }
+    std::vector<qint64> cents;
+    std::vector<qint64> lines;
+    sumByDay(m_day.front(), m_day.back(), cents, lines);
+
+    for (size_t d = cents.size(); d-- > 0;) {
+        if (lines[d] == 0) {
+            continue;
+        }
+        QDate year(QDate::fromJulianDay(m_day.front() + static_cast<qint64>(d)).year(), 1, 1);
+        if (list.isEmpty() || list.last().year != year) {
+            list.append(AnnualSalesReport{year, Money()});
+        }
+        list.last().totalIncome += Money::fromCents(cents[d]);
+    }
+    return list;
+}
+
+QList<ProductSale> SalesStore::productSales(SalesPeriod period, const QDate& fromDate, const QDate& toDate) {
+    QList<ProductSale> list;
+    if (!ensureLoaded()) {
+        return list;
+    }
+    QDate from = fromDate;
+    QDate to = toDate;
+    Database::expandToPeriod(period, from, to);
+    const auto fromDay = static_cast<qint32>(from.toJulianDay());
+    const auto toDay = static_cast<qint32>(to.toJulianDay());
+    auto [begin, end] = rowRange(fromDay, toDay);
+    if (begin == end) {
+        return list;
+    }
+
+    // Bucket of every day in range, worked out once instead of per line
+    std::vector<qint32> bucket(static_cast<size_t>(toDay - fromDay + 1));
+    for (size_t d = 0; d < bucket.size(); ++d) {
+        bucket[d] = bucketOf(period, fromDay + static_cast<qint32>(d));
+    }
+
+    using Part = QHash<GroupKey, GroupSum>;
+    auto parts = scanSlices(begin, end, Part(), [&](size_t b, size_t e, Part& part) {
+        for (size_t i = b; i < e; ++i) {
+            if (m_productId[i] == 0) {
+                continue;
+            }
+            GroupSum& g = part[{bucket[static_cast<size_t>(m_day[i] - fromDay)], m_productId[i], m_nameId[i]}];
+            g.quantity += m_quantity[i];
+            g.costCents += m_quantity[i] * m_costCents[i];
+            g.incomeCents += m_quantity[i] * m_priceCents[i];
+            g.lastRow = i;
+        }
+    });
+    Part groups = std::move(parts.front());
+    for (size_t p = 1; p < parts.size(); ++p) {
+        for (auto it = parts[p].cbegin(); it != parts[p].cend(); ++it) {
+            mergeInto(groups[it.key()], it.value());
+        }
+    }
+
+    list.reserve(groups.size());
+    for (auto it = groups.cbegin(); it != groups.cend(); ++it) {
+        const GroupSum& g = it.value();
+        ProductSale s;
+        s.transactionDate = QDate::fromJulianDay(it.key().bucket);
+        s.productId = it.key().productId;
+        s.productName = m_names[it.key().nameId];
+        s.costPrice = Money::fromCents(m_costCents[g.lastRow]);
+        s.sellingPrice = Money::fromCents(m_priceCents[g.lastRow]);
+        s.quantitySold = static_cast<int>(g.quantity);
+        s.income = Money::fromCents(g.incomeCents);
+        s.profit = Money::fromCents(g.incomeCents - g.costCents);
+        list.append(s);
+    }
+    std::sort(list.begin(), list.end(), [](const ProductSale& a, const ProductSale& b) {
+        return a.transactionDate != b.transactionDate ? a.transactionDate < b.transactionDate : a.income > b.income;
+    });
+    return list;
+}
+
+QList<ProductSale> SalesStore::topProducts(const QDate& fromDate, const QDate& toDate, ProductMetric metric, int n) {
+    QList<ProductSale> list;
+    if (!ensureLoaded() || n <= 0) {
+        return list;
+    }
+    auto [begin, end] =
+        rowRange(static_cast<qint32>(fromDate.toJulianDay()), static_cast<qint32>(toDate.toJulianDay()));
+
+    // Keyed by id alone so renamed products are not split; the greatest receipt name is the fallback label
+    using Part = QHash<qint32, GroupSum>;
+    auto parts = scanSlices(begin, end, Part(), [this](size_t b, size_t e, Part& part) {
+        for (size_t i = b; i < e; ++i) {
+            if (m_productId[i] == 0) {
+                continue;
+            }
+            GroupSum& g = part[m_productId[i]];
+            g.quantity += m_quantity[i];
+            g.costCents += m_quantity[i] * m_costCents[i];
+            g.incomeCents += m_quantity[i] * m_priceCents[i];
+            if (g.nameId != m_nameId[i] && (g.nameId < 0 || m_names[m_nameId[i]] > m_names[g.nameId])) {
+                g.nameId = m_nameId[i];
+            }
+        }
+    });
+    Part groups = std::move(parts.front());
+    for (size_t p = 1; p < parts.size(); ++p) {
+        for (auto it = parts[p].cbegin(); it != parts[p].cend(); ++it) {
+            GroupSum& g = groups[it.key()];
+            mergeInto(g, it.value());
+            if (g.nameId < 0 || m_names[it.value().nameId] > m_names[g.nameId]) {
+                g.nameId = it.value().nameId;
+            }
+        }
+    }
+
+    auto value = [metric](const GroupSum& g) {
+        return metric == ProductMetric::Profit     ? g.incomeCents - g.costCents
+               : metric == ProductMetric::Quantity ? g.quantity
+                                                   : g.incomeCents;
+    };
+    std::vector<std::pair<qint32, GroupSum>> ranked;
+    ranked.reserve(static_cast<size_t>(groups.size()));
+    for (auto it = groups.cbegin(); it != groups.cend(); ++it) {
+        ranked.emplace_back(it.key(), it.value());
+    }
+    auto cut = ranked.begin() + std::min<qsizetype>(n, static_cast<qsizetype>(ranked.size()));
+    std::partial_sort(ranked.begin(), cut, ranked.end(),
+                      [&value](const auto& a, const auto& b) { return value(a.second) > value(b.second); });
+    ranked.erase(cut, ranked.end());
+
+    QList<int> ids;
+    for (const auto& r : ranked) {
+        ids << r.first;
+    }
+    QHash<int, QString> currentNames = Database::instance().getProductNames(ids);
+
+    for (const auto& [id, g] : ranked) {
+        ProductSale s;
+        s.productId = id;
+        s.productName = currentNames.value(id, m_names[g.nameId]);
+        s.quantitySold = static_cast<int>(g.quantity);
+        s.income = Money::fromCents(g.incomeCents);
+        s.profit = Money::fromCents(g.incomeCents - g.costCents);
+        if (s.quantitySold > 0) {
+            s.costPrice = Money::fromCents(g.costCents).dividedBy(s.quantitySold);
+            s.sellingPrice = s.income.dividedBy(s.quantitySold);
+        }
+        list.append(s);
+    }
+    return list;
+}
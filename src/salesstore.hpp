@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <vector>
+#include "models.hpp"
+
+// In-memory, column-per-field copy of every sold line, for the reports.
+//
+// Lines are kept in sale-date order as parallel arrays of packed integers (day, product, name, quantity,
+// price and cost in cents), so a date range is a binary search plus a tight scan. Scans of large ranges are
+// split across the cores and merged. Results have the same rows, grouping and order as the matching
+// Database report queries; money is summed in integer cents.
+//
+// Loaded on first use; Database appends sales and drops cancelled ones as they commit, and those of other
+// tills and imports when pollChanges() finds them in the change log. Main thread only:
+// the scan threads are joined before a query returns.
+class SalesStore {
+  public:
+    static SalesStore& instance();
+
+    // Loads all sold lines if that has not happened yet. Returns false if the database could not be read.
+    bool ensureLoaded();
+    [[nodiscard]] bool isLoaded() const { return m_loaded; }
+    // Forgets everything; the next query loads again.
+    void invalidate();
+
+    // Kept up to date by Database; both are no-ops until the store is loaded.
+    void append(const Transaction& t);
+    void removeTransaction(int transactionId);
+
+    // All time, newest first (as getDailySalesReports() etc.)
+    QList<SalesReport> dailyTotals();
+    QList<MonthlySalesReport> monthlyTotals();
+    QList<AnnualSalesReport> annualTotals();
+
+    // One row per period bucket, product and receipt name over [from, to] widened to whole periods, ordered by
+    // bucket then income (as Database::forEachProductSale).
+    QList<ProductSale> productSales(SalesPeriod period, const QDate& from, const QDate& to);
+    // As Database::getTopProducts.
+    QList<ProductSale> topProducts(const QDate& from, const QDate& to, ProductMetric metric, int n);
+
+    SalesStore(const SalesStore&) = delete;
+    SalesStore& operator=(const SalesStore&) = delete;
+
+  private:
+    SalesStore() = default;
+
+    bool m_loaded = false;
+
+    // One entry per sold line. A cancelled line keeps its slot with product id 0.
+    std::vector<qint32> m_day;  // Julian day of the sale date (shop time zone)
+    std::vector<qint32> m_productId;
+    std::vector<qint32> m_nameId;  // index into m_names: the name printed on the receipt
+    std::vector<qint32> m_quantity;
+    std::vector<qint64> m_priceCents;
+    std::vector<qint64> m_costCents;
+
+    QStringList m_names;
+    QHash<QString, qint32> m_nameIds;
+    QHash<int, QPair<qsizetype, qsizetype>> m_rowsByTransaction;  // id -> first row, row count
+
+    void clear();
+    qint32 nameId(const QString& name);
+    void appendLine(qint32 day, const TransactionItem& item);
+    // Rows whose day falls in [fromDay, toDay]
+    QPair<size_t, size_t> rowRange(qint32 fromDay, qint32 toDay) const;
+    // Per-day income in cents and live line counts over [fromDay, toDay]
+    void sumByDay(qint32 fromDay, qint32 toDay, std::vector<qint64>& cents, std::vector<qint64>& lines) const;
+};
@@ -10,19 +10,16 @@
 #include <QPrinter>
 #include <QVBoxLayout>
 #include "database.hpp"
+#include "datetimedelegate.hpp"
+#include "receipt.hpp"
+
+static constexpr int kListedTransactions = 200;
 
 // =================== Receipt Printer ===================
 
 static void printReceipt(const Transaction& t, QWidget* parent) {
     QPrinter printer(QPrinter::HighResolution);
-
-    // Default to receipt paper: 80mm wide (most common thermal receipt printer)
-    // 80mm = ~226 points (1 pt = 1/72 inch, 80mm / 25.4 * 72 ≈ 227)
-    // Height is set long enough; printer will cut at end of content.
-    printer.setPageSize(QPageSize(QSizeF(80, 297), QPageSize::Millimeter));
-    printer.setPageMargins(QMarginsF(4, 4, 4, 4), QPageLayout::Millimeter);
-    printer.setFullPage(false);
-    printer.setColorMode(QPrinter::GrayScale);
+    setupReceiptPrinter(printer);
 
     QPrintDialog dlg(&printer, parent);
     dlg.setWindowTitle("Print Receipt — Tella POS");
@@ -38,129 +35,7 @@ static void printReceipt(const Transaction& t, QWidget* parent) {
         QMessageBox::critical(parent, "Print Error", "Failed to open printer.");
         return;
     }
-
-    // ---- Coordinate system ----
-    // Work in printer points. Get the usable rect.
-    const QRectF pageRect = printer.pageLayout().paintRectPixels(printer.resolution());
-    const qreal W = pageRect.width();
-    const qreal dpi = printer.resolution();  // dots per inch
-    const qreal mm = dpi / 25.4;             // 1mm in dots
-
-    // Fonts scaled for receipt printer
-    QFont fTitle("Courier New", -1, QFont::Bold);
-    fTitle.setPixelSize(qRound(4.0 * mm));  // ~4mm tall
-
-    QFont fHeader("Courier New", -1, QFont::Bold);
-    fHeader.setPixelSize(qRound(3.2 * mm));
-
-    QFont fNormal("Courier New");
-    fNormal.setPixelSize(qRound(3.0 * mm));
-
-    QFont fSmall("Courier New");
-    fSmall.setPixelSize(qRound(2.5 * mm));
-
-    QFont fTotal("Courier New", -1, QFont::Bold);
-    fTotal.setPixelSize(qRound(4.5 * mm));
-
-    const qreal lineH = 3.6 * mm;    // normal line height
-    const qreal lineHS = 2.9 * mm;   // small line height
-    const qreal dotLine = 0.3 * mm;  // divider thickness
-
-    qreal y = 0;
-
-    auto drawHRule = [&](bool bold = false) {
-        p.setPen(QPen(Qt::black, bold ? dotLine * 2 : dotLine));
-        p.drawLine(QPointF(0, y), QPointF(W, y));
-        y += 1.5 * mm;
-    };
-
-    auto drawCentered = [&](const QString& text, const QFont& font, qreal h) {
-        p.setFont(font);
-        p.setPen(Qt::black);
-        p.drawText(QRectF(0, y, W, h), Qt::AlignHCenter | Qt::AlignVCenter, text);
-        y += h;
-    };
-
-    auto drawRow = [&](const QString& left, const QString& right, const QFont& font, qreal h) {
-        p.setFont(font);
-        p.setPen(Qt::black);
-        p.drawText(QRectF(0, y, W * 0.65, h), Qt::AlignLeft | Qt::AlignVCenter, left);
-        p.drawText(QRectF(0, y, W, h), Qt::AlignRight | Qt::AlignVCenter, right);
-        y += h;
-    };
-
-    // ---- Header ----
-    y += 2 * mm;
-    drawCentered("Tella POS", fTitle, 5 * mm);
-    drawCentered("Sales Receipt", fNormal, lineH);
-    y += 1.5 * mm;
-    drawHRule(true);
-
-    // ---- Meta ----
-    drawRow("Date:", t.createdAt.toString("dd/MM/yyyy hh:mm"), fSmall, lineHS);
-    drawRow("Ref #:", QString::number(t.id), fSmall, lineHS);
-    y += 1 * mm;
-    drawHRule();
-
-    // ---- Column headers ----
-    p.setFont(fHeader);
-    p.setPen(Qt::black);
-    p.drawText(QRectF(0, y, W * 0.55, lineH), Qt::AlignLeft | Qt::AlignVCenter, "Item");
-    p.drawText(QRectF(W * 0.55, y, W * 0.13, lineH), Qt::AlignRight | Qt::AlignVCenter, "Qty");
-    p.drawText(QRectF(W * 0.68, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter, "Price");
-    p.drawText(QRectF(W * 0.84, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter, "Sub");
-    y += lineH;
-    drawHRule();
-
-    // ---- Items ----
-    double grandTotal = 0.0;
-    for (const auto& item : t.items) {
-        const double sub = item.subtotal();
-        grandTotal += sub;
-
-        // Product name — may need to wrap on narrow paper
-        QString name = item.genericName;
-        if (!item.brandName.isEmpty()) {
-            name += " (" + item.brandName + ")";
-        }
-
-        // Measure name width; wrap if too wide
-        QFontMetricsF fm(fNormal);
-        const qreal maxNameW = W * 0.54;
-        if (fm.horizontalAdvance(name) > maxNameW) {
-            // Try generic name alone first
-            if (fm.horizontalAdvance(item.genericName) <= maxNameW) {
-                name = item.genericName;
-            } else {
-                // Elide
-                name = fm.elidedText(item.genericName, Qt::ElideRight, static_cast<int>(maxNameW));
-            }
-        }
-
-        p.setFont(fNormal);
-        p.setPen(Qt::black);
-        p.drawText(QRectF(0, y, W * 0.55, lineH), Qt::AlignLeft | Qt::AlignVCenter, name);
-        p.drawText(QRectF(W * 0.55, y, W * 0.13, lineH), Qt::AlignRight | Qt::AlignVCenter,
-                   QString::number(item.quantity));
-        p.drawText(QRectF(W * 0.68, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter,
-                   QString::number(item.sellingPrice, 'f', 0));
-        p.drawText(QRectF(W * 0.84, y, W * 0.16, lineH), Qt::AlignRight | Qt::AlignVCenter,
-                   QString::number(sub, 'f', 0));
-        y += lineH;
-    }
-
-    // ---- Total ----
-    y += 1 * mm;
-    drawHRule(true);
-    drawRow("TOTAL (UGX)", QString::number(grandTotal, 'f', 2), fTotal, 5.5 * mm);
-    drawHRule(true);
-
-    // ---- Footer ----
-    y += 2 * mm;
-    drawCentered("Thank you for your purchase!", fSmall, lineHS);
-    drawCentered("Tella POS — Serving you better", fSmall, lineHS);
-    y += 3 * mm;
-
+    paintReceipt(p, printer.pageLayout().paintRectPixels(printer.resolution()), printer.resolution(), t);
     p.end();
 }
 
@@ -215,7 +90,7 @@ void TransactionDetailWidget::setupUi() {
     addField("TRANSACTION ID", QString("#%1").arg(m_transaction.id));
     addField("DATE & TIME", m_transaction.createdAt.toString("dd MMM yyyy  hh:mm:ss"));
     addField("ITEMS", QString::number(m_transaction.items.size()));
-    addField("TOTAL", QString("UGX %L1").arg(m_transaction.total(), 0, 'f', 2), "#2f855a");
+    addField("TOTAL", QString("UGX %L1").arg(m_transaction.total().toDouble(), 0, 'f', 2), "#2f855a");
     infoLayout->addStretch();
     root->addWidget(infoGroup);
 
@@ -239,14 +114,14 @@ void TransactionDetailWidget::setupUi() {
     tbl->setShowGrid(false);
     tbl->setRowCount(static_cast<int>(m_transaction.items.size()));
 
-    double total = 0;
+    Money total;
     for (int i = 0; i < m_transaction.items.size(); ++i) {
         const auto& item = m_transaction.items[i];
         tbl->setItem(i, 0, new QTableWidgetItem(item.genericName));
         tbl->setItem(i, 1, new QTableWidgetItem(item.brandName));
         tbl->setItem(i, 2, new QTableWidgetItem(item.barcode));
 
-        auto* priceItem = new QTableWidgetItem(QString::number(item.sellingPrice, 'f', 2));
+        auto* priceItem = new QTableWidgetItem(QString::number(item.sellingPrice.toDouble(), 'f', 2));
         priceItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         tbl->setItem(i, 3, priceItem);
 
@@ -254,9 +129,9 @@ void TransactionDetailWidget::setupUi() {
         qtyItem->setTextAlignment(Qt::AlignCenter);
         tbl->setItem(i, 4, qtyItem);
 
-        double sub = item.subtotal();
+        Money sub = item.subtotal();
         total += sub;
-        auto* subItem = new QTableWidgetItem(QString("UGX %1").arg(sub, 0, 'f', 2));
+        auto* subItem = new QTableWidgetItem(QString("UGX %1").arg(sub.toDouble(), 0, 'f', 2));
         subItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
         subItem->setFont(QFont("", -1, QFont::Medium));
         tbl->setItem(i, 5, subItem);
@@ -266,7 +141,7 @@ void TransactionDetailWidget::setupUi() {
     // Total row
     auto* totalRow = new QHBoxLayout;
     totalRow->addStretch();
-    auto* totalLabel = new QLabel(QString("GRAND TOTAL:  UGX %L1").arg(total, 0, 'f', 2));
+    auto* totalLabel = new QLabel(QString("GRAND TOTAL:  UGX %L1").arg(total.toDouble(), 0, 'f', 2));
     totalLabel->setStyleSheet(
         "color: white; background-color: #1e3a5f; font-size: 18px; font-weight: 700;"
         "border-radius: 8px; padding: 10px 20px;");
@@ -294,7 +169,6 @@ void TransactionDetailWidget::setupUi() {
                     QMessageBox::critical(this, "Error", Database::instance().lastError());
                 } else {
                     QMessageBox::information(this, "Cancelled", "Transaction cancelled and stock restored.");
-                    emit transactionDeleted();
                     emit backRequested();
                 }
             }
@@ -306,15 +180,37 @@ void TransactionDetailWidget::setupUi() {
     }
 
     // ---- Print receipt ----
-    connect(printBtn, &QPushButton::clicked, this, [this] { printReceipt(m_transaction, this); });
+    // A configured receipt device prints straight away in the background; otherwise pick a printer
+    connect(printBtn, &QPushButton::clicked, this, [this] {
+        if (!ReceiptPrinter::usesDevice()) {
+            printReceipt(m_transaction, this);
+            return;
+        }
+        if (!m_receiptPrinter) {
+            m_receiptPrinter = new ReceiptPrinter(this);
+            connect(m_receiptPrinter, &ReceiptPrinter::failed, this, [this](int, const QString& message) {
+                QMessageBox::critical(this, "Print Error", message);
+            });
+        }
+        m_receiptPrinter->enqueue(m_transaction);
+    });
 }
 
 // =================== TransactionsWidget ===================
 
 TransactionsWidget::TransactionsWidget(const User& user, QWidget* parent) : QWidget(parent), m_currentUser(user) {
     setupUi();
+    loadData();
+    m_changeListenerId = Database::instance().addChangeListener([this](const Database::DataChange& change) {
+        if (change.unknown && change.transactions.isEmpty()) {
+            return;  // only sales are listed here, and a deleted sale is always named
+        }
+        updateRows(change.transactions);
+    });
 }
 
+TransactionsWidget::~TransactionsWidget() { Database::instance().removeChangeListener(m_changeListenerId); }
+
 void TransactionsWidget::setupUi() {
     auto* root = new QVBoxLayout(this);
     root->setContentsMargins(0, 0, 0, 0);
@@ -341,6 +237,7 @@ void TransactionsWidget::setupUi() {
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_table->setAlternatingRowColors(true);
+    m_table->setItemDelegateForColumn(1, new DateTimeDelegate("dd MMM yyyy  hh:mm", m_table));
     m_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
     m_table->setColumnWidth(0, 60);
     m_table->setColumnWidth(2, 80);
@@ -361,13 +258,8 @@ void TransactionsWidget::setupUi() {
     });
 }
 
-void TransactionsWidget::refresh() {
-    m_stack->setCurrentIndex(0);
-    loadData();
-}
-
 void TransactionsWidget::loadData() {
-    QList<Transaction> transactions = Database::instance().listTransactions(200, 0);
+    QList<Transaction> transactions = Database::instance().listTransactions(kListedTransactions, 0);
     m_table->setRowCount(0);
     m_table->setRowCount(static_cast<int>(transactions.size()));
     for (int i = 0; i < transactions.size(); ++i) {
@@ -375,19 +267,52 @@ void TransactionsWidget::loadData() {
     }
 }
 
+// Sales are only ever made or deleted: a listed one in a change is gone, an unlisted one is new and goes in by its
+// time, so a sale that arrives late from another branch lands among its own day
+void TransactionsWidget::updateRows(const QList<int>& transactionIds) {
+    for (int id : transactionIds) {
+        int row = 0;
+        while (row < m_table->rowCount() && m_table->item(row, 0)->data(Qt::UserRole).toInt() != id) {
+            ++row;
+        }
+        if (row < m_table->rowCount()) {
+            m_table->removeRow(row);
+            continue;
+        }
+        const Transaction t = Database::instance().getTransactionById(id);
+        if (t.id == 0) {
+            continue;
+        }
+        row = 0;
+        while (row < m_table->rowCount() && m_table->item(row, 1)->data(Qt::DisplayRole).toDateTime() > t.createdAt) {
+            ++row;
+        }
+        if (row == kListedTransactions) {
+            continue;
+        }
+        m_table->insertRow(row);
+        setRow(row, t);
+        if (m_table->rowCount() > kListedTransactions) {
+            m_table->removeRow(kListedTransactions);
+        }
+    }
+}
+
 void TransactionsWidget::setRow(int row, const Transaction& t) {
     auto* idItem = new QTableWidgetItem(QString("#%1").arg(t.id));
     idItem->setData(Qt::UserRole, t.id);
     idItem->setTextAlignment(Qt::AlignCenter);
     m_table->setItem(row, 0, idItem);
 
-    m_table->setItem(row, 1, new QTableWidgetItem(t.createdAt.toString("dd MMM yyyy  hh:mm")));
+    auto* dateItem = new QTableWidgetItem;
+    dateItem->setData(Qt::DisplayRole, t.createdAt);
+    m_table->setItem(row, 1, dateItem);
 
     auto* itemsItem = new QTableWidgetItem(QString::number(t.items.size()));
     itemsItem->setTextAlignment(Qt::AlignCenter);
     m_table->setItem(row, 2, itemsItem);
 
-    auto* totalItem = new QTableWidgetItem(QString("UGX %L1").arg(t.total(), 0, 'f', 2));
+    auto* totalItem = new QTableWidgetItem(QString("UGX %L1").arg(t.total().toDouble(), 0, 'f', 2));
     totalItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
     totalItem->setForeground(QColor("#2f855a"));
     totalItem->setFont(QFont("", -1, QFont::Bold));
@@ -417,11 +342,7 @@ void TransactionsWidget::onViewDetails(int id) {
     }
 
     m_detailWidget = new TransactionDetailWidget(t, m_currentUser);
-    connect(m_detailWidget, &TransactionDetailWidget::backRequested, this, [this] {
-        m_stack->setCurrentIndex(0);
-        loadData();
-    });
-    connect(m_detailWidget, &TransactionDetailWidget::transactionDeleted, this, [this] { loadData(); });
+    connect(m_detailWidget, &TransactionDetailWidget::backRequested, this, [this] { m_stack->setCurrentIndex(0); });
     m_stack->addWidget(m_detailWidget);
     m_stack->setCurrentWidget(m_detailWidget);
 }
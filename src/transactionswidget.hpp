@@ -8,17 +8,19 @@
 #include <QWidget>
 #include "models.hpp"
 
+class ReceiptPrinter;
+
 class TransactionDetailWidget : public QWidget {
     Q_OBJECT
   public:
     explicit TransactionDetailWidget(const Transaction& t, const User& user, QWidget* parent = nullptr);
   signals:
     void backRequested();
-    void transactionDeleted();
 
   private:
     Transaction m_transaction;
     User m_user;
+    ReceiptPrinter* m_receiptPrinter = nullptr;  // ESC/POS device, when one is configured
     void setupUi();
 };
 
@@ -26,7 +28,7 @@ class TransactionsWidget : public QWidget {
     Q_OBJECT
   public:
     explicit TransactionsWidget(const User& user, QWidget* parent = nullptr);
-    void refresh();
+    ~TransactionsWidget() override;
   private slots:
     void onViewDetails(int id);
 
@@ -35,7 +37,9 @@ class TransactionsWidget : public QWidget {
     QTableWidget* m_table;
     QStackedWidget* m_stack;
     TransactionDetailWidget* m_detailWidget = nullptr;
+    int m_changeListenerId = 0;
     void setupUi();
     void loadData();
+    void updateRows(const QList<int>& transactionIds);
     void setRow(int row, const Transaction& t);
 };
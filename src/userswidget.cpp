@@ -7,6 +7,7 @@
 #include <QMessageBox>
 #include <QVBoxLayout>
 #include "database.hpp"
+#include "datetimedelegate.hpp"
 
 // =================== UserDialog ===================
 
@@ -106,6 +107,7 @@ void UsersWidget::setupUi() {
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_table->setAlternatingRowColors(true);
+    m_table->setItemDelegateForColumn(4, new DateTimeDelegate("dd MMM yyyy hh:mm", m_table));
     m_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
     m_table->setColumnWidth(0, 45);
     m_table->setColumnWidth(2, 70);
@@ -151,7 +153,9 @@ void UsersWidget::setRow(int row, const User& u) {  // NOLINT
     adminItem->setForeground(u.isAdmin ? QColor("#b7791f") : QColor("#718096"));
     m_table->setItem(row, 3, adminItem);
 
-    m_table->setItem(row, 4, new QTableWidgetItem(u.createdAt.toString("dd MMM yyyy hh:mm")));
+    auto* createdItem = new QTableWidgetItem;
+    createdItem->setData(Qt::DisplayRole, u.createdAt);
+    m_table->setItem(row, 4, createdItem);
 
     // Action buttons
     auto* actWidget = new QWidget;
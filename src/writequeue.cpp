@@ -0,0 +1,107 @@
+#include "writequeue.hpp"
+#include <QRandomGenerator>
+#include "database.hpp"
+
+// How long a batch keeps being retried while another till holds the write lock, and the bounds of the pause
+// between tries
+static constexpr int kBusyGiveUpMs = 10000;
+static constexpr int kBusyMinPauseMs = 50;
+static constexpr int kBusyMaxPauseMs = 250;
+
+WriteQueue& WriteQueue::instance() {
+    static WriteQueue queue;
+    return queue;
+}
+
+WriteQueue::WriteQueue() {
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &WriteQueue::commitBatch);
+}
+
+void WriteQueue::enqueue(Write write, Done done) {
+    if (m_windowMs < 0) {
+        auto& db = Database::instance();
+        m_windowMs = qMax(0, db.setting("write_queue_window_ms", "5").toInt());
+        m_maxBatch = qMax(1, db.setting("write_queue_max_batch", "32").toInt());
+    }
+
+    m_queue.append({std::move(write), std::move(done)});
+    if (m_queue.size() >= m_maxBatch) {
+        m_timer.start(0);
+    } else if (!m_timer.isActive()) {
+        m_timer.start(m_windowMs);
+    }
+}
+
+void WriteQueue::flush() {
+    while (!m_queue.isEmpty()) {
+        commitBatch();
+    }
+}
+
+void WriteQueue::commitBatch() {
+    m_timer.stop();
+    if (m_queue.isEmpty()) {
+        return;
+    }
+    const qsizetype count = qMin<qsizetype>(m_queue.size(), qMax(1, m_maxBatch));
+    const QList<Pending> batch = m_queue.mid(0, count);
+    m_queue.remove(0, count);
+
+    struct Result {
+        bool ok = false;
+        QString error;
+    };
+    QList<Result> results(batch.size());
+
+    auto& db = Database::instance();
+    if (!db.beginTransaction(true)) {
+        if (db.lockTimedOut()) {
+            if (!m_busySince.isValid()) {
+                m_busySince.start();
+            }
+            if (m_busySince.elapsed() < kBusyGiveUpMs) {
+                // Back to the front of the queue, in order, and try again without blocking the event loop
+                m_queue = batch + m_queue;
+                m_timer.start(QRandomGenerator::global()->bounded(kBusyMinPauseMs, kBusyMaxPauseMs + 1));
+                return;
+            }
+        }
+        m_busySince.invalidate();
+        for (auto& r : results) {
+            r.error = db.lastError();
+        }
+    } else {
+        m_busySince.invalidate();
+        for (qsizetype i = 0; i < batch.size(); ++i) {
+            Result& r = results[i];
+            if (!db.beginTransaction()) {
+                r.error = db.lastError();
+                continue;
+            }
+            r.ok = batch[i].write() && db.commitTransaction();
+            if (!r.ok) {
+                r.error = db.lastError();
+                db.rollbackTransaction();
+            }
+        }
+        if (!db.commitTransaction()) {
+            // Nothing in the batch was kept
+            const QString error = db.lastError();
+            for (auto& r : results) {
+                r.ok = false;
+                r.error = error;
+            }
+        }
+    }
+
+    for (qsizetype i = 0; i < batch.size(); ++i) {
+        if (batch[i].done) {
+            batch[i].done(results[i].ok, results[i].error);
+        }
+    }
+
+    if (!m_queue.isEmpty() && !m_timer.isActive()) {
+        m_timer.start(m_queue.size() >= m_maxBatch ? 0 : m_windowMs);
+    }
+}
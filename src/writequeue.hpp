@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <functional>
+
+// Group commit for writes made close together: a burst of sales, stock-ins and product edits is written in one
+// SQLite transaction, so it costs one WAL sync instead of one each.
+//
+// Writes run in the order they were queued, each in its own savepoint, so one that fails is rolled back alone
+// and reports its own error while the rest still commit. A batch is committed `write_queue_window_ms` (default
+// 5) after its first write arrives, or at once when it holds `write_queue_max_batch` writes (default 32).
+// `done` is called for every write after the batch commits, in queue order. Used on the thread that opened
+// the database.
+//
+// The queue only waits a moment for the write lock. While another till holds it, the batch stays queued and
+// is tried again from the timer after a jittered pause, for up to 10 s before its writes are failed.
+class WriteQueue : public QObject {
+    Q_OBJECT
+  public:
+    // Returns false with Database::lastError() set when the write failed.
+    using Write = std::function<bool()>;
+    using Done = std::function<void(bool ok, const QString& error)>;
+
+    static WriteQueue& instance();
+
+    void enqueue(Write write, Done done = {});
+    // Commits everything queued now; call before closing the database.
+    void flush();
+    [[nodiscard]] int pending() const { return static_cast<int>(m_queue.size()); }
+
+  private:
+    WriteQueue();
+
+    struct Pending {
+        Write write;
+        Done done;
+    };
+    QList<Pending> m_queue;
+    QTimer m_timer;
+    int m_windowMs = -1;  // read from the settings on first use
+    int m_maxBatch = 0;
+    QElapsedTimer m_busySince;  // valid while the head of the queue waits for another till's write lock
+
+    void commitBatch();
+};